@@ -0,0 +1,176 @@
+#include "../../intf/bga.h"
+#include "../../intf/ports.h"
+
+// DISPI register interface
+#define VBE_DISPI_IOPORT_INDEX 0x01CE
+#define VBE_DISPI_IOPORT_DATA  0x01CF
+
+#define VBE_DISPI_INDEX_ID          0x0
+#define VBE_DISPI_INDEX_XRES        0x1
+#define VBE_DISPI_INDEX_YRES        0x2
+#define VBE_DISPI_INDEX_BPP         0x3
+#define VBE_DISPI_INDEX_ENABLE      0x4
+#define VBE_DISPI_INDEX_BANK        0x5
+#define VBE_DISPI_INDEX_VIRT_WIDTH  0x6
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x7
+#define VBE_DISPI_INDEX_X_OFFSET    0x8
+#define VBE_DISPI_INDEX_Y_OFFSET    0x9
+#define VBE_DISPI_INDEX_VIDEO_MEMORY_64K 0xA
+
+#define VBE_DISPI_ID0 0xB0C0
+#define VBE_DISPI_ID4 0xB0C4 // First version with 32bpp support
+#define VBE_DISPI_ID5 0xB0C5 // First version reporting video memory size
+
+#define VBE_DISPI_DISABLED    0x00
+#define VBE_DISPI_ENABLED     0x01
+#define VBE_DISPI_LFB_ENABLED 0x40
+
+#define VBE_DISPI_MAX_XRES 2560
+#define VBE_DISPI_MAX_YRES 1600
+
+// Bochs places the LFB here when it is not behind a PCI BAR
+#define VBE_DISPI_LFB_PHYSICAL_ADDRESS 0xE0000000UL
+#define VBE_DISPI_DEFAULT_MEMORY (4 * 1024 * 1024)
+
+// PCI configuration mechanism #1
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+#define PCI_VENDOR_ID_NONE 0xFFFF
+#define PCI_BAR0_OFFSET    0x10
+#define PCI_BAR_MEM_MASK   0xFFFFFFF0U
+#define PCI_BAR_TYPE_64BIT 0x4
+
+#define BGA_PCI_VENDOR 0x1234
+#define BGA_PCI_DEVICE 0x1111
+
+static int bga_present = 0;
+static uint16_t bga_version = 0;
+static uint64_t lfb_phys = 0;
+static uint64_t video_memory = 0;
+
+static uint32_t mode_height = 0;
+static uint32_t mode_pitch = 0;
+static uint32_t visible_page = 0;
+
+static void bga_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+static uint16_t bga_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+static uint32_t pci_config_read(uint32_t bus, uint32_t slot, uint32_t func, uint32_t offset) {
+    uint32_t address = 0x80000000U | (bus << 16) | (slot << 11) | (func << 8) | (offset & 0xFC);
+    outl(PCI_CONFIG_ADDRESS, address);
+    return inl(PCI_CONFIG_DATA);
+}
+
+// The LFB lives behind BAR0 of the 1234:1111 display device
+static uint64_t find_lfb_address(void) {
+    for (uint32_t bus = 0; bus < 256; bus++) {
+        for (uint32_t slot = 0; slot < 32; slot++) {
+            uint32_t id = pci_config_read(bus, slot, 0, 0);
+            if ((id & 0xFFFF) == PCI_VENDOR_ID_NONE) continue;
+            if ((id & 0xFFFF) != BGA_PCI_VENDOR || (id >> 16) != BGA_PCI_DEVICE) continue;
+
+            uint32_t bar = pci_config_read(bus, slot, 0, PCI_BAR0_OFFSET);
+            uint64_t address = bar & PCI_BAR_MEM_MASK;
+            if (bar & PCI_BAR_TYPE_64BIT) {
+                address |= (uint64_t)pci_config_read(bus, slot, 0, PCI_BAR0_OFFSET + 4) << 32;
+            }
+            return address;
+        }
+    }
+    return VBE_DISPI_LFB_PHYSICAL_ADDRESS;
+}
+
+int bga_init(void) {
+    bga_version = bga_read(VBE_DISPI_INDEX_ID);
+    if (bga_version < VBE_DISPI_ID0 || bga_version > VBE_DISPI_ID5) {
+        bga_present = 0;
+        return 0;
+    }
+
+    lfb_phys = find_lfb_address();
+    video_memory = bga_version >= VBE_DISPI_ID5
+        ? (uint64_t)bga_read(VBE_DISPI_INDEX_VIDEO_MEMORY_64K) * 64 * 1024
+        : VBE_DISPI_DEFAULT_MEMORY;
+    bga_present = 1;
+    return 1;
+}
+
+int bga_available(void) {
+    return bga_present;
+}
+
+int bga_set_mode(uint32_t width, uint32_t height, uint32_t bpp) {
+    if (!bga_present) return 0;
+    if (width == 0 || height == 0 || width > VBE_DISPI_MAX_XRES || height > VBE_DISPI_MAX_YRES) return 0;
+    // The adapter also does 15bpp, but there are no RGB555 span kernels
+    if (bpp != 8 && bpp != 16 && bpp != 24 && bpp != 32) return 0;
+    if (bpp == 32 && bga_version < VBE_DISPI_ID4) return 0;
+
+    uint32_t pitch = width * ((bpp + 7) / 8);
+    uint32_t virtual_height = height * BGA_PAGE_COUNT;
+    if ((uint64_t)pitch * virtual_height > video_memory) return 0;
+
+    // Registers may only be changed while the display is disabled
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    bga_write(VBE_DISPI_INDEX_XRES, (uint16_t)width);
+    bga_write(VBE_DISPI_INDEX_YRES, (uint16_t)height);
+    bga_write(VBE_DISPI_INDEX_BPP, (uint16_t)bpp);
+    bga_write(VBE_DISPI_INDEX_VIRT_WIDTH, (uint16_t)width);
+    bga_write(VBE_DISPI_INDEX_VIRT_HEIGHT, (uint16_t)virtual_height);
+    bga_write(VBE_DISPI_INDEX_X_OFFSET, 0);
+    bga_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+
+    // The card clamps values it can't do; accept only what we asked for
+    if (bga_read(VBE_DISPI_INDEX_XRES) != width || bga_read(VBE_DISPI_INDEX_YRES) != height ||
+        bga_read(VBE_DISPI_INDEX_VIRT_HEIGHT) != virtual_height) {
+        bga_disable();
+        return 0;
+    }
+
+    mode_height = height;
+    mode_pitch = pitch;
+    visible_page = 0;
+    return 1;
+}
+
+void bga_disable(void) {
+    if (!bga_present) return;
+    bga_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    mode_height = 0;
+    mode_pitch = 0;
+}
+
+uint64_t bga_framebuffer_phys(void) {
+    return lfb_phys;
+}
+
+uint64_t bga_framebuffer_size(void) {
+    return (uint64_t)mode_pitch * mode_height * BGA_PAGE_COUNT;
+}
+
+uint32_t bga_pitch(void) {
+    return mode_pitch;
+}
+
+uint8_t* bga_page_address(uint32_t page) {
+    if (page >= BGA_PAGE_COUNT) return 0;
+    return (uint8_t*)(lfb_phys + (uint64_t)page * mode_pitch * mode_height);
+}
+
+void bga_show_page(uint32_t page) {
+    if (!bga_present || page >= BGA_PAGE_COUNT || mode_height == 0) return;
+    bga_write(VBE_DISPI_INDEX_Y_OFFSET, (uint16_t)(page * mode_height));
+    visible_page = page;
+}
+
+uint32_t bga_visible_page(void) {
+    return visible_page;
+}
@@ -0,0 +1,105 @@
+#include "../../intf/input.h"
+#include "../../intf/cpu.h"
+
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+// Slot states. The producer fills a FREE slot and makes it READY; either
+// side may then move it READY -> BUSY to work on it and puts it back.
+#define SLOT_FREE  0
+#define SLOT_READY 1
+#define SLOT_BUSY  2
+
+typedef struct {
+    input_event_t event;
+    uint32_t state;
+} input_slot_t;
+
+static input_slot_t slots[INPUT_QUEUE_SIZE];
+static uint32_t head = 0;    // Next slot to fill, stored by the producer only
+static uint32_t tail = 0;    // Next slot to take, stored by the consumer only
+static uint32_t dropped = 0;
+
+void input_init(void) {
+    for (uint32_t i = 0; i < INPUT_QUEUE_SIZE; i++) {
+        slots[i].state = SLOT_FREE;
+    }
+    __atomic_store_n(&head, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&tail, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&dropped, 0, __ATOMIC_RELEASE);
+}
+
+// Fold a move into the newest slot if that is a move still waiting. A slot
+// the consumer has taken or is taking is FREE or BUSY, so the exchange
+// fails and the move is queued on its own.
+static int fold_move(const input_event_t* event, uint32_t position) {
+    input_slot_t* slot = &slots[(position - 1) & INPUT_QUEUE_MASK];
+    if (slot->event.type != INPUT_MOUSE_MOVE) return 0;
+
+    uint32_t expected = SLOT_READY;
+    if (!__atomic_compare_exchange_n(&slot->state, &expected, SLOT_BUSY, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    slot->event.dx += event->dx;
+    slot->event.dy += event->dy;
+    slot->event.x = event->x;
+    slot->event.y = event->y;
+    slot->event.buttons = event->buttons;
+    slot->event.modifiers = event->modifiers;
+    slot->event.timestamp = event->timestamp;
+    __atomic_store_n(&slot->state, SLOT_READY, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int input_push(const input_event_t* event) {
+    if (!event || event->type == INPUT_NONE) return 0;
+
+    input_event_t stamped = *event;
+    stamped.timestamp = rdtsc();
+
+    uint32_t position = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    if (stamped.type == INPUT_MOUSE_MOVE && fold_move(&stamped, position)) return 1;
+
+    if (position - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= INPUT_QUEUE_SIZE) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    // The consumer freed this slot before moving tail past it
+    input_slot_t* slot = &slots[position & INPUT_QUEUE_MASK];
+    slot->event = stamped;
+    __atomic_store_n(&slot->state, SLOT_READY, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, position + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int input_poll(input_event_t* event) {
+    if (!event) return 0;
+
+    uint32_t position = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    if (position == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return 0;
+
+    // Wait out a fold in progress; it is a handful of stores
+    input_slot_t* slot = &slots[position & INPUT_QUEUE_MASK];
+    uint32_t expected = SLOT_READY;
+    while (!__atomic_compare_exchange_n(&slot->state, &expected, SLOT_BUSY, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = SLOT_READY;
+        cpu_relax();
+    }
+
+    *event = slot->event;
+    __atomic_store_n(&slot->state, SLOT_FREE, __ATOMIC_RELEASE);
+    __atomic_store_n(&tail, position + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint32_t input_pending(void) {
+    uint32_t position = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - position;
+}
+
+uint32_t input_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
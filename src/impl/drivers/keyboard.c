@@ -1,15 +1,20 @@
 #include "../../intf/keyboard.h"
 #include "../../intf/ports.h"
-#include "../../intf/pic.h"
+#include "../../intf/input.h"
 
 #define KBD_DATA_PORT   0x60
 #define KBD_STATUS_PORT 0x64
-#define KBD_IRQ         1
 #define KBD_STATUS_OUTPUT_BUFFER 0x01
 #define KBD_KEY_RELEASE_MASK 0x80
 #define KBD_SCANCODE_MASK 0x7F
+#define KBD_EXTENDED_PREFIX 0xE0
 
-#define KEYBOARD_BUFFER_SIZE 256
+// Modifier keys (set 1 make codes)
+#define KBD_LEFT_SHIFT  0x2A
+#define KBD_RIGHT_SHIFT 0x36
+#define KBD_CTRL        0x1D
+#define KBD_ALT         0x38
+#define KBD_CAPS_LOCK   0x3A
 
 static char kbd_us[128] = {
     0,  27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -42,44 +47,77 @@ static char kbd_us[128] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 // All other keys are null for now
 };
 
-// Keyboard input buffer for proper input handling
-static char keyboard_buffer[KEYBOARD_BUFFER_SIZE];
-static volatile size_t buffer_head = 0;
-static volatile size_t buffer_tail = 0;
-static volatile size_t buffer_count = 0;
+// INPUT_MOD_* bits, plus which shift keys are down so releasing one of two
+// keeps Shift held
+static uint8_t modifiers = 0;
+static uint8_t shift_keys = 0;
+
+static char shifted(char c) {
+    static const char plain[] = "1234567890-=[];'\\,./`";
+    static const char shift[] = "!@#$%^&*()_+{}:\"|<>?~";
+    for (size_t i = 0; plain[i]; i++) {
+        if (plain[i] == c) return shift[i];
+    }
+    return c;
+}
+
+static char translate(uint8_t keycode) {
+    if (keycode >= sizeof(kbd_us)) return 0;
+
+    char c = kbd_us[keycode];
+    int shift = (modifiers & INPUT_MOD_SHIFT) != 0;
+    if (c >= 'a' && c <= 'z') {
+        if (shift != ((modifiers & INPUT_MOD_CAPS) != 0)) c = (char)(c - 'a' + 'A');
+        return c;
+    }
+    return shift ? shifted(c) : c;
+}
+
+static void update_modifiers(uint8_t keycode, int released) {
+    switch (keycode) {
+        case KBD_LEFT_SHIFT:
+        case KBD_RIGHT_SHIFT: {
+            uint8_t key = keycode == KBD_LEFT_SHIFT ? 0x1 : 0x2;
+            shift_keys = released ? shift_keys & ~key : shift_keys | key;
+            modifiers = shift_keys ? modifiers | INPUT_MOD_SHIFT : modifiers & ~INPUT_MOD_SHIFT;
+            break;
+        }
+        case KBD_CTRL:
+            modifiers = released ? modifiers & ~INPUT_MOD_CTRL : modifiers | INPUT_MOD_CTRL;
+            break;
+        case KBD_ALT:
+            modifiers = released ? modifiers & ~INPUT_MOD_ALT : modifiers | INPUT_MOD_ALT;
+            break;
+        case KBD_CAPS_LOCK:
+            if (!released) modifiers ^= INPUT_MOD_CAPS;
+            break;
+    }
+}
 
 void keyboard_handler() {
     uint8_t status;
-    int8_t  scancode;
 
     // Read keyboard status
     status = inb(KBD_STATUS_PORT);
     // If the lowest bit is set, it means there is data in the output buffer
     if (status & KBD_STATUS_OUTPUT_BUFFER) {
-        scancode = inb(KBD_DATA_PORT);
+        uint8_t scancode = inb(KBD_DATA_PORT);
 
-        if (scancode < 0) {
-            pic_eoi(KBD_IRQ); // End of interrupt for keyboard
-            return; // Key release - ignore for now
-        }
+        // Extended keys (right Ctrl/Alt, arrows, ...) follow this prefix
+        // with the code of their base key, which is what we report
+        if (scancode != KBD_EXTENDED_PREFIX) {
+            uint8_t keycode = scancode & KBD_SCANCODE_MASK;
+            int released = (scancode & KBD_KEY_RELEASE_MASK) != 0;
+            update_modifiers(keycode, released);
 
-        // Convert scancode to ASCII
-        uint8_t scancode_index = (uint8_t)scancode & KBD_SCANCODE_MASK;
-        if (scancode_index < sizeof(kbd_us)) {
-            char c = kbd_us[scancode_index];
-            if (c != 0) { // Only buffer printable characters
-                // Add character to circular buffer
-                if (buffer_count < KEYBOARD_BUFFER_SIZE) {
-                    keyboard_buffer[buffer_head] = c;
-                    buffer_head = (buffer_head + 1) % KEYBOARD_BUFFER_SIZE;
-                    buffer_count++;
-                }
-                // Character is now buffered for application use
-            }
+            input_event_t event = { 0 };
+            event.type = released ? INPUT_KEY_UP : INPUT_KEY_DOWN;
+            event.keycode = keycode;
+            event.modifiers = modifiers;
+            event.ascii = translate(keycode);
+            input_push(&event);
         }
     }
-
-    pic_eoi(KBD_IRQ); // End of interrupt for keyboard
 }
 
 void keyboard_init() {
@@ -87,25 +125,6 @@ void keyboard_init() {
     // This involves setting up the PIC and IDT
     // For now, we assume IDT and PIC are set up to handle IRQ1
 
-    // Initialize keyboard buffer
-    buffer_head = 0;
-    buffer_tail = 0;
-    buffer_count = 0;
-}
-
-// Function to read character from keyboard buffer
-char keyboard_read_char() {
-    if (buffer_count == 0) {
-        return 0; // No characters available
-    }
-
-    char c = keyboard_buffer[buffer_tail];
-    buffer_tail = (buffer_tail + 1) % KEYBOARD_BUFFER_SIZE;
-    buffer_count--;
-    return c;
-}
-
-// Function to check if characters are available in buffer
-int keyboard_has_char() {
-    return buffer_count > 0;
+    modifiers = 0;
+    shift_keys = 0;
 }
@@ -1,10 +1,10 @@
 #include "../../intf/mouse.h"
 #include "../../intf/ports.h"
-#include "../../intf/pic.h"
+#include "../../intf/graphics.h"
+#include "../../intf/input.h"
 
 #define MOUSE_PORT     0x60
 #define MOUSE_STATUS   0x64
-#define MOUSE_IRQ      12
 #define MOUSE_ABIT     0x20
 #define MOUSE_BBIT     0x10
 #define MOUSE_CBIT     0x08
@@ -15,27 +15,34 @@
 #define MOUSE_ENABLE   0xF4
 #define MOUSE_DEFAULT  0xF6
 #define MOUSE_TIMEOUT  100000
-#define MOUSE_LEFT_BUTTON 0x01
-#define MOUSE_RIGHT_BUTTON 0x02
-#define MOUSE_MIDDLE_BUTTON 0x04
+
+// 8042 controller status bits and configuration byte
+#define PS2_OUTPUT_FULL        0x01  // A byte is waiting at the data port
+#define PS2_INPUT_FULL         0x02  // The controller has not taken the last byte yet
+#define PS2_READ_CONFIG        0x20
+#define PS2_WRITE_CONFIG       0x60
+#define PS2_CONFIG_IRQ12       0x02
+#define PS2_CONFIG_MOUSE_CLOCK 0x20  // Set while the auxiliary clock is disabled
 
 static uint8_t mouse_cycle = 0;
 static int8_t mouse_byte[3];
 static int32_t mouse_x = 0;
 static int32_t mouse_y = 0;
+static uint8_t mouse_buttons = 0;
 
+// Type 0 waits until there is a byte to read, type 1 until we may write
 void mouse_wait(uint8_t type) {
     uint32_t timeout = MOUSE_TIMEOUT;
     if (type == 0) {
         while (timeout--) {
-            if ((inb(MOUSE_STATUS) & MOUSE_BBIT) == 0) {
+            if (inb(MOUSE_STATUS) & PS2_OUTPUT_FULL) {
                 return;
             }
         }
         return;
     } else {
         while (timeout--) {
-            if (inb(MOUSE_STATUS) & MOUSE_ABIT) {
+            if ((inb(MOUSE_STATUS) & PS2_INPUT_FULL) == 0) {
                 return;
             }
         }
@@ -57,10 +64,7 @@ uint8_t mouse_read() {
 
 void mouse_handler() {
     uint8_t status = inb(MOUSE_STATUS);
-    if (!(status & MOUSE_ABIT)) {
-        pic_eoi(MOUSE_IRQ); // End of interrupt for mouse
-        return;
-    }
+    if (!(status & MOUSE_ABIT)) return;
 
     switch (mouse_cycle) {
         case 0:
@@ -78,37 +82,53 @@ void mouse_handler() {
             mouse_y -= (int8_t)mouse_byte[2];
             if (mouse_x < 0) mouse_x = 0;
             if (mouse_y < 0) mouse_y = 0;
-            // Note: No upper bounds checking as screen size may vary
+            if (current_vga_width && mouse_x >= (int32_t)current_vga_width) mouse_x = (int32_t)current_vga_width - 1;
+            if (current_vga_height && mouse_y >= (int32_t)current_vga_height) mouse_y = (int32_t)current_vga_height - 1;
 
-            // Handle mouse buttons
-            if (mouse_byte[0] & MOUSE_LEFT_BUTTON) { // Left button
-                // Handle left click
+            // Motion first, then any button change, each as its own event
+            // so a press is never folded away with the moves around it
+            input_event_t event = { 0 };
+            event.x = mouse_x;
+            event.y = mouse_y;
+            event.buttons = mouse_buttons;
+            if (mouse_byte[1] || mouse_byte[2]) {
+                event.type = INPUT_MOUSE_MOVE;
+                event.dx = mouse_byte[1];
+                event.dy = mouse_byte[2];
+                input_push(&event);
             }
-            if (mouse_byte[0] & MOUSE_RIGHT_BUTTON) { // Right button
-                // Handle right click
-            }
-            if (mouse_byte[0] & MOUSE_MIDDLE_BUTTON) { // Middle button
-                // Handle middle click
+
+            uint8_t buttons = (uint8_t)mouse_byte[0] & (MOUSE_LEFT_BUTTON | MOUSE_RIGHT_BUTTON | MOUSE_MIDDLE_BUTTON);
+            if (buttons != mouse_buttons) {
+                mouse_buttons = buttons;
+                event.type = INPUT_MOUSE_BUTTON;
+                event.dx = 0;
+                event.dy = 0;
+                event.buttons = buttons;
+                input_push(&event);
             }
 
             mouse_cycle = 0;
             break;
     }
-    pic_eoi(MOUSE_IRQ); // End of interrupt for mouse
 }
 
 void mouse_init() {
-    uint8_t status_byte;
+    mouse_cycle = 0;
 
-    // Enable the auxiliary mouse device
+    // Enable the auxiliary mouse device (the controller sends no reply)
     mouse_wait(1);
     outb(MOUSE_STATUS, MOUSE_PS2);
-    mouse_read(); // Acknowledge
 
-    // Enable the mouse interrupt
+    // Enable the mouse interrupt in the controller's configuration byte
     mouse_wait(1);
-    outb(MOUSE_STATUS, MOUSE_ENABLE);
-    mouse_read(); // Acknowledge
+    outb(MOUSE_STATUS, PS2_READ_CONFIG);
+    uint8_t config = mouse_read();
+    config = (uint8_t)((config | PS2_CONFIG_IRQ12) & ~PS2_CONFIG_MOUSE_CLOCK);
+    mouse_wait(1);
+    outb(MOUSE_STATUS, PS2_WRITE_CONFIG);
+    mouse_wait(1);
+    outb(MOUSE_PORT, config);
 
     // Set default settings
     mouse_write(MOUSE_DEFAULT);
@@ -117,7 +137,4 @@ void mouse_init() {
     // Enable packet streaming
     mouse_write(MOUSE_ENABLE);
     mouse_read(); // Acknowledge
-
-    // Set mouse handler in IDT (not implemented here)
-    // For now, we assume IDT is set up to handle IRQ12
 }
\ No newline at end of file
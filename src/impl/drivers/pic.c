@@ -10,6 +10,14 @@
 
 #define PIC_EOI         0x20
 
+void pic_unmask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1 << (irq - 8)));
+        irq = 2; // The slave reaches the CPU through the cascade line
+    }
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << irq));
+}
+
 void pic_eoi(uint8_t irq) {
     if (irq >= 8) {
         outb(PIC2_COMMAND, PIC_EOI);
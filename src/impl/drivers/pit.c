@@ -0,0 +1,40 @@
+#include "../../intf/pit.h"
+#include "../../intf/ports.h"
+#include "../../intf/cpu.h"
+
+#define PIT_CHANNEL2      0x42
+#define PIT_COMMAND       0x43
+#define PIT_GATE_PORT     0x61
+#define PIT_GATE_ENABLE   0x01
+#define PIT_SPEAKER       0x02
+#define PIT_OUT2          0x20
+
+#define PIT_CH2_ONESHOT   0xB0 // Channel 2, lobyte/hibyte, mode 0
+#define CALIBRATE_MS      10
+#define CALIBRATE_LATCH   (PIT_FREQUENCY / (1000 / CALIBRATE_MS))
+
+static uint64_t tsc_hz = 0;
+
+uint64_t pit_tsc_hz(void) {
+    if (tsc_hz) return tsc_hz;
+
+    uint32_t edx;
+    cpuid(1, 0, 0, 0, 0, &edx);
+    if (!(edx & CPUID_EDX_TSC)) return 0;
+
+    // Gate channel 2 on with the speaker disconnected, then load a one-shot
+    // count; OUT2 goes high when it reaches zero
+    outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE_ENABLE);
+    outb(PIT_COMMAND, PIT_CH2_ONESHOT);
+    outb(PIT_CHANNEL2, CALIBRATE_LATCH & 0xFF);
+    outb(PIT_CHANNEL2, CALIBRATE_LATCH >> 8);
+
+    uint64_t start = rdtsc();
+    while (!(inb(PIT_GATE_PORT) & PIT_OUT2)) {
+        // Spin until the count expires
+    }
+    uint64_t end = rdtsc();
+
+    tsc_hz = (end - start) * (1000 / CALIBRATE_MS);
+    return tsc_hz;
+}
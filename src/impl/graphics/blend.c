@@ -0,0 +1,250 @@
+#include "../../intf/blend.h"
+#include "../../intf/simd.h"
+#include "../../intf/stdint.h"
+
+#define SSE2_PIXELS 4
+#define AVX2_PIXELS 8
+#define FILL_CHUNK 64 // Pixels of constant colour staged for blend_fill_span
+
+// a * b / 255, rounded, for 8-bit a and b
+static inline uint32_t mul_div255(uint32_t a, uint32_t b) {
+    uint32_t t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+uint32_t premultiply_pixel(uint32_t argb) {
+    uint32_t alpha = argb >> 24;
+    if (alpha == 0xFF) return argb;
+    if (alpha == 0) return 0;
+    return (alpha << 24) | (mul_div255((argb >> 16) & 0xFF, alpha) << 16) |
+           (mul_div255((argb >> 8) & 0xFF, alpha) << 8) | mul_div255(argb & 0xFF, alpha);
+}
+
+// 255 / alpha in 16.16, filled on first use
+static uint32_t unpremultiply_table[256];
+static int unpremultiply_ready = 0;
+
+uint32_t unpremultiply_pixel(uint32_t argb) {
+    uint32_t alpha = argb >> 24;
+    if (alpha == 0xFF || alpha == 0) return argb;
+
+    if (!unpremultiply_ready) {
+        for (uint32_t a = 1; a < 256; a++) {
+            unpremultiply_table[a] = (255U * 65536U + a / 2) / a;
+        }
+        unpremultiply_ready = 1;
+    }
+
+    uint32_t scale = unpremultiply_table[alpha];
+    uint32_t r = (((argb >> 16) & 0xFF) * scale + 32768) >> 16;
+    uint32_t g = (((argb >> 8) & 0xFF) * scale + 32768) >> 16;
+    uint32_t b = ((argb & 0xFF) * scale + 32768) >> 16;
+    if (r > 255) r = 255;
+    if (g > 255) g = 255;
+    if (b > 255) b = 255;
+    return (alpha << 24) | (r << 16) | (g << 8) | b;
+}
+
+void premultiply_span(uint32_t* pixels, size_t count) {
+    if (!pixels) return;
+    for (size_t i = 0; i < count; i++) {
+        pixels[i] = premultiply_pixel(pixels[i]);
+    }
+}
+
+void premultiply_render_buffer(render_buffer_t* buffer) {
+    if (!buffer || !buffer->pixels) return;
+    premultiply_span(buffer->pixels, (size_t)buffer->width * buffer->height);
+}
+
+// Scalar path: two channels per 32-bit multiply (blue/red and green/alpha)
+static inline uint32_t blend_pixel_premultiplied(uint32_t src, uint32_t dst) {
+    uint32_t inverse = 255 - (src >> 24);
+    uint32_t rb = (dst & 0x00FF00FF) * inverse + 0x00800080;
+    uint32_t ag = ((dst >> 8) & 0x00FF00FF) * inverse + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return src + rb + ag;
+}
+
+uint32_t blend_premultiplied(uint32_t src, uint32_t dst) {
+    return blend_pixel_premultiplied(src, dst);
+}
+
+static void blend_span_scalar(uint32_t* dst, const uint32_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t alpha = src[i] >> 24;
+        if (alpha == 0xFF) {
+            dst[i] = src[i];
+        } else if (src[i]) {
+            dst[i] = blend_pixel_premultiplied(src[i], dst[i]);
+        }
+    }
+}
+
+// Vector kernels: widen each byte to a 16-bit lane, broadcast 255 - alpha
+// across its pixel's four lanes, multiply, divide by 255 with the
+// add-shift sequence and pack back. xmm5 = 0, xmm6 = 0x00FF, xmm7 = 0x0080.
+#define BLEND_CONSTANTS_SSE2                  \
+    "pxor %%xmm5, %%xmm5\n\t"                 \
+    "pcmpeqw %%xmm6, %%xmm6\n\t"              \
+    "psrlw $8, %%xmm6\n\t"                    \
+    "movdqa %%xmm6, %%xmm7\n\t"               \
+    "psrlw $7, %%xmm7\n\t"                    \
+    "psllw $7, %%xmm7\n\t"
+
+// One half (two pixels) of dst in \dst (words), src words in \src
+#define BLEND_HALF_SSE2(dst, src)                      \
+    "pshuflw $0xFF, %%" src ", %%" src "\n\t"          \
+    "pshufhw $0xFF, %%" src ", %%" src "\n\t"          \
+    "pxor %%xmm6, %%" src "\n\t"                       \
+    "pmullw %%" src ", %%" dst "\n\t"                  \
+    "paddw %%xmm7, %%" dst "\n\t"                      \
+    "movdqa %%" dst ", %%" src "\n\t"                  \
+    "psrlw $8, %%" src "\n\t"                          \
+    "paddw %%" src ", %%" dst "\n\t"                   \
+    "psrlw $8, %%" dst "\n\t"
+
+static void blend_blocks_sse2(uint32_t* dst, const uint32_t* src, size_t blocks) {
+    __asm__ volatile (
+        BLEND_CONSTANTS_SSE2
+        "1:\n\t"
+        "movdqu (%[src]), %%xmm0\n\t"
+        "movdqu (%[dst]), %%xmm1\n\t"
+        "movdqa %%xmm1, %%xmm2\n\t"
+        "punpcklbw %%xmm5, %%xmm1\n\t"
+        "punpckhbw %%xmm5, %%xmm2\n\t"
+        "movdqa %%xmm0, %%xmm3\n\t"
+        "movdqa %%xmm0, %%xmm4\n\t"
+        "punpcklbw %%xmm5, %%xmm3\n\t"
+        "punpckhbw %%xmm5, %%xmm4\n\t"
+        BLEND_HALF_SSE2("xmm1", "xmm3")
+        BLEND_HALF_SSE2("xmm2", "xmm4")
+        "packuswb %%xmm2, %%xmm1\n\t"
+        "paddusb %%xmm0, %%xmm1\n\t"
+        "movdqu %%xmm1, (%[dst])\n\t"
+        "add $16, %[src]\n\t"
+        "add $16, %[dst]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b"
+        : [dst] "+r"(dst), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+// Same sequence on 256-bit registers. The unpacks and packs work within
+// each 128-bit lane, so pixel order survives the round trip.
+#define BLEND_HALF_AVX2(dst, src)                              \
+    "vpshuflw $0xFF, %%" src ", %%" src "\n\t"                 \
+    "vpshufhw $0xFF, %%" src ", %%" src "\n\t"                 \
+    "vpxor %%ymm6, %%" src ", %%" src "\n\t"                   \
+    "vpmullw %%" src ", %%" dst ", %%" dst "\n\t"              \
+    "vpaddw %%ymm7, %%" dst ", %%" dst "\n\t"                  \
+    "vpsrlw $8, %%" dst ", %%" src "\n\t"                      \
+    "vpaddw %%" src ", %%" dst ", %%" dst "\n\t"               \
+    "vpsrlw $8, %%" dst ", %%" dst "\n\t"
+
+static void blend_blocks_avx2(uint32_t* dst, const uint32_t* src, size_t blocks) {
+    __asm__ volatile (
+        "vpxor %%ymm5, %%ymm5, %%ymm5\n\t"
+        "vpcmpeqw %%ymm6, %%ymm6, %%ymm6\n\t"
+        "vpsrlw $8, %%ymm6, %%ymm6\n\t"
+        "vpsrlw $7, %%ymm6, %%ymm7\n\t"
+        "vpsllw $7, %%ymm7, %%ymm7\n\t"
+        "1:\n\t"
+        "vmovdqu (%[src]), %%ymm0\n\t"
+        "vmovdqu (%[dst]), %%ymm1\n\t"
+        "vpunpckhbw %%ymm5, %%ymm1, %%ymm2\n\t"
+        "vpunpcklbw %%ymm5, %%ymm1, %%ymm1\n\t"
+        "vpunpcklbw %%ymm5, %%ymm0, %%ymm3\n\t"
+        "vpunpckhbw %%ymm5, %%ymm0, %%ymm4\n\t"
+        BLEND_HALF_AVX2("ymm1", "ymm3")
+        BLEND_HALF_AVX2("ymm2", "ymm4")
+        "vpackuswb %%ymm2, %%ymm1, %%ymm1\n\t"
+        "vpaddusb %%ymm0, %%ymm1, %%ymm1\n\t"
+        "vmovdqu %%ymm1, (%[dst])\n\t"
+        "add $32, %[src]\n\t"
+        "add $32, %[dst]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : [dst] "+r"(dst), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+void blend_span(uint32_t* dst, const uint32_t* src, size_t count) {
+    if (!dst || !src || count == 0) return;
+
+    uint32_t features = simd_features();
+    size_t done = 0;
+    if ((features & CPU_FEATURE_AVX2) && count >= AVX2_PIXELS) {
+        done = count / AVX2_PIXELS * AVX2_PIXELS;
+        blend_blocks_avx2(dst, src, count / AVX2_PIXELS);
+    } else if ((features & CPU_FEATURE_SSE2) && count >= SSE2_PIXELS) {
+        done = count / SSE2_PIXELS * SSE2_PIXELS;
+        blend_blocks_sse2(dst, src, count / SSE2_PIXELS);
+    }
+    blend_span_scalar(dst + done, src + done, count - done);
+}
+
+void blend_fill_span(uint32_t* dst, uint32_t color, size_t count) {
+    if (!dst || count == 0 || color == 0) return;
+    if ((color >> 24) == 0xFF) {
+        fast_fill(dst, color, count * sizeof(uint32_t));
+        return;
+    }
+
+    uint32_t chunk[FILL_CHUNK];
+    size_t staged = count < FILL_CHUNK ? count : FILL_CHUNK;
+    for (size_t i = 0; i < staged; i++) chunk[i] = color;
+
+    while (count) {
+        size_t n = count < FILL_CHUNK ? count : FILL_CHUNK;
+        blend_span(dst, chunk, n);
+        dst += n;
+        count -= n;
+    }
+}
+
+void blend_rect(render_buffer_t* dst, int32_t dst_x, int32_t dst_y, const render_buffer_t* src,
+                int32_t src_x, int32_t src_y, uint32_t width, uint32_t height) {
+    if (!dst || !src || !dst->pixels || !src->pixels) return;
+
+    // Clip in 64-bit against the source, then the destination
+    int64_t w = width, h = height;
+    if (src_x < 0) { w += src_x; dst_x -= src_x; src_x = 0; }
+    if (src_y < 0) { h += src_y; dst_y -= src_y; src_y = 0; }
+    if (dst_x < 0) { w += dst_x; src_x -= dst_x; dst_x = 0; }
+    if (dst_y < 0) { h += dst_y; src_y -= dst_y; dst_y = 0; }
+    if (w > (int64_t)src->width - src_x) w = (int64_t)src->width - src_x;
+    if (h > (int64_t)src->height - src_y) h = (int64_t)src->height - src_y;
+    if (w > (int64_t)dst->width - dst_x) w = (int64_t)dst->width - dst_x;
+    if (h > (int64_t)dst->height - dst_y) h = (int64_t)dst->height - dst_y;
+    if (w <= 0 || h <= 0) return;
+
+    uint32_t* out = dst->pixels + (size_t)dst_y * dst->width + dst_x;
+    const uint32_t* in = src->pixels + (size_t)src_y * src->width + src_x;
+    for (int64_t row = 0; row < h; row++, out += dst->width, in += src->width) {
+        blend_span(out, in, (size_t)w);
+    }
+    if (dst->damage) damage_add(dst->damage, dst_x, dst_y, (uint32_t)w, (uint32_t)h);
+}
+
+void blend_fill_rect(render_buffer_t* dst, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    if (!dst || !dst->pixels) return;
+
+    int64_t x1 = x < 0 ? 0 : x;
+    int64_t y1 = y < 0 ? 0 : y;
+    int64_t x2 = (int64_t)x + width;
+    int64_t y2 = (int64_t)y + height;
+    if (x2 > dst->width) x2 = dst->width;
+    if (y2 > dst->height) y2 = dst->height;
+    if (x1 >= x2 || y1 >= y2) return;
+
+    uint32_t* row = dst->pixels + (size_t)y1 * dst->width + x1;
+    for (int64_t py = y1; py < y2; py++, row += dst->width) {
+        blend_fill_span(row, color, (size_t)(x2 - x1));
+    }
+    if (dst->damage) damage_add(dst->damage, (int32_t)x1, (int32_t)y1, (uint32_t)(x2 - x1), (uint32_t)(y2 - y1));
+}
@@ -0,0 +1,112 @@
+#include "../../intf/damage.h"
+#include "../../intf/stdint.h"
+
+static inline uint64_t rect_area(const damage_rect_t* r) {
+    return (uint64_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+// Overlapping or sharing an edge - merging these never adds clean pixels
+// along the shared side
+static inline int rects_touch(const damage_rect_t* a, const damage_rect_t* b) {
+    return a->x1 <= b->x2 && b->x1 <= a->x2 && a->y1 <= b->y2 && b->y1 <= a->y2;
+}
+
+static inline damage_rect_t rect_union(const damage_rect_t* a, const damage_rect_t* b) {
+    damage_rect_t r;
+    r.x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    r.y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    r.x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    r.y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+    return r;
+}
+
+static inline void remove_rect(damage_region_t* region, uint32_t index) {
+    region->rects[index] = region->rects[--region->count];
+}
+
+void damage_init(damage_region_t* region, uint32_t width, uint32_t height) {
+    if (!region) return;
+    region->width = width;
+    region->height = height;
+    damage_clear(region);
+}
+
+void damage_clear(damage_region_t* region) {
+    if (!region) return;
+    region->count = 0;
+    region->full = 0;
+}
+
+void damage_add_full(damage_region_t* region) {
+    if (!region) return;
+    region->count = 0;
+    region->full = 1;
+}
+
+void damage_add(damage_region_t* region, int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (!region || region->full || width == 0 || height == 0) return;
+
+    // Clip to the surface in 64-bit so large extents cannot wrap
+    int64_t x1 = x < 0 ? 0 : x;
+    int64_t y1 = y < 0 ? 0 : y;
+    int64_t x2 = (int64_t)x + width;
+    int64_t y2 = (int64_t)y + height;
+    if (x2 > region->width) x2 = region->width;
+    if (y2 > region->height) y2 = region->height;
+    if (x1 >= x2 || y1 >= y2) return;
+
+    damage_rect_t rect = { (uint32_t)x1, (uint32_t)y1, (uint32_t)x2, (uint32_t)y2 };
+
+    for (;;) {
+        // Absorb everything the rectangle touches; a grown rectangle can
+        // reach ones it missed before, so rescan after every merge
+        uint32_t i = 0;
+        while (i < region->count) {
+            if (rects_touch(&region->rects[i], &rect)) {
+                rect = rect_union(&region->rects[i], &rect);
+                remove_rect(region, i);
+                i = 0;
+            } else {
+                i++;
+            }
+        }
+
+        if (region->count < DAMAGE_MAX_RECTS) {
+            region->rects[region->count++] = rect;
+            return;
+        }
+
+        // List full: merge with the rectangle whose union wastes the least
+        uint32_t best = 0;
+        uint64_t best_growth = (uint64_t)-1;
+        for (i = 0; i < region->count; i++) {
+            damage_rect_t merged = rect_union(&region->rects[i], &rect);
+            uint64_t growth = rect_area(&merged) - rect_area(&region->rects[i]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
+            }
+        }
+        rect = rect_union(&region->rects[best], &rect);
+        remove_rect(region, best);
+    }
+}
+
+uint64_t damage_area(const damage_region_t* region) {
+    if (!region) return 0;
+    if (region->full) return (uint64_t)region->width * region->height;
+
+    uint64_t area = 0;
+    for (uint32_t i = 0; i < region->count; i++) {
+        area += rect_area(&region->rects[i]);
+    }
+    return area;
+}
+
+int damage_prefers_full(const damage_region_t* region) {
+    if (!region) return 0;
+    if (region->full) return 1;
+
+    uint64_t surface = (uint64_t)region->width * region->height;
+    return damage_area(region) * 100 >= surface * DAMAGE_FULL_PERCENT;
+}
@@ -0,0 +1,580 @@
+#include "../../intf/display_list.h"
+#include "../../intf/glyph_cache.h"
+#include "../../intf/damage.h"
+#include "../../intf/graphics.h"
+#include "../../intf/palette.h"
+#include "../../intf/mm.h"
+#include "../../intf/benchmark.h"
+#include "../../intf/pit.h"
+#include "../../intf/cpu.h"
+#include "../../intf/stdint.h"
+
+// Tile bins are a counting sort of (tile, op) pairs: one start offset per
+// tile followed by 16-bit op numbers, in recording order within each tile.
+// Record calls keep enough of the arena free for a single whole-target bin,
+// so a flush can always fall back to one tile when the real grid's bins do
+// not fit.
+#define CULLED_OP 0xFFFF
+
+typedef struct {
+    int32_t x1, y1, x2, y2;
+} box_t;
+
+static inline display_op_t* list_ops(display_list_t* list) {
+    return (display_op_t*)list->arena;
+}
+
+static inline size_t bin_bytes(uint32_t tiles, uint32_t entries) {
+    return (size_t)(tiles + 1) * sizeof(uint32_t) + (size_t)entries * sizeof(uint16_t);
+}
+
+// Room for one more op (plus text) while still leaving a one-tile bin
+static int has_room(const display_list_t* list, size_t text) {
+    if (list->op_count >= DISPLAY_MAX_OPS) return 0;
+    size_t used = (size_t)(list->op_count + 1) * sizeof(display_op_t) + list->text_bytes + text +
+                  bin_bytes(1, list->op_count + 1);
+    return used <= list->arena_size;
+}
+
+display_list_t* display_list_create(size_t arena_size) {
+    display_list_t* list = (display_list_t*)kmalloc(sizeof(display_list_t));
+    if (!list) return 0;
+
+    list->arena = (uint8_t*)kmalloc(arena_size);
+    if (!list->arena) {
+        kfree(list);
+        return 0;
+    }
+    list->arena_size = arena_size;
+    display_list_reset(list);
+    return list;
+}
+
+void display_list_destroy(display_list_t* list) {
+    if (!list) return;
+    kfree(list->arena);
+    kfree(list);
+}
+
+void display_list_reset(display_list_t* list) {
+    if (!list) return;
+    list->op_count = 0;
+    list->text_bytes = 0;
+    list->merged_fills = 0;
+}
+
+static display_op_t* append_op(display_list_t* list, uint32_t type, uint32_t color,
+                               int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    display_op_t* op = &list_ops(list)[list->op_count++];
+    op->type = type;
+    op->color = color;
+    op->x1 = x1;
+    op->y1 = y1;
+    op->x2 = x2;
+    op->y2 = y2;
+    return op;
+}
+
+// Fold a fill into the previous op when both are fills of one colour and
+// together form a rectangle (or the new one adds nothing)
+static int merge_fill(display_list_t* list, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+    if (list->op_count == 0) return 0;
+    display_op_t* last = &list_ops(list)[list->op_count - 1];
+    if (last->type != DISPLAY_OP_FILL || last->color != color) return 0;
+
+    if (x1 >= last->x1 && y1 >= last->y1 && x2 <= last->x2 && y2 <= last->y2) {
+        // Already covered
+    } else if (last->x1 == x1 && last->x2 == x2 && (last->y2 == y1 || y2 == last->y1)) {
+        if (y1 < last->y1) last->y1 = y1;
+        if (y2 > last->y2) last->y2 = y2;
+    } else if (last->y1 == y1 && last->y2 == y2 && (last->x2 == x1 || x2 == last->x1)) {
+        if (x1 < last->x1) last->x1 = x1;
+        if (x2 > last->x2) last->x2 = x2;
+    } else {
+        return 0;
+    }
+    list->merged_fills++;
+    return 1;
+}
+
+int display_list_fill_rect(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    if (!list) return 0;
+    if (width == 0 || height == 0) return 1;
+
+    int32_t x2 = x + (int32_t)width;
+    int32_t y2 = y + (int32_t)height;
+    if (merge_fill(list, x, y, x2, y2, color)) return 1;
+    if (!has_room(list, 0)) return 0;
+    append_op(list, DISPLAY_OP_FILL, color, x, y, x2, y2);
+    return 1;
+}
+
+int display_list_draw_rect(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    if (!list) return 0;
+    if (width == 0 || height == 0) return 1;
+
+    int ok = display_list_fill_rect(list, x, y, width, 1, color);
+    if (height > 1) ok &= display_list_fill_rect(list, x, y + (int32_t)height - 1, width, 1, color);
+    if (height > 2) {
+        ok &= display_list_fill_rect(list, x, y + 1, 1, height - 2, color);
+        if (width > 1) ok &= display_list_fill_rect(list, x + (int32_t)width - 1, y + 1, 1, height - 2, color);
+    }
+    return ok;
+}
+
+int display_list_draw_line(display_list_t* list, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+    if (!list || !has_room(list, 0)) return 0;
+
+    display_op_t* op = append_op(list, DISPLAY_OP_LINE, color,
+                                 x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2,
+                                 (x1 > x2 ? x1 : x2) + 1, (y1 > y2 ? y1 : y2) + 1);
+    op->data.line.x1 = x1;
+    op->data.line.y1 = y1;
+    op->data.line.x2 = x2;
+    op->data.line.y2 = y2;
+    return 1;
+}
+
+int display_list_draw_text(display_list_t* list, int32_t x, int32_t y, const char* str, uint32_t color) {
+    if (!list || !str) return 0;
+
+    size_t length = 0;
+    while (str[length]) length++;
+    if (length == 0) return 1;
+    if (!has_room(list, length + 1)) return 0;
+
+    list->text_bytes += length + 1;
+    char* copy = (char*)(list->arena + list->arena_size - list->text_bytes);
+    for (size_t i = 0; i <= length; i++) {
+        copy[i] = str[i];
+    }
+
+    uint32_t width, height;
+    glyph_text_extent(copy, &width, &height);
+    display_op_t* op = append_op(list, DISPLAY_OP_TEXT, color, x, y, x + (int32_t)width, y + (int32_t)height);
+    op->data.text = copy;
+    return 1;
+}
+
+int display_list_fill_circle(display_list_t* list, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color) {
+    if (!list || !has_room(list, 0)) return 0;
+
+    display_op_t* op = append_op(list, DISPLAY_OP_CIRCLE, color,
+                                 center_x - (int32_t)radius, center_y - (int32_t)radius,
+                                 center_x + (int32_t)radius + 1, center_y + (int32_t)radius + 1);
+    op->data.circle.x = center_x;
+    op->data.circle.y = center_y;
+    op->data.circle.radius = radius;
+    return 1;
+}
+
+int display_list_fill_triangle(display_list_t* list, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                               int32_t x3, int32_t y3, uint32_t color) {
+    if (!list || !has_room(list, 0)) return 0;
+
+    // Pixel centres sit half a pixel in from the corners, so the column at
+    // the largest x (and the row at the largest y) is never covered
+    int32_t min_x = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+    int32_t min_y = y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3);
+    int32_t max_x = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+    int32_t max_y = y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3);
+    if (min_x == max_x || min_y == max_y) return 1;
+
+    display_op_t* op = append_op(list, DISPLAY_OP_TRIANGLE, color, min_x, min_y, max_x, max_y);
+    op->data.triangle.x[0] = x1;
+    op->data.triangle.y[0] = y1;
+    op->data.triangle.x[1] = x2;
+    op->data.triangle.y[1] = y2;
+    op->data.triangle.x[2] = x3;
+    op->data.triangle.y[2] = y3;
+    return 1;
+}
+
+static int record_image(display_list_t* list, uint32_t type, const uint32_t* pixels, uint32_t stride,
+                        int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (!list || !pixels) return 0;
+    if (width == 0 || height == 0) return 1;
+    if (!has_room(list, 0)) return 0;
+
+    display_op_t* op = append_op(list, type, 0, x, y, x + (int32_t)width, y + (int32_t)height);
+    op->data.image.pixels = pixels;
+    op->data.image.stride = stride;
+    return 1;
+}
+
+int display_list_blit(display_list_t* list, const uint32_t* pixels, uint32_t stride,
+                      int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    return record_image(list, DISPLAY_OP_BLIT, pixels, stride, x, y, width, height);
+}
+
+int display_list_blend(display_list_t* list, const uint32_t* pixels, uint32_t stride,
+                       int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    return record_image(list, DISPLAY_OP_BLEND, pixels, stride, x, y, width, height);
+}
+
+// Flush
+
+static inline int intersect(const display_op_t* op, const box_t* clip, box_t* out) {
+    out->x1 = op->x1 > clip->x1 ? op->x1 : clip->x1;
+    out->y1 = op->y1 > clip->y1 ? op->y1 : clip->y1;
+    out->x2 = op->x2 < clip->x2 ? op->x2 : clip->x2;
+    out->y2 = op->y2 < clip->y2 ? op->y2 : clip->y2;
+    return out->x1 < out->x2 && out->y1 < out->y2;
+}
+
+static inline uint64_t box_area(const box_t* box) {
+    return (uint64_t)(box->x2 - box->x1) * (uint64_t)(box->y2 - box->y1);
+}
+
+static inline int box_contains(const box_t* outer, const box_t* inner) {
+    return inner->x1 >= outer->x1 && inner->y1 >= outer->y1 && inner->x2 <= outer->x2 && inner->y2 <= outer->y2;
+}
+
+// Pixels the op writes when drawn on its own. Lines count their full
+// length; text counts its character cells; circles and triangles count
+// their area, capped at the visible box.
+static uint64_t immediate_pixels(const display_op_t* op, const box_t* visible) {
+    uint64_t area;
+    switch (op->type) {
+        case DISPLAY_OP_LINE: {
+            int32_t dx = op->data.line.x2 - op->data.line.x1;
+            int32_t dy = op->data.line.y2 - op->data.line.y1;
+            if (dx < 0) dx = -dx;
+            if (dy < 0) dy = -dy;
+            return (uint64_t)(dx > dy ? dx : dy) + 1;
+        }
+        case DISPLAY_OP_CIRCLE: {
+            uint64_t diameter = 2 * (uint64_t)op->data.circle.radius + 1;
+            area = diameter * diameter * 355 / 452; // pi / 4
+            break;
+        }
+        case DISPLAY_OP_TRIANGLE: {
+            const int32_t* x = op->data.triangle.x;
+            const int32_t* y = op->data.triangle.y;
+            int64_t cross = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+            area = (uint64_t)(cross < 0 ? -cross : cross) / 2;
+            break;
+        }
+        default:
+            return box_area(visible);
+    }
+    return area < box_area(visible) ? area : box_area(visible);
+}
+
+// Fills and blits replace everything under them
+static inline int is_opaque(const display_op_t* op) {
+    return op->type == DISPLAY_OP_FILL || op->type == DISPLAY_OP_BLIT;
+}
+
+static uint64_t run_op(const display_op_t* op, const raster_target_t* tile) {
+    const pixel_format_t* format = tile->format;
+    box_t clip = { tile->clip_x1, tile->clip_y1, tile->clip_x2, tile->clip_y2 };
+    box_t box;
+
+    switch (op->type) {
+        case DISPLAY_OP_LINE:
+            return raster_draw_line(tile, op->data.line.x1, op->data.line.y1, op->data.line.x2, op->data.line.y2, op->color);
+        case DISPLAY_OP_CIRCLE:
+            return raster_fill_circle(tile, op->data.circle.x, op->data.circle.y, op->data.circle.radius, op->color);
+        case DISPLAY_OP_TRIANGLE:
+            return raster_fill_triangle(tile, op->data.triangle.x[0], op->data.triangle.y[0],
+                                        op->data.triangle.x[1], op->data.triangle.y[1],
+                                        op->data.triangle.x[2], op->data.triangle.y[2], op->color);
+    }
+    if (!intersect(op, &clip, &box)) return 0;
+
+    uint32_t width = (uint32_t)(box.x2 - box.x1);
+    uint8_t* dst = tile->pixels + (size_t)box.y1 * tile->pitch + (size_t)box.x1 * format->bytes_per_pixel;
+
+    switch (op->type) {
+        case DISPLAY_OP_FILL:
+            for (int32_t y = box.y1; y < box.y2; y++, dst += tile->pitch) {
+                format->fill_span(dst, width, op->color);
+            }
+            break;
+
+        case DISPLAY_OP_TEXT: {
+            glyph_target_t glyphs = { tile->pixels, tile->pitch, format,
+                                      tile->clip_x1, tile->clip_y1, tile->clip_x2, tile->clip_y2 };
+            uint32_t text_width, text_height;
+            glyph_draw_text(&glyphs, op->x1, op->y1, op->data.text, op->color, &text_width, &text_height);
+            break;
+        }
+
+        case DISPLAY_OP_BLIT:
+        case DISPLAY_OP_BLEND: {
+            const uint32_t* src = op->data.image.pixels + (size_t)(box.y1 - op->y1) * op->data.image.stride + (box.x1 - op->x1);
+            for (int32_t y = box.y1; y < box.y2; y++, dst += tile->pitch, src += op->data.image.stride) {
+                if (op->type == DISPLAY_OP_BLEND) {
+                    format->blend_span(dst, src, width);
+                } else if (format->bpp == COLOR_DEPTH_8BIT) {
+                    palette_convert_span(dst, src, width, (uint32_t)box.x1, (uint32_t)y);
+                } else {
+                    format->convert_span(dst, src, width);
+                }
+            }
+            break;
+        }
+    }
+    return box_area(&box);
+}
+
+// Walk a tile's ops newest first, dropping any op that lies entirely inside
+// an opaque op recorded after it. Occluders are kept as their part inside
+// the tile; when the table is full the smallest one gives way.
+static uint32_t cull_tile(const display_op_t* ops, uint16_t* entries, uint32_t count, const box_t* tile) {
+    box_t occluders[DISPLAY_MAX_OCCLUDERS];
+    uint32_t occluder_count = 0;
+    uint32_t culled = 0;
+
+    for (uint32_t i = count; i-- > 0;) {
+        const display_op_t* op = &ops[entries[i]];
+        box_t box;
+        intersect(op, tile, &box);
+
+        int hidden = 0;
+        for (uint32_t j = 0; j < occluder_count && !hidden; j++) {
+            hidden = box_contains(&occluders[j], &box);
+        }
+        if (hidden) {
+            entries[i] = CULLED_OP;
+            culled++;
+            continue;
+        }
+        if (!is_opaque(op)) continue;
+
+        if (occluder_count < DISPLAY_MAX_OCCLUDERS) {
+            occluders[occluder_count++] = box;
+        } else {
+            uint32_t smallest = 0;
+            for (uint32_t j = 1; j < occluder_count; j++) {
+                if (box_area(&occluders[j]) < box_area(&occluders[smallest])) smallest = j;
+            }
+            if (box_area(&box) > box_area(&occluders[smallest])) occluders[smallest] = box;
+        }
+    }
+    return culled;
+}
+
+// One tile's worth of a flush: cull, then run the survivors clipped to the
+// tile, adding to the job's totals
+typedef struct {
+    const display_op_t* ops;
+    uint16_t* entries;
+    const uint32_t* tile_end;
+    const raster_target_t* target;
+    box_t clip;
+    uint32_t columns;
+    uint32_t tile_size;
+    uint32_t culled;
+    uint32_t tiles;
+    uint64_t pixels_written;
+} tile_job_t;
+
+static void run_tile(uint32_t t, tile_job_t* job) {
+    uint32_t start = t == 0 ? 0 : job->tile_end[t - 1];
+    uint32_t count = job->tile_end[t] - start;
+    if (count == 0) return;
+
+    box_t tile;
+    tile.x1 = job->clip.x1 + (int32_t)((t % job->columns) * job->tile_size);
+    tile.y1 = job->clip.y1 + (int32_t)((t / job->columns) * job->tile_size);
+    tile.x2 = tile.x1 + (int32_t)job->tile_size < job->clip.x2 ? tile.x1 + (int32_t)job->tile_size : job->clip.x2;
+    tile.y2 = tile.y1 + (int32_t)job->tile_size < job->clip.y2 ? tile.y1 + (int32_t)job->tile_size : job->clip.y2;
+
+    uint32_t culled = cull_tile(job->ops, job->entries + start, count, &tile);
+
+    raster_target_t tile_target = *job->target;
+    tile_target.clip_x1 = tile.x1;
+    tile_target.clip_y1 = tile.y1;
+    tile_target.clip_x2 = tile.x2;
+    tile_target.clip_y2 = tile.y2;
+    uint64_t written = 0;
+    int ran = 0;
+    for (uint32_t i = start; i < start + count; i++) {
+        if (job->entries[i] == CULLED_OP) continue;
+        written += run_op(&job->ops[job->entries[i]], &tile_target);
+        ran = 1;
+    }
+
+    job->culled += culled;
+    job->tiles += (uint32_t)ran;
+    job->pixels_written += written;
+}
+
+void display_list_flush(display_list_t* list, const raster_target_t* target, damage_region_t* damage,
+                        display_list_stats_t* stats) {
+    display_list_stats_t local;
+    if (!stats) stats = &local;
+    stats->ops = list ? list->op_count : 0;
+    stats->merged_fills = list ? list->merged_fills : 0;
+    stats->culled = 0;
+    stats->tiles = 0;
+    stats->pixels_immediate = 0;
+    stats->pixels_written = 0;
+    if (!list) return;
+
+    box_t clip = { target->clip_x1, target->clip_y1, target->clip_x2, target->clip_y2 };
+    if (clip.x1 >= clip.x2 || clip.y1 >= clip.y2 || list->op_count == 0) {
+        display_list_reset(list);
+        return;
+    }
+
+    display_op_t* ops = list_ops(list);
+    uint32_t clip_width = (uint32_t)(clip.x2 - clip.x1);
+    uint32_t clip_height = (uint32_t)(clip.y2 - clip.y1);
+    uint8_t* gap = list->arena + (size_t)list->op_count * sizeof(display_op_t);
+    size_t gap_size = list->arena_size - (size_t)list->op_count * sizeof(display_op_t) - list->text_bytes;
+
+    // Count (tile, op) pairs for the real grid; fall back to one tile
+    // covering the whole clip if their bins would not fit
+    uint32_t tile_size = DISPLAY_TILE_SIZE;
+    uint32_t columns, rows, pairs;
+    for (;;) {
+        columns = (clip_width + tile_size - 1) / tile_size;
+        rows = (clip_height + tile_size - 1) / tile_size;
+        pairs = 0;
+        for (uint32_t i = 0; i < list->op_count; i++) {
+            box_t box;
+            if (!intersect(&ops[i], &clip, &box)) continue;
+            pairs += ((uint32_t)(box.x2 - 1 - clip.x1) / tile_size - (uint32_t)(box.x1 - clip.x1) / tile_size + 1) *
+                     ((uint32_t)(box.y2 - 1 - clip.y1) / tile_size - (uint32_t)(box.y1 - clip.y1) / tile_size + 1);
+        }
+        if (bin_bytes(columns * rows, pairs) <= gap_size || columns * rows == 1) break;
+        tile_size = clip_width > clip_height ? clip_width : clip_height;
+    }
+
+    uint32_t tiles = columns * rows;
+    uint32_t* tile_end = (uint32_t*)gap;
+    uint16_t* entries = (uint16_t*)(tile_end + tiles + 1);
+    for (uint32_t t = 0; t <= tiles; t++) {
+        tile_end[t] = 0;
+    }
+
+    // Counting sort: per-tile counts, prefix sums, then scatter in recording
+    // order. Scattering advances tile_end[t] from the tile's start to its end.
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < list->op_count; i++) {
+            box_t box;
+            if (!intersect(&ops[i], &clip, &box)) continue;
+            if (pass == 0) {
+                stats->pixels_immediate += immediate_pixels(&ops[i], &box);
+                if (damage) damage_add(damage, box.x1, box.y1, (uint32_t)(box.x2 - box.x1), (uint32_t)(box.y2 - box.y1));
+            }
+
+            uint32_t tx1 = (uint32_t)(box.x1 - clip.x1) / tile_size;
+            uint32_t tx2 = (uint32_t)(box.x2 - 1 - clip.x1) / tile_size;
+            uint32_t ty1 = (uint32_t)(box.y1 - clip.y1) / tile_size;
+            uint32_t ty2 = (uint32_t)(box.y2 - 1 - clip.y1) / tile_size;
+            for (uint32_t ty = ty1; ty <= ty2; ty++) {
+                for (uint32_t tx = tx1; tx <= tx2; tx++) {
+                    uint32_t t = ty * columns + tx;
+                    if (pass == 0) {
+                        tile_end[t + 1]++;
+                    } else {
+                        entries[tile_end[t]++] = (uint16_t)i;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (uint32_t t = 1; t <= tiles; t++) {
+                tile_end[t] += tile_end[t - 1];
+            }
+        }
+    }
+
+    tile_job_t job = { ops, entries, tile_end, target, clip, columns, tile_size, 0, 0, 0 };
+    for (uint32_t t = 0; t < tiles; t++) {
+        run_tile(t, &job);
+    }
+    stats->culled = job.culled;
+    stats->tiles = job.tiles;
+    stats->pixels_written = job.pixels_written;
+
+    display_list_reset(list);
+}
+
+// Benchmark: one frame of random primitives drawn two ways
+
+#define BENCH_FRAMES 4
+#define BENCH_ARENA (256 * 1024)
+
+// The same sequence every call, so each path draws an identical frame
+static void record_bench_scene(display_list_t* list) {
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < DISPLAY_BENCH_PRIMITIVES; i++) {
+        int32_t x = (int32_t)(bench_random(&seed) % DISPLAY_BENCH_WIDTH);
+        int32_t y = (int32_t)(bench_random(&seed) % DISPLAY_BENCH_HEIGHT);
+        int32_t size = 8 + (int32_t)(bench_random(&seed) % 120);
+        uint32_t color = 0xFF000000 | bench_random(&seed);
+
+        switch (i % 4) {
+            case 0:
+                display_list_fill_rect(list, x - size / 2, y - size / 2, (uint32_t)size, (uint32_t)(size * 3 / 4), color);
+                break;
+            case 1:
+                display_list_fill_circle(list, x, y, (uint32_t)size / 2, color);
+                break;
+            case 2:
+                display_list_fill_triangle(list, x, y - size / 2, x + size / 2, y + size / 2, x - size / 2, y + size / 3, color);
+                break;
+            default:
+                display_list_draw_line(list, x, y, x + size - 64, y + 64 - size, color);
+                break;
+        }
+    }
+}
+
+// Every op in recording order over the whole target, as the software
+// pipeline draws without a list
+static uint64_t run_immediate(display_list_t* list, const raster_target_t* target) {
+    uint64_t pixels = 0;
+    for (uint32_t i = 0; i < list->op_count; i++) {
+        pixels += run_op(&list_ops(list)[i], target);
+    }
+    display_list_reset(list);
+    return pixels;
+}
+
+int display_list_benchmark(display_list_benchmark_t* result) {
+    uint64_t hz = pit_tsc_hz();
+    if (!result || !hz) return 0;
+
+    raster_target_t target;
+    render_buffer_t* buffer = bench_create_buffer(DISPLAY_BENCH_WIDTH, DISPLAY_BENCH_HEIGHT, &target);
+    display_list_t* list = display_list_create(BENCH_ARENA);
+    if (!buffer || !list) {
+        display_list_destroy(list);
+        destroy_render_buffer(buffer);
+        return 0;
+    }
+
+    // Interleave the paths so each sees the others' cache leftovers alike;
+    // recording is left out of the timing
+    uint64_t cycles[2] = { 0, 0 };
+    uint64_t pixels = 0;
+    display_list_stats_t stats;
+    for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        for (int path = 0; path < 2; path++) {
+            record_bench_scene(list);
+            uint64_t start = rdtsc();
+            if (path == 0) {
+                pixels += run_immediate(list, &target);
+            } else {
+                display_list_flush(list, &target, 0, &stats);
+            }
+            cycles[path] += rdtsc() - start;
+        }
+    }
+
+    result->tiles = stats.tiles;
+    result->pixels_immediate = pixels / BENCH_FRAMES;
+    result->pixels_written = stats.pixels_written;
+    result->immediate_pixels_per_second = bench_pixels_per_second(pixels, cycles[0], hz);
+    result->tiled_pixels_per_second = bench_pixels_per_second(pixels, cycles[1], hz);
+
+    display_list_destroy(list);
+    destroy_render_buffer(buffer);
+    return 1;
+}
@@ -0,0 +1,233 @@
+#include "../../intf/glyph_cache.h"
+#include "../../intf/font.h"
+#include "../../intf/stdint.h"
+
+#define FONT_FIRST_CHAR 32
+#define FONT_LAST_CHAR 126
+
+static glyph_t cache[GLYPH_CACHE_SETS][GLYPH_CACHE_WAYS];
+static uint32_t use_clock = 0;
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+
+static inline uint32_t set_index(uint8_t c, uint32_t color) {
+    // Characters spread across sets; the colour nudges them so two common
+    // colours of the same string do not fight over one set
+    return (c ^ (color * 0x9E3779B1U >> 27)) & (GLYPH_CACHE_SETS - 1);
+}
+
+static void expand_glyph(glyph_t* glyph, uint8_t c, uint32_t color, const pixel_format_t* format) {
+    const uint8_t* bitmap = font_8x8[c - FONT_FIRST_CHAR];
+
+    glyph->c = c;
+    glyph->color = color;
+    glyph->format = format;
+    glyph->valid = 1;
+
+    // Bit 7 is the leftmost pixel
+    for (uint32_t row = 0; row < GLYPH_HEIGHT; row++) {
+        uint8_t bits = bitmap[row];
+        uint8_t count = 0;
+        uint32_t col = 0;
+        while (col < GLYPH_WIDTH) {
+            if (!(bits & (0x80 >> col))) {
+                col++;
+                continue;
+            }
+            uint32_t start = col;
+            while (col < GLYPH_WIDTH && (bits & (0x80 >> col))) col++;
+            glyph->runs[row][count].start = (uint8_t)start;
+            glyph->runs[row][count].length = (uint8_t)(col - start);
+            count++;
+        }
+        glyph->run_count[row] = count;
+    }
+
+    format->fill_span(glyph->span, GLYPH_WIDTH, color);
+}
+
+const glyph_t* glyph_cache_lookup(char c, uint32_t color, const pixel_format_t* format) {
+    uint8_t ch = (uint8_t)c;
+    if (!format || ch < FONT_FIRST_CHAR || ch > FONT_LAST_CHAR) return 0;
+
+    glyph_t* set = cache[set_index(ch, color)];
+    glyph_t* victim = &set[0];
+    use_clock++;
+
+    for (uint32_t way = 0; way < GLYPH_CACHE_WAYS; way++) {
+        glyph_t* glyph = &set[way];
+        if (glyph->valid && glyph->c == ch && glyph->color == color && glyph->format == format) {
+            glyph->last_used = use_clock;
+            cache_hits++;
+            return glyph;
+        }
+        // Prefer an empty way, otherwise the least recently used one
+        if (victim->valid && (!glyph->valid || glyph->last_used < victim->last_used)) {
+            victim = glyph;
+        }
+    }
+
+    cache_misses++;
+    expand_glyph(victim, ch, color, format);
+    victim->last_used = use_clock;
+    return victim;
+}
+
+// Store a run of identical pixels copied from the expanded span
+static inline void store_run(uint8_t* dst, const uint8_t* span, uint32_t count, uint32_t bytes_per_pixel) {
+    switch (bytes_per_pixel) {
+        case 4: {
+            uint32_t value = *(const uint32_t*)span;
+            for (uint32_t i = 0; i < count; i++) ((uint32_t*)dst)[i] = value;
+            break;
+        }
+        case 2: {
+            uint16_t value = *(const uint16_t*)span;
+            for (uint32_t i = 0; i < count; i++) ((uint16_t*)dst)[i] = value;
+            break;
+        }
+        case 1: {
+            uint8_t value = span[0];
+            for (uint32_t i = 0; i < count; i++) dst[i] = value;
+            break;
+        }
+        default:
+            for (uint32_t i = 0; i < count * bytes_per_pixel; i++) dst[i] = span[i];
+            break;
+    }
+}
+
+void glyph_draw(const glyph_t* glyph, const glyph_target_t* target, int32_t x, int32_t y) {
+    if (!glyph || !target || !target->pixels) return;
+
+    uint32_t bpp = target->format->bytes_per_pixel;
+    int32_t first_row = target->clip_y1 > y ? target->clip_y1 - y : 0;
+    int32_t last_row = target->clip_y2 - y < GLYPH_HEIGHT ? target->clip_y2 - y : GLYPH_HEIGHT;
+    if (first_row >= last_row || x >= target->clip_x2 || x + GLYPH_WIDTH <= target->clip_x1) return;
+
+    uint8_t* line = target->pixels + (int64_t)(y + first_row) * target->pitch;
+    int fully_inside = x >= target->clip_x1 && x + GLYPH_WIDTH <= target->clip_x2;
+
+    for (int32_t row = first_row; row < last_row; row++, line += target->pitch) {
+        const glyph_run_t* runs = glyph->runs[row];
+        for (uint32_t i = 0; i < glyph->run_count[row]; i++) {
+            int32_t start = x + runs[i].start;
+            int32_t end = start + runs[i].length;
+            if (!fully_inside) {
+                if (start < target->clip_x1) start = target->clip_x1;
+                if (end > target->clip_x2) end = target->clip_x2;
+                if (start >= end) continue;
+            }
+            store_run(line + (int64_t)start * bpp, glyph->span, (uint32_t)(end - start), bpp);
+        }
+    }
+}
+
+void glyph_draw_line(const glyph_t* const* glyphs, uint32_t count, const glyph_target_t* target, int32_t x, int32_t y) {
+    if (!glyphs || count == 0 || !target || !target->pixels) return;
+
+    uint32_t bpp = target->format->bytes_per_pixel;
+    int32_t first_row = target->clip_y1 > y ? target->clip_y1 - y : 0;
+    int32_t last_row = target->clip_y2 - y < GLYPH_HEIGHT ? target->clip_y2 - y : GLYPH_HEIGHT;
+    if (first_row >= last_row) return;
+
+    // Visible glyph range, and the part of it that needs no per-run clipping
+    int64_t line_end = (int64_t)x + (int64_t)count * GLYPH_WIDTH;
+    if (x >= target->clip_x2 || line_end <= target->clip_x1) return;
+
+    uint32_t first = x < target->clip_x1 ? (uint32_t)((target->clip_x1 - x) / GLYPH_WIDTH) : 0;
+    uint32_t last = line_end > target->clip_x2 ? (uint32_t)((target->clip_x2 - x + GLYPH_WIDTH - 1) / GLYPH_WIDTH) : count;
+    uint32_t inner_first = x < target->clip_x1 ? (uint32_t)((target->clip_x1 - x + GLYPH_WIDTH - 1) / GLYPH_WIDTH) : 0;
+    uint32_t inner_last = line_end > target->clip_x2 ? (uint32_t)((target->clip_x2 - x) / GLYPH_WIDTH) : count;
+
+    uint8_t* line = target->pixels + (int64_t)(y + first_row) * target->pitch;
+    for (int32_t row = first_row; row < last_row; row++, line += target->pitch) {
+        for (uint32_t g = first; g < last; g++) {
+            const glyph_t* glyph = glyphs[g];
+            if (!glyph) continue;
+
+            int32_t glyph_x = x + (int32_t)(g * GLYPH_WIDTH);
+            int clip = g < inner_first || g >= inner_last;
+            const glyph_run_t* runs = glyph->runs[row];
+            for (uint32_t i = 0; i < glyph->run_count[row]; i++) {
+                int32_t start = glyph_x + runs[i].start;
+                int32_t end = start + runs[i].length;
+                if (clip) {
+                    if (start < target->clip_x1) start = target->clip_x1;
+                    if (end > target->clip_x2) end = target->clip_x2;
+                    if (start >= end) continue;
+                }
+                store_run(line + (int64_t)start * bpp, glyph->span, (uint32_t)(end - start), bpp);
+            }
+        }
+    }
+}
+
+// Longest run of characters handed to glyph_draw_line at once
+#define TEXT_BATCH_CHARS 64
+
+// Lay out a string on any glyph target, one batched glyph line per text
+// line. Returns the extent drawn so callers can mark damage.
+// A batch uses a single colour, so at most three printable characters share
+// a cache set and none of its glyphs can be evicted while it is built.
+void glyph_draw_text(const glyph_target_t* target, int32_t x, int32_t y, const char* str, uint32_t color,
+                     uint32_t* width, uint32_t* height) {
+    const glyph_t* batch[TEXT_BATCH_CHARS];
+    uint32_t batch_count = 0;
+    int32_t batch_x = x;
+    uint32_t line_chars = 0;
+    uint32_t max_chars = 0;
+    int32_t current_y = y;
+
+    for (;; str++) {
+        if (*str == '\0' || *str == '\n' || batch_count == TEXT_BATCH_CHARS) {
+            glyph_draw_line(batch, batch_count, target, batch_x, current_y);
+            batch_x += (int32_t)(batch_count * GLYPH_WIDTH);
+            batch_count = 0;
+            if (line_chars > max_chars) max_chars = line_chars;
+            if (*str == '\0') break;
+            if (*str == '\n') {
+                current_y += GLYPH_LINE_HEIGHT;
+                batch_x = x;
+                line_chars = 0;
+                continue;
+            }
+        }
+        batch[batch_count++] = glyph_cache_lookup(*str, color, target->format);
+        line_chars++;
+    }
+
+    *width = max_chars * GLYPH_WIDTH;
+    *height = (uint32_t)(current_y - y) + GLYPH_HEIGHT;
+}
+
+void glyph_text_extent(const char* str, uint32_t* width, uint32_t* height) {
+    uint32_t lines = 1;
+    uint32_t line_chars = 0;
+    uint32_t max_chars = 0;
+
+    for (; *str; str++) {
+        if (*str == '\n') {
+            lines++;
+            line_chars = 0;
+            continue;
+        }
+        if (++line_chars > max_chars) max_chars = line_chars;
+    }
+
+    *width = max_chars * GLYPH_WIDTH;
+    *height = (lines - 1) * GLYPH_LINE_HEIGHT + GLYPH_HEIGHT;
+}
+
+void glyph_cache_flush(void) {
+    for (uint32_t set = 0; set < GLYPH_CACHE_SETS; set++) {
+        for (uint32_t way = 0; way < GLYPH_CACHE_WAYS; way++) {
+            cache[set][way].valid = 0;
+        }
+    }
+}
+
+void glyph_cache_stats(uint32_t* hits, uint32_t* misses) {
+    if (hits) *hits = cache_hits;
+    if (misses) *misses = cache_misses;
+}
@@ -0,0 +1,158 @@
+#include "../../intf/palette.h"
+#include "../../intf/ports.h"
+#include "../../intf/stdint.h"
+
+// The cube is separable, so the nearest cube entry is just each channel
+// rounded to its own level count. The lookup table adds the grey ramp on
+// top, which leaves a single table load per pixel at conversion time.
+#define DAC_WRITE_INDEX 0x3C8
+#define DAC_DATA        0x3C9
+
+#define DITHER_SIZE   4
+#define DITHER_MARGIN 32 // Dither offsets stay under half a cube step (25)
+#define QUANT_SIZE    (256 + 2 * DITHER_MARGIN)
+
+uint8_t palette_lut[PALETTE_LUT_SIZE];
+uint32_t palette_colors[PALETTE_SIZE];
+
+static const uint8_t bayer4[DITHER_SIZE * DITHER_SIZE] = {
+     0,  8,  2, 10,
+    12,  4, 14,  6,
+     3, 11,  1,  9,
+    15,  7, 13,  5
+};
+
+// Per-channel threshold offsets, in 8-bit units, for each Bayer cell
+static int32_t dither_r[DITHER_SIZE * DITHER_SIZE];
+static int32_t dither_g[DITHER_SIZE * DITHER_SIZE];
+static int32_t dither_b[DITHER_SIZE * DITHER_SIZE];
+
+// Clamp a dithered channel and reduce it to the table's 5 bits in one load
+static uint8_t quantize5[QUANT_SIZE];
+
+static int lut_built = 0;
+static int dither_enabled = 1;
+
+static inline uint32_t level_value(uint32_t level, uint32_t levels) {
+    return (level * 255 + (levels - 1) / 2) / (levels - 1);
+}
+
+static inline uint32_t color_distance(uint32_t a, uint32_t b) {
+    int32_t dr = (int32_t)((a >> 16) & 0xFF) - (int32_t)((b >> 16) & 0xFF);
+    int32_t dg = (int32_t)((a >> 8) & 0xFF) - (int32_t)((b >> 8) & 0xFF);
+    int32_t db = (int32_t)(a & 0xFF) - (int32_t)(b & 0xFF);
+    return (uint32_t)(2 * dr * dr + 4 * dg * dg + 3 * db * db);
+}
+
+static void build_colors(void) {
+    for (uint32_t r = 0; r < PALETTE_R_LEVELS; r++) {
+        for (uint32_t g = 0; g < PALETTE_G_LEVELS; g++) {
+            for (uint32_t b = 0; b < PALETTE_B_LEVELS; b++) {
+                palette_colors[(r * PALETTE_G_LEVELS + g) * PALETTE_B_LEVELS + b] =
+                    (level_value(r, PALETTE_R_LEVELS) << 16) |
+                    (level_value(g, PALETTE_G_LEVELS) << 8) |
+                    level_value(b, PALETTE_B_LEVELS);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < PALETTE_GREY_LEVELS; i++) {
+        uint32_t v = level_value(i + 1, PALETTE_GREY_LEVELS + 2);
+        palette_colors[PALETTE_GREY_BASE + i] = (v << 16) | (v << 8) | v;
+    }
+}
+
+static uint8_t nearest_index(uint32_t r, uint32_t g, uint32_t b) {
+    uint32_t color = (r << 16) | (g << 8) | b;
+    uint32_t best = PALETTE_LEVEL(r, PALETTE_R_LEVELS) * (PALETTE_G_LEVELS * PALETTE_B_LEVELS) +
+                    PALETTE_LEVEL(g, PALETTE_G_LEVELS) * PALETTE_B_LEVELS +
+                    PALETTE_LEVEL(b, PALETTE_B_LEVELS);
+
+    // Only the ramp step nearest the mean can beat the cube
+    uint32_t grey = PALETTE_LEVEL((r + g + b) / 3, PALETTE_GREY_LEVELS + 2);
+    if (grey >= 1 && grey <= PALETTE_GREY_LEVELS) {
+        uint32_t candidate = PALETTE_GREY_BASE + grey - 1;
+        if (color_distance(color, palette_colors[candidate]) < color_distance(color, palette_colors[best])) {
+            best = candidate;
+        }
+    }
+    return (uint8_t)best;
+}
+
+static void build_tables(void) {
+    build_colors();
+
+    // Each 5-bit cell is looked up at its centre
+    for (uint32_t i = 0; i < PALETTE_LUT_SIZE; i++) {
+        uint32_t r = ((i >> 10) << 3) | 4;
+        uint32_t g = (((i >> 5) & 0x1F) << 3) | 4;
+        uint32_t b = ((i & 0x1F) << 3) | 4;
+        palette_lut[i] = nearest_index(r, g, b);
+    }
+
+    // Offsets span one cube step, centred on zero, less one table cell so
+    // the rounding of the 5-bit lookup never pushes an exact entry away
+    int32_t step_r = 255 / (PALETTE_R_LEVELS - 1) - 8;
+    int32_t step_g = 255 / (PALETTE_G_LEVELS - 1) - 8;
+    int32_t step_b = 255 / (PALETTE_B_LEVELS - 1) - 8;
+    for (uint32_t i = 0; i < DITHER_SIZE * DITHER_SIZE; i++) {
+        int32_t cell = 2 * bayer4[i] + 1;
+        dither_r[i] = cell * step_r / 32 - step_r / 2;
+        dither_g[i] = cell * step_g / 32 - step_g / 2;
+        dither_b[i] = cell * step_b / 32 - step_b / 2;
+    }
+
+    for (int32_t i = 0; i < QUANT_SIZE; i++) {
+        int32_t v = i - DITHER_MARGIN;
+        if (v < 0) v = 0;
+        if (v > 255) v = 255;
+        quantize5[i] = (uint8_t)(v >> 3);
+    }
+}
+
+void palette_init(void) {
+    if (!lut_built) {
+        build_tables();
+        lut_built = 1;
+    }
+
+    // The DAC auto-increments after each blue write; it takes 6-bit values
+    outb(DAC_WRITE_INDEX, 0);
+    for (uint32_t i = 0; i < PALETTE_SIZE; i++) {
+        uint32_t color = palette_colors[i];
+        outb(DAC_DATA, (uint8_t)(((color >> 16) & 0xFF) >> 2));
+        outb(DAC_DATA, (uint8_t)(((color >> 8) & 0xFF) >> 2));
+        outb(DAC_DATA, (uint8_t)((color & 0xFF) >> 2));
+    }
+}
+
+void palette_set_dither(int enabled) {
+    dither_enabled = enabled;
+}
+
+int palette_dither_enabled(void) {
+    return dither_enabled;
+}
+
+void palette_convert_span(uint8_t* dst, const uint32_t* src, uint32_t count, uint32_t x, uint32_t y) {
+    if (!dither_enabled) {
+        for (uint32_t i = 0; i < count; i++) {
+            dst[i] = palette_index(src[i]);
+        }
+        return;
+    }
+
+    // One row of the Bayer matrix applies to the whole span
+    const int32_t* row_r = &dither_r[(y % DITHER_SIZE) * DITHER_SIZE];
+    const int32_t* row_g = &dither_g[(y % DITHER_SIZE) * DITHER_SIZE];
+    const int32_t* row_b = &dither_b[(y % DITHER_SIZE) * DITHER_SIZE];
+    const uint8_t* quant = quantize5 + DITHER_MARGIN;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t cell = (x + i) % DITHER_SIZE;
+        uint32_t c = src[i];
+        uint32_t r = quant[(int32_t)((c >> 16) & 0xFF) + row_r[cell]];
+        uint32_t g = quant[(int32_t)((c >> 8) & 0xFF) + row_g[cell]];
+        uint32_t b = quant[(int32_t)(c & 0xFF) + row_b[cell]];
+        dst[i] = palette_lut[(r << 10) | (g << 5) | b];
+    }
+}
@@ -0,0 +1,138 @@
+#include "../../intf/pixel_format.h"
+#include "../../intf/graphics.h"
+#include "../../intf/stdint.h"
+#include "../../intf/simd.h"
+#include "../../intf/palette.h"
+#include "../../intf/blend.h"
+
+// Each format supplies load/store for one pixel and pack/unpack between its
+// encoding and 0xAARRGGBB. The DEFINE_* macros stamp out the span kernels
+// around them, so every format gets its own specialised loops instead of a
+// per-pixel switch on the depth. Fills and copies go to the vector kernels.
+// Blending takes premultiplied sources, the same convention as blend.c.
+
+// 8bpp: indices into the fixed palette (see palette.c). Colours pack
+// through the RGB lookup table and unpack to the palette entry, so blending
+// works in RGB like the other formats.
+static inline uint32_t load_index8(const uint8_t* p) { return *p; }
+static inline void store_index8(uint8_t* p, uint32_t v) { *p = (uint8_t)v; }
+static inline uint32_t pack_index8(uint32_t c) { return palette_index(c); }
+static inline uint32_t unpack_index8(uint32_t v) { return palette_colors[v & 0xFF]; }
+
+// 16bpp: RGB 5:6:5
+static inline uint32_t load_rgb565(const uint8_t* p) { return *(const uint16_t*)p; }
+static inline void store_rgb565(uint8_t* p, uint32_t v) { *(uint16_t*)p = (uint16_t)v; }
+static inline uint32_t pack_rgb565(uint32_t c) {
+    return ((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F);
+}
+static inline uint32_t unpack_rgb565(uint32_t v) {
+    uint32_t r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+    return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+// 24bpp: packed little-endian 0xRRGGBB (blue in the lowest byte)
+static inline uint32_t load_rgb888(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+static inline void store_rgb888(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+}
+static inline uint32_t pack_rgb888(uint32_t c) { return c & 0xFFFFFF; }
+static inline uint32_t unpack_rgb888(uint32_t v) { return v; }
+
+// 32bpp: 0x00RRGGBB
+static inline uint32_t load_xrgb8888(const uint8_t* p) { return *(const uint32_t*)p; }
+static inline void store_xrgb8888(uint8_t* p, uint32_t v) { *(uint32_t*)p = v; }
+static inline uint32_t pack_xrgb8888(uint32_t c) { return c & 0xFFFFFF; }
+static inline uint32_t unpack_xrgb8888(uint32_t v) { return v; }
+
+// Formats whose pixels tile a 4-byte word fill through the vector kernels
+#define DEFINE_PATTERN_FILL(name, bytes, pattern)                                       \
+    static void name##_fill_span(uint8_t* dst, uint32_t count, uint32_t color) {        \
+        fast_fill(dst, pattern(color), count * (bytes));                                \
+    }
+
+#define DEFINE_STORE_FILL(name, bytes)                                                  \
+    static void name##_fill_span(uint8_t* dst, uint32_t count, uint32_t color) {        \
+        for (uint32_t i = 0; i < count; i++) {                                          \
+            store_##name(dst + i * (bytes), color);                                     \
+        }                                                                               \
+    }
+
+#define DEFINE_COPY_SPAN(name, bytes)                                                   \
+    static void name##_copy_span(uint8_t* dst, const uint8_t* src, uint32_t count) {   \
+        fast_copy(dst, src, count * (bytes));                                           \
+    }
+
+#define DEFINE_CONVERT_SPAN(name, bytes)                                                \
+    static void name##_convert_span(uint8_t* dst, const uint32_t* src, uint32_t count) { \
+        for (uint32_t i = 0; i < count; i++) {                                          \
+            store_##name(dst + i * (bytes), pack_##name(src[i]));                       \
+        }                                                                               \
+    }
+
+#define DEFINE_BLEND_SPAN(name, bytes)                                                  \
+    static void name##_blend_span(uint8_t* dst, const uint32_t* src, uint32_t count) {  \
+        for (uint32_t i = 0; i < count; i++) {                                          \
+            if (src[i] == 0) continue;                                                  \
+            uint8_t* pixel = dst + i * (bytes);                                         \
+            uint32_t color = (src[i] >> 24) == 255 ? src[i]                             \
+                : BLEND_##name(src[i], load_##name(pixel));                             \
+            store_##name(pixel, pack_##name(color));                                    \
+        }                                                                               \
+    }
+
+#define DEFINE_PIXEL_FORMAT(name, depth, bytes)                                         \
+    static const pixel_format_t name##_format = {                                       \
+        depth, bytes,                                                                   \
+        name##_fill_span, name##_copy_span, name##_convert_span, name##_blend_span      \
+    };
+
+#define BLEND_index8(src, dst) (blend_premultiplied(src, unpack_index8(dst)) & 0xFFFFFF)
+#define BLEND_rgb565(src, dst) (blend_premultiplied(src, unpack_rgb565(dst)) & 0xFFFFFF)
+#define BLEND_rgb888(src, dst) (blend_premultiplied(src, unpack_rgb888(dst)) & 0xFFFFFF)
+
+#define PATTERN_index8(color) (((color) & 0xFF) * 0x01010101U)
+#define PATTERN_rgb565(color) (((color) & 0xFFFF) * 0x00010001U)
+#define PATTERN_xrgb8888(color) (color)
+
+DEFINE_PATTERN_FILL(index8, 1, PATTERN_index8)
+DEFINE_COPY_SPAN(index8, 1)
+DEFINE_CONVERT_SPAN(index8, 1)
+DEFINE_BLEND_SPAN(index8, 1)
+DEFINE_PIXEL_FORMAT(index8, COLOR_DEPTH_8BIT, 1)
+
+DEFINE_PATTERN_FILL(rgb565, 2, PATTERN_rgb565)
+DEFINE_COPY_SPAN(rgb565, 2)
+DEFINE_CONVERT_SPAN(rgb565, 2)
+DEFINE_BLEND_SPAN(rgb565, 2)
+DEFINE_PIXEL_FORMAT(rgb565, COLOR_DEPTH_16BIT, 2)
+
+DEFINE_STORE_FILL(rgb888, 3)
+DEFINE_COPY_SPAN(rgb888, 3)
+DEFINE_CONVERT_SPAN(rgb888, 3)
+DEFINE_BLEND_SPAN(rgb888, 3)
+DEFINE_PIXEL_FORMAT(rgb888, COLOR_DEPTH_24BIT, 3)
+
+// The X byte is ignored by the display, so ARGB sources copy straight through
+static void xrgb8888_convert_span(uint8_t* dst, const uint32_t* src, uint32_t count) {
+    fast_copy(dst, src, count * sizeof(uint32_t));
+}
+
+// The screen's pixel layout is blend.c's, so spans take its vector kernels
+static void xrgb8888_blend_span(uint8_t* dst, const uint32_t* src, uint32_t count) {
+    blend_span((uint32_t*)dst, src, count);
+}
+
+DEFINE_PATTERN_FILL(xrgb8888, 4, PATTERN_xrgb8888)
+DEFINE_COPY_SPAN(xrgb8888, 4)
+DEFINE_PIXEL_FORMAT(xrgb8888, COLOR_DEPTH_32BIT, 4)
+
+const pixel_format_t* pixel_format_for_depth(uint32_t bpp) {
+    switch (bpp) {
+        case COLOR_DEPTH_16BIT: return &rgb565_format;
+        case COLOR_DEPTH_24BIT: return &rgb888_format;
+        case COLOR_DEPTH_32BIT: return &xrgb8888_format;
+        default:                return &index8_format;
+    }
+}
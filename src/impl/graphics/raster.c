@@ -0,0 +1,479 @@
+#include "../../intf/raster.h"
+#include "../../intf/graphics.h"
+#include "../../intf/benchmark.h"
+#include "../../intf/pit.h"
+#include "../../intf/cpu.h"
+#include "../../intf/stdint.h"
+
+#define FIXED_ONE  (1LL << RASTER_FIXED_SHIFT)
+#define FIXED_HALF (FIXED_ONE >> 1)
+
+typedef struct {
+    int32_t y_start;   // First scanline (inclusive)
+    int32_t y_end;     // Last scanline (exclusive)
+    int64_t x;         // Crossing at the current scanline centre, 16.16 rounded down
+    int64_t step;      // Change in x per scanline, 16.16 rounded down
+    int64_t error;     // What x was rounded down by, in 1/denominator units
+    int64_t error_step;
+    int64_t denominator;
+    int32_t winding;   // +1 downwards, -1 upwards
+} edge_t;
+
+typedef struct {
+    int64_t x;
+    int32_t winding;
+} crossing_t;
+
+// First pixel whose centre is at or right of a 16.16 coordinate, so a span
+// [left, right) covers the centres in [left, right) - the top-left rule in x
+static inline int32_t fixed_to_pixel(int64_t x) {
+    return (int32_t)((x + FIXED_HALF - 1) >> RASTER_FIXED_SHIFT);
+}
+
+static inline uint64_t fill_span(const raster_target_t* target, int32_t y, int32_t x1, int32_t x2, uint32_t color) {
+    if (y < target->clip_y1 || y >= target->clip_y2) return 0;
+    if (x1 < target->clip_x1) x1 = target->clip_x1;
+    if (x2 > target->clip_x2) x2 = target->clip_x2;
+    if (x1 >= x2) return 0;
+
+    uint8_t* row = target->pixels + (int64_t)y * target->pitch;
+    target->format->fill_span(row + (int64_t)x1 * target->format->bytes_per_pixel, (uint32_t)(x2 - x1), color);
+    return (uint64_t)(x2 - x1);
+}
+
+static inline int64_t floor_div(int64_t n, int64_t d) {
+    int64_t q = n / d;
+    return n % d < 0 ? q - 1 : q;
+}
+
+// Start an edge at the centre of scanline y. The crossing is kept as an
+// exact fraction and stepped without rounding drift, so an edge clipped to
+// start lower (a tile, a window) crosses every row where the whole edge
+// does and neighbouring clips meet without seams.
+static inline void edge_start(edge_t* edge, const raster_point_t* top, const raster_point_t* bottom, int32_t y) {
+    int64_t dx = (int64_t)(bottom->x - top->x) * FIXED_ONE;
+    int64_t denominator = 2 * (int64_t)(bottom->y - top->y);
+    int64_t numerator = dx * (2 * (int64_t)(y - top->y) + 1);
+
+    edge->x = (int64_t)top->x * FIXED_ONE + floor_div(numerator, denominator);
+    edge->error = numerator - floor_div(numerator, denominator) * denominator;
+    edge->step = floor_div(2 * dx, denominator);
+    edge->error_step = 2 * dx - edge->step * denominator;
+    edge->denominator = denominator;
+}
+
+uint64_t raster_fill_polygon(const raster_target_t* target, const raster_point_t* points, uint32_t count, uint32_t color) {
+    if (!target || !target->pixels || !points || count < 3 || count > RASTER_MAX_VERTICES) return 0;
+
+    edge_t edges[RASTER_MAX_VERTICES];
+    uint32_t edge_count = 0;
+    int32_t y_min = target->clip_y2;
+    int32_t y_max = target->clip_y1;
+
+    // Edge table: non-horizontal edges, oriented top to bottom. Scanline y is
+    // covered when its centre y + 0.5 lies in [top, bottom), which makes
+    // the rows [top.y, bottom.y) for pixel-corner vertices.
+    for (uint32_t i = 0; i < count; i++) {
+        const raster_point_t* a = &points[i];
+        const raster_point_t* b = &points[(i + 1) % count];
+        if (a->y == b->y) continue;
+
+        const raster_point_t* top = a->y < b->y ? a : b;
+        const raster_point_t* bottom = a->y < b->y ? b : a;
+        int32_t first = top->y > target->clip_y1 ? top->y : target->clip_y1;
+        int32_t last = bottom->y < target->clip_y2 ? bottom->y : target->clip_y2;
+        if (first >= last) continue;
+
+        edge_t edge;
+        edge.y_start = first;
+        edge.y_end = last;
+        edge_start(&edge, top, bottom, first);
+        edge.winding = a->y < b->y ? 1 : -1;
+
+        // Insertion sort by first scanline
+        uint32_t j = edge_count++;
+        while (j > 0 && edges[j - 1].y_start > edge.y_start) {
+            edges[j] = edges[j - 1];
+            j--;
+        }
+        edges[j] = edge;
+
+        if (first < y_min) y_min = first;
+        if (last > y_max) y_max = last;
+    }
+    if (edge_count == 0) return 0;
+
+    uint32_t active[RASTER_MAX_VERTICES];
+    uint32_t active_count = 0;
+    uint32_t next_edge = 0;
+    uint64_t written = 0;
+
+    for (int32_t y = y_min; y < y_max; y++) {
+        // Retire finished edges, then activate the ones starting here
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < active_count; i++) {
+            if (edges[active[i]].y_end > y) active[kept++] = active[i];
+        }
+        active_count = kept;
+        while (next_edge < edge_count && edges[next_edge].y_start <= y) {
+            active[active_count++] = next_edge++;
+        }
+
+        // Crossings sorted by x
+        crossing_t crossings[RASTER_MAX_VERTICES];
+        for (uint32_t i = 0; i < active_count; i++) {
+            const edge_t* edge = &edges[active[i]];
+            uint32_t j = i;
+            while (j > 0 && crossings[j - 1].x > edge->x) {
+                crossings[j] = crossings[j - 1];
+                j--;
+            }
+            crossings[j].x = edge->x;
+            crossings[j].winding = edge->winding;
+        }
+
+        // Non-zero winding: inside wherever the running sum is not zero
+        int32_t winding = 0;
+        int64_t span_start = 0;
+        for (uint32_t i = 0; i < active_count; i++) {
+            int32_t before = winding;
+            winding += crossings[i].winding;
+            if (before == 0 && winding != 0) {
+                span_start = crossings[i].x;
+            } else if (before != 0 && winding == 0) {
+                written += fill_span(target, y, fixed_to_pixel(span_start), fixed_to_pixel(crossings[i].x), color);
+            }
+        }
+
+        for (uint32_t i = 0; i < active_count; i++) {
+            edge_t* edge = &edges[active[i]];
+            edge->x += edge->step;
+            edge->error += edge->error_step;
+            if (edge->error >= edge->denominator) {
+                edge->x++;
+                edge->error -= edge->denominator;
+            }
+        }
+    }
+    return written;
+}
+
+uint64_t raster_fill_triangle(const raster_target_t* target, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                              int32_t x3, int32_t y3, uint32_t color) {
+    raster_point_t points[3] = { { x1, y1 }, { x2, y2 }, { x3, y3 } };
+    return raster_fill_polygon(target, points, 3, color);
+}
+
+// Largest dx with dx^2 + dy^2 <= r^2 + r, starting from a known upper bound.
+// The +r matches the midpoint circle outline, so fills line up with it.
+static inline int32_t circle_half_width(int32_t dx, int32_t dy, int64_t limit) {
+    while (dx > 0 && (int64_t)dx * dx + (int64_t)dy * dy > limit) dx--;
+    return dx;
+}
+
+uint64_t raster_fill_circle(const raster_target_t* target, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color) {
+    if (!target || !target->pixels) return 0;
+
+    int32_t r = (int32_t)radius;
+    int64_t limit = (int64_t)r * r + r;
+    int32_t dx = r;
+    uint64_t written = 0;
+
+    // One span per row; the half width only shrinks moving away from the
+    // centre, so the whole circle costs O(radius) beyond the fills
+    for (int32_t dy = 0; dy <= r; dy++) {
+        dx = circle_half_width(dx, dy, limit);
+        written += fill_span(target, center_y + dy, center_x - dx, center_x + dx + 1, color);
+        if (dy) written += fill_span(target, center_y - dy, center_x - dx, center_x + dx + 1, color);
+    }
+    return written;
+}
+
+uint64_t raster_fill_rounded_rect(const raster_target_t* target, int32_t x, int32_t y, uint32_t width, uint32_t height,
+                                  uint32_t radius, uint32_t color) {
+    if (!target || !target->pixels || width == 0 || height == 0) return 0;
+
+    uint32_t shorter = width < height ? width : height;
+    int32_t r = (int32_t)(radius < shorter / 2 ? radius : shorter / 2);
+    int32_t right = x + (int32_t)width;
+    int64_t limit = (int64_t)r * r + r;
+    int32_t dx = 0;
+    uint64_t written = 0;
+
+    // Corner rows, mirrored top and bottom. The arcs widen towards the
+    // straight section, so dx only grows.
+    for (int32_t dy = r; dy >= 1; dy--) {
+        while (dx < r && (int64_t)(dx + 1) * (dx + 1) + (int64_t)dy * dy <= limit) dx++;
+        int32_t inset = r - dx;
+        written += fill_span(target, y + r - dy, x + inset, right - inset, color);
+        written += fill_span(target, y + (int32_t)height - 1 - (r - dy), x + inset, right - inset, color);
+    }
+
+    // Straight section, clipped vertically once
+    int32_t first = y + r > target->clip_y1 ? y + r : target->clip_y1;
+    int32_t last = y + (int32_t)height - r < target->clip_y2 ? y + (int32_t)height - r : target->clip_y2;
+    for (int32_t row = first; row < last; row++) {
+        written += fill_span(target, row, x, right, color);
+    }
+    return written;
+}
+
+void raster_clip_to(raster_target_t* target, int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (!target) return;
+
+    int64_t x2 = (int64_t)x + width;
+    int64_t y2 = (int64_t)y + height;
+    if (x > target->clip_x1) target->clip_x1 = x;
+    if (y > target->clip_y1) target->clip_y1 = y;
+    if (x2 < target->clip_x2) target->clip_x2 = (int32_t)x2;
+    if (y2 < target->clip_y2) target->clip_y2 = (int32_t)y2;
+    // An empty intersection leaves x1 >= x2 and every fill rejects it
+}
+
+static inline void store_pixel(uint8_t* dst, uint32_t bytes_per_pixel, const pixel_format_t* format, uint32_t color) {
+    switch (bytes_per_pixel) {
+        case 4: *(uint32_t*)dst = color; break;
+        case 2: *(uint16_t*)dst = (uint16_t)color; break;
+        case 1: *dst = (uint8_t)color; break;
+        default: format->fill_span(dst, 1, color); break;
+    }
+}
+
+// Range of steps k in [0, length] for which start + dir * k stays inside
+// [low, high). Returns 0 if there is none.
+static inline int clip_steps(int64_t start, int32_t dir, int64_t length, int64_t low, int64_t high,
+                             int64_t* first, int64_t* last) {
+    int64_t lo, hi;
+    if (dir > 0) {
+        lo = low - start;
+        hi = high - 1 - start;
+    } else {
+        lo = start - (high - 1);
+        hi = start - low;
+    }
+    if (lo < 0) lo = 0;
+    if (hi > length) hi = length;
+    *first = lo;
+    *last = hi;
+    return lo <= hi;
+}
+
+uint64_t raster_draw_line(const raster_target_t* target, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+    if (!target || !target->pixels) return 0;
+    if (target->clip_x1 >= target->clip_x2 || target->clip_y1 >= target->clip_y2) return 0;
+
+    // Fast paths straight to span fills
+    if (y1 == y2) {
+        int32_t left = x1 < x2 ? x1 : x2;
+        int32_t right = x1 < x2 ? x2 : x1;
+        return fill_span(target, y1, left, right + 1, color);
+    }
+
+    uint32_t bpp = target->format->bytes_per_pixel;
+    if (x1 == x2) {
+        if (x1 < target->clip_x1 || x1 >= target->clip_x2) return 0;
+        int32_t top = y1 < y2 ? y1 : y2;
+        int32_t bottom = y1 < y2 ? y2 : y1;
+        if (top < target->clip_y1) top = target->clip_y1;
+        if (bottom >= target->clip_y2) bottom = target->clip_y2 - 1;
+        if (top > bottom) return 0;
+
+        uint8_t* pixel = target->pixels + (int64_t)top * target->pitch + (int64_t)x1 * bpp;
+        for (int32_t y = top; y <= bottom; y++, pixel += target->pitch) {
+            store_pixel(pixel, bpp, target->format, color);
+        }
+        return (uint64_t)(bottom - top + 1);
+    }
+
+    // General case as major/minor axes. Bresenham visits
+    //   major = major1 + major_dir * k,  minor = minor1 + minor_dir * m(k)
+    // for k = 0..major_len, where with e0 = major_len / 2 the minor step count
+    // is m(k) = ceil((k * minor_len - e0) / major_len) and the error term
+    // stays in [0, major_len). That makes the line a function of one integer
+    // parameter, so it is clipped Liang-Barsky style by solving for the k
+    // range that keeps both coordinates inside the clip rectangle - exactly,
+    // and without changing which pixels are lit.
+    int64_t dx = (int64_t)x2 - x1;
+    int64_t dy = (int64_t)y2 - y1;
+    int64_t dx_abs = dx < 0 ? -dx : dx;
+    int64_t dy_abs = dy < 0 ? -dy : dy;
+    int x_major = dx_abs > dy_abs;
+
+    int64_t major1 = x_major ? x1 : y1;
+    int64_t minor1 = x_major ? y1 : x1;
+    int32_t major_dir = (x_major ? dx : dy) < 0 ? -1 : 1;
+    int32_t minor_dir = (x_major ? dy : dx) < 0 ? -1 : 1;
+    int64_t major_len = x_major ? dx_abs : dy_abs;
+    int64_t minor_len = x_major ? dy_abs : dx_abs;
+    int64_t major_low = x_major ? target->clip_x1 : target->clip_y1;
+    int64_t major_high = x_major ? target->clip_x2 : target->clip_y2;
+    int64_t minor_low = x_major ? target->clip_y1 : target->clip_x1;
+    int64_t minor_high = x_major ? target->clip_y2 : target->clip_x2;
+    int64_t e0 = major_len / 2;
+
+    int64_t k_first, k_last, m_first, m_last;
+    if (!clip_steps(major1, major_dir, major_len, major_low, major_high, &k_first, &k_last)) return 0;
+    if (!clip_steps(minor1, minor_dir, minor_len, minor_low, minor_high, &m_first, &m_last)) return 0;
+
+    // m(k) >= m_first  <=>  k >= floor(((m_first - 1) * major_len + e0) / minor_len) + 1
+    // m(k) <= m_last   <=>  k <= floor((m_last * major_len + e0) / minor_len)
+    if (m_first > 0) {
+        int64_t k = ((m_first - 1) * major_len + e0) / minor_len + 1;
+        if (k > k_first) k_first = k;
+    }
+    int64_t k_limit = (m_last * major_len + e0) / minor_len;
+    if (k_limit < k_last) k_last = k_limit;
+    if (k_first > k_last) return 0;
+
+    // Resume the error term at the first visible step
+    int64_t m = (k_first * minor_len - e0 + major_len - 1) / major_len;
+    int64_t err = e0 - k_first * minor_len + m * major_len;
+
+    int64_t x = x_major ? major1 + major_dir * k_first : minor1 + minor_dir * m;
+    int64_t y = x_major ? minor1 + minor_dir * m : major1 + major_dir * k_first;
+    int64_t x_step = (int64_t)(dx < 0 ? -1 : 1) * bpp;
+    int64_t y_step = (int64_t)(dy < 0 ? -1 : 1) * target->pitch;
+    int64_t major_step = x_major ? x_step : y_step;
+    int64_t minor_step = x_major ? y_step : x_step;
+
+    uint8_t* pixel = target->pixels + y * target->pitch + x * bpp;
+    store_pixel(pixel, bpp, target->format, color);
+    for (int64_t k = k_first; k < k_last; k++) {
+        err -= minor_len;
+        if (err < 0) {
+            pixel += minor_step;
+            err += major_len;
+        }
+        pixel += major_step;
+        store_pixel(pixel, bpp, target->format, color);
+    }
+    return (uint64_t)(k_last - k_first + 1);
+}
+
+// Benchmark against the previous per-pixel path: spans drawn as Bresenham
+// lines that bounds-check and store one pixel at a time
+
+#define BENCH_WIDTH 320
+#define BENCH_HEIGHT 200
+#define BENCH_ITERATIONS 64
+
+static void legacy_line(render_buffer_t* buffer, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+    int32_t dx = x2 - x1;
+    int32_t dy = y2 - y1;
+    int32_t dx_abs = dx < 0 ? -dx : dx;
+    int32_t dy_abs = dy < 0 ? -dy : dy;
+    int32_t sx = dx < 0 ? -1 : 1;
+    int32_t sy = dy < 0 ? -1 : 1;
+    int32_t steps = dx_abs > dy_abs ? dx_abs : dy_abs;
+    int32_t err = steps / 2;
+
+    for (int32_t i = 0; i <= steps; i++) {
+        if (x1 >= 0 && y1 >= 0 && x1 < (int32_t)buffer->width && y1 < (int32_t)buffer->height) {
+            buffer->pixels[y1 * buffer->width + x1] = color;
+        }
+        err -= dx_abs > dy_abs ? dy_abs : dx_abs;
+        if (err < 0) {
+            if (dx_abs > dy_abs) y1 += sy; else x1 += sx;
+            err += steps;
+        }
+        if (dx_abs > dy_abs) x1 += sx; else y1 += sy;
+    }
+}
+
+static void legacy_fill_circle(render_buffer_t* buffer, int32_t center_x, int32_t center_y, int32_t radius, uint32_t color) {
+    int32_t x = radius;
+    int32_t y = 0;
+    int32_t err = 0;
+
+    while (x >= y) {
+        legacy_line(buffer, center_x - x, center_y + y, center_x + x, center_y + y, color);
+        legacy_line(buffer, center_x - x, center_y - y, center_x + x, center_y - y, color);
+        legacy_line(buffer, center_x - y, center_y + x, center_x + y, center_y + x, color);
+        legacy_line(buffer, center_x - y, center_y - x, center_x + y, center_y - x, color);
+
+        if (err <= 0) {
+            y += 1;
+            err += 2 * y + 1;
+        }
+        if (err > 0) {
+            x -= 1;
+            err -= 2 * x + 1;
+        }
+    }
+}
+
+// Sorted-vertex scanline fill with the edges stepped per row
+static void legacy_fill_triangle(render_buffer_t* buffer, raster_point_t a, raster_point_t b, raster_point_t c, uint32_t color) {
+    raster_point_t t;
+    if (a.y > b.y) { t = a; a = b; b = t; }
+    if (b.y > c.y) { t = b; b = c; c = t; }
+    if (a.y > b.y) { t = a; a = b; b = t; }
+    if (a.y == c.y) return;
+
+    for (int32_t y = a.y; y <= c.y; y++) {
+        int32_t long_x = a.x + (c.x - a.x) * (y - a.y) / (c.y - a.y);
+        int32_t short_x;
+        if (y < b.y) {
+            short_x = a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y);
+        } else if (c.y != b.y) {
+            short_x = b.x + (c.x - b.x) * (y - b.y) / (c.y - b.y);
+        } else {
+            short_x = b.x;
+        }
+        legacy_line(buffer, long_x, y, short_x, y, color);
+    }
+}
+
+uint32_t raster_benchmark(raster_benchmark_t* results, uint32_t max_results) {
+    uint64_t hz = pit_tsc_hz();
+    if (!results || max_results == 0 || !hz) return 0;
+
+    raster_target_t target;
+    render_buffer_t* buffer = bench_create_buffer(BENCH_WIDTH, BENCH_HEIGHT, &target);
+    if (!buffer) return 0;
+
+    raster_point_t tri[3] = { { 20, 10 }, { 300, 60 }, { 90, 190 } };
+    raster_point_t hexagon[6] = { { 160, 10 }, { 250, 55 }, { 250, 145 }, { 160, 190 }, { 70, 145 }, { 70, 55 } };
+    uint32_t count = 0;
+
+    for (uint32_t shape = 0; shape < RASTER_BENCH_SHAPES && count < max_results; shape++) {
+        uint64_t pixels = 0;
+        uint64_t start = rdtsc();
+        for (uint32_t n = 0; n < BENCH_ITERATIONS; n++) {
+            uint32_t color = 0xFF000000 | (n * 0x010203);
+            if (shape == 0) {
+                pixels += raster_fill_polygon(&target, tri, 3, color);
+            } else if (shape == 1) {
+                pixels += raster_fill_circle(&target, 160, 100, 90, color);
+            } else {
+                pixels += raster_fill_polygon(&target, hexagon, 6, color);
+            }
+        }
+        uint64_t span_cycles = rdtsc() - start;
+
+        start = rdtsc();
+        for (uint32_t n = 0; n < BENCH_ITERATIONS; n++) {
+            uint32_t color = 0xFF000000 | (n * 0x010203);
+            if (shape == 0) {
+                legacy_fill_triangle(buffer, tri[0], tri[1], tri[2], color);
+            } else if (shape == 1) {
+                legacy_fill_circle(buffer, 160, 100, 90, color);
+            } else {
+                for (uint32_t i = 1; i + 1 < 6; i++) {
+                    legacy_fill_triangle(buffer, hexagon[0], hexagon[i], hexagon[i + 1], color);
+                }
+            }
+        }
+        uint64_t legacy_cycles = rdtsc() - start;
+
+        static const char* const names[RASTER_BENCH_SHAPES] = { "triangle", "circle", "hexagon" };
+        results[count].shape = names[shape];
+        // Both paths cover (about) the same area, so rate them on one count
+        results[count].span_pixels_per_second = bench_pixels_per_second(pixels, span_cycles, hz);
+        results[count].legacy_pixels_per_second = bench_pixels_per_second(pixels, legacy_cycles, hz);
+        count++;
+    }
+
+    destroy_render_buffer(buffer);
+    return count;
+}
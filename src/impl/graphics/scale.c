@@ -0,0 +1,280 @@
+#include "../../intf/scale.h"
+#include "../../intf/graphics.h"
+#include "../../intf/palette.h"
+#include "../../intf/simd.h"
+#include "../../intf/stdint.h"
+
+// The destination is processed in column chunks of SCALE_CHUNK_PIXELS. For
+// each chunk the rows are walked top to bottom: a source row is resampled
+// horizontally into a 32-bit strip only when the destination row maps to a
+// new one, then the strip is converted into the framebuffer. Bilinear keeps
+// the two source rows it is blending between and mixes them per row.
+#define FIXED_ONE (1 << SCALE_FIXED_SHIFT)
+#define FIXED_HALF (FIXED_ONE / 2)
+
+static uint32_t strip_a[SCALE_CHUNK_PIXELS];
+static uint32_t strip_b[SCALE_CHUNK_PIXELS];
+static uint32_t strip_out[SCALE_CHUNK_PIXELS];
+
+// (a * (256 - f) + b * f) >> 8 on two channels at a time; each 16-bit
+// field holds at most 255 * 256, so nothing carries into its neighbour
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t f) {
+    uint32_t rb = ((((a & 0xFF00FF) * (256 - f)) + ((b & 0xFF00FF) * f)) >> 8) & 0xFF00FF;
+    uint32_t ag = ((((a >> 8) & 0xFF00FF) * (256 - f)) + (((b >> 8) & 0xFF00FF) * f)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+static uint8_t* target_address(const scale_target_t* target, uint32_t x, uint32_t y) {
+    return target->pixels + (size_t)y * target->pitch + (size_t)x * target->format->bytes_per_pixel;
+}
+
+// Store a finished 32-bit strip; 8bpp goes through the dithered quantiser
+static void emit_strip(const scale_target_t* target, uint32_t x, uint32_t y, const uint32_t* strip, uint32_t count) {
+    uint8_t* dst = target_address(target, x, y);
+    if (target->format->bpp == COLOR_DEPTH_8BIT) {
+        palette_convert_span(dst, strip, count, target->x + x, target->y + y);
+    } else {
+        target->format->convert_span(dst, strip, count);
+    }
+}
+
+// Position of pixel centre i in 16.16 source coordinates, less half a pixel
+// for bilinear so that integer positions land on source centres
+static inline int64_t first_sample(uint32_t step, uint32_t i, int bilinear) {
+    return (int64_t)step / 2 + (int64_t)i * step - (bilinear ? FIXED_HALF : 0);
+}
+
+// Split a bilinear position into the left/top sample and an 8-bit weight,
+// clamping to the edge pixels
+static inline uint32_t split_sample(int64_t pos, uint32_t size, uint32_t* weight) {
+    if (pos <= 0) {
+        *weight = 0;
+        return 0;
+    }
+    uint32_t index = (uint32_t)(pos >> SCALE_FIXED_SHIFT);
+    if (index >= size - 1) {
+        *weight = 0;
+        return size - 1;
+    }
+    *weight = (uint32_t)(pos >> (SCALE_FIXED_SHIFT - 8)) & 0xFF;
+    return index;
+}
+
+// Nearest-neighbour row resampling
+
+static void sample_row_nearest(uint32_t* dst, const uint32_t* row, uint32_t count, int64_t pos, uint32_t step) {
+    for (uint32_t i = 0; i < count; i++, pos += step) {
+        dst[i] = row[pos >> SCALE_FIXED_SHIFT];
+    }
+}
+
+// Every source pixel twice: four in, eight out per iteration
+static void expand_blocks_sse2(uint32_t* out, const uint32_t* src, uint64_t blocks) {
+    __asm__ volatile (
+        "1:\n\t"
+        "movdqu (%[src]), %%xmm0\n\t"
+        "movdqa %%xmm0, %%xmm1\n\t"
+        "punpckldq %%xmm0, %%xmm0\n\t"
+        "punpckhdq %%xmm1, %%xmm1\n\t"
+        "movdqu %%xmm0, (%[out])\n\t"
+        "movdqu %%xmm1, 16(%[out])\n\t"
+        "add $16, %[src]\n\t"
+        "add $32, %[out]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b"
+        : [src] "+r"(src), [out] "+r"(out), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "memory", "cc");
+}
+
+static void expand_row_2x(uint32_t* dst, const uint32_t* row, uint32_t count) {
+    uint32_t done = 0;
+    if (simd_features() & CPU_FEATURE_SSE2) {
+        done = count / 8 * 8;
+        if (done) expand_blocks_sse2(dst, row, count / 8);
+    }
+    for (uint32_t i = done; i < count; i++) {
+        dst[i] = row[i / 2];
+    }
+}
+
+static void expand_row_3x(uint32_t* dst, const uint32_t* row, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 3 <= count; i += 3, row++) {
+        uint32_t pixel = *row;
+        dst[i] = pixel;
+        dst[i + 1] = pixel;
+        dst[i + 2] = pixel;
+    }
+    for (; i < count; i++) {
+        dst[i] = *row;
+    }
+}
+
+static void scale_chunk_nearest(const scale_target_t* target, const uint32_t* src, uint32_t src_width,
+                                uint32_t src_height, uint32_t x, uint32_t count,
+                                uint32_t step_x, uint32_t step_y, uint32_t factor) {
+    uint32_t cached_row = src_height; // None yet
+    int64_t pos_y = first_sample(step_y, 0, 0);
+
+    for (uint32_t y = 0; y < target->height; y++, pos_y += step_y) {
+        uint32_t sy = (uint32_t)(pos_y >> SCALE_FIXED_SHIFT);
+        if (sy >= src_height) sy = src_height - 1;
+
+        if (sy != cached_row) {
+            const uint32_t* row = src + (size_t)sy * src_width;
+            // Chunks start on a multiple of the factor, so x / factor is exact
+            if (factor == 2) {
+                expand_row_2x(strip_a, row + x / 2, count);
+            } else if (factor == 3) {
+                expand_row_3x(strip_a, row + x / 3, count);
+            } else {
+                sample_row_nearest(strip_a, row, count, first_sample(step_x, x, 0), step_x);
+            }
+            cached_row = sy;
+        }
+        emit_strip(target, x, y, strip_a, count);
+    }
+}
+
+// Bilinear
+
+static void sample_row_bilinear(uint32_t* dst, const uint32_t* row, uint32_t src_width,
+                                uint32_t count, int64_t pos, uint32_t step) {
+    for (uint32_t i = 0; i < count; i++, pos += step) {
+        uint32_t weight;
+        uint32_t sx = split_sample(pos, src_width, &weight);
+        dst[i] = weight ? lerp_pixel(row[sx], row[sx + 1], weight) : row[sx];
+    }
+}
+
+// out = a * (256 - weight) + b * weight, four pixels per iteration on
+// 16-bit lanes
+static void lerp_blocks_sse2(uint32_t* out, const uint32_t* a, const uint32_t* b, uint64_t blocks, uint32_t weight) {
+    __asm__ volatile (
+        "movd %[wa], %%xmm6\n\t"
+        "pshuflw $0, %%xmm6, %%xmm6\n\t"
+        "punpcklqdq %%xmm6, %%xmm6\n\t"
+        "movd %[wb], %%xmm7\n\t"
+        "pshuflw $0, %%xmm7, %%xmm7\n\t"
+        "punpcklqdq %%xmm7, %%xmm7\n\t"
+        "pxor %%xmm5, %%xmm5\n\t"
+        "1:\n\t"
+        "movdqu (%[a]), %%xmm0\n\t"
+        "movdqu (%[b]), %%xmm2\n\t"
+        "movdqa %%xmm0, %%xmm1\n\t"
+        "movdqa %%xmm2, %%xmm3\n\t"
+        "punpcklbw %%xmm5, %%xmm0\n\t"
+        "punpckhbw %%xmm5, %%xmm1\n\t"
+        "punpcklbw %%xmm5, %%xmm2\n\t"
+        "punpckhbw %%xmm5, %%xmm3\n\t"
+        "pmullw %%xmm6, %%xmm0\n\t"
+        "pmullw %%xmm6, %%xmm1\n\t"
+        "pmullw %%xmm7, %%xmm2\n\t"
+        "pmullw %%xmm7, %%xmm3\n\t"
+        "paddw %%xmm2, %%xmm0\n\t"
+        "paddw %%xmm3, %%xmm1\n\t"
+        "psrlw $8, %%xmm0\n\t"
+        "psrlw $8, %%xmm1\n\t"
+        "packuswb %%xmm1, %%xmm0\n\t"
+        "movdqu %%xmm0, (%[out])\n\t"
+        "add $16, %[a]\n\t"
+        "add $16, %[b]\n\t"
+        "add $16, %[out]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b"
+        : [a] "+r"(a), [b] "+r"(b), [out] "+r"(out), [blocks] "+r"(blocks)
+        : [wa] "r"(256 - weight), [wb] "r"(weight)
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+static void lerp_rows(uint32_t* dst, const uint32_t* top, const uint32_t* bottom, uint32_t count, uint32_t weight) {
+    uint32_t done = 0;
+    if (simd_features() & CPU_FEATURE_SSE2) {
+        done = count / 4 * 4;
+        if (done) lerp_blocks_sse2(dst, top, bottom, count / 4, weight);
+    }
+    for (uint32_t i = done; i < count; i++) {
+        dst[i] = lerp_pixel(top[i], bottom[i], weight);
+    }
+}
+
+static void scale_chunk_bilinear(const scale_target_t* target, const uint32_t* src, uint32_t src_width,
+                                 uint32_t src_height, uint32_t x, uint32_t count,
+                                 uint32_t step_x, uint32_t step_y) {
+    int64_t pos_x = first_sample(step_x, x, 1);
+    int64_t pos_y = first_sample(step_y, 0, 1);
+
+    // upper holds source row upper_row, lower holds lower_row
+    uint32_t* upper = strip_a;
+    uint32_t* lower = strip_b;
+    uint32_t upper_row = src_height;
+    uint32_t lower_row = src_height;
+
+    for (uint32_t y = 0; y < target->height; y++, pos_y += step_y) {
+        uint32_t weight;
+        uint32_t sy = split_sample(pos_y, src_height, &weight);
+
+        if (sy != upper_row) {
+            if (sy == lower_row) {
+                // Stepped down one source row: the old lower row moves up
+                uint32_t* swap = upper;
+                upper = lower;
+                lower = swap;
+                upper_row = sy;
+                lower_row = src_height;
+            } else {
+                sample_row_bilinear(upper, src + (size_t)sy * src_width, src_width, count, pos_x, step_x);
+                upper_row = sy;
+            }
+        }
+        if (weight == 0) {
+            emit_strip(target, x, y, upper, count);
+            continue;
+        }
+
+        if (lower_row != sy + 1) {
+            sample_row_bilinear(lower, src + (size_t)(sy + 1) * src_width, src_width, count, pos_x, step_x);
+            lower_row = sy + 1;
+        }
+
+        // 32bpp takes the blended row straight into the framebuffer
+        if (target->format->bpp == COLOR_DEPTH_32BIT) {
+            lerp_rows((uint32_t*)target_address(target, x, y), upper, lower, count, weight);
+        } else {
+            lerp_rows(strip_out, upper, lower, count, weight);
+            emit_strip(target, x, y, strip_out, count);
+        }
+    }
+}
+
+// 2 or 3 when the blit is an exact integer upscale on both axes, else 0
+static uint32_t integer_factor(uint32_t src_width, uint32_t src_height, uint32_t dest_width, uint32_t dest_height) {
+    for (uint32_t factor = 2; factor <= 3; factor++) {
+        if (dest_width == src_width * factor && dest_height == src_height * factor) return factor;
+    }
+    return 0;
+}
+
+void scale_blit(const scale_target_t* target, const uint32_t* src, uint32_t src_width, uint32_t src_height,
+                uint32_t dest_width, uint32_t dest_height, scale_filter_t filter) {
+    if (!target || !target->pixels || !target->format || !src) return;
+    if (src_width == 0 || src_height == 0 || dest_width == 0 || dest_height == 0) return;
+
+    uint32_t width = target->width < dest_width ? target->width : dest_width;
+    uint32_t step_x = (uint32_t)(((uint64_t)src_width << SCALE_FIXED_SHIFT) / dest_width);
+    uint32_t step_y = (uint32_t)(((uint64_t)src_height << SCALE_FIXED_SHIFT) / dest_height);
+    uint32_t factor = filter == SCALE_NEAREST ? integer_factor(src_width, src_height, dest_width, dest_height) : 0;
+
+    scale_target_t clipped = *target;
+    if (clipped.height > dest_height) clipped.height = dest_height;
+
+    for (uint32_t x = 0; x < width; x += SCALE_CHUNK_PIXELS) {
+        uint32_t count = width - x < SCALE_CHUNK_PIXELS ? width - x : SCALE_CHUNK_PIXELS;
+        if (filter == SCALE_BILINEAR) {
+            scale_chunk_bilinear(&clipped, src, src_width, src_height, x, count, step_x, step_y);
+        } else {
+            scale_chunk_nearest(&clipped, src, src_width, src_height, x, count, step_x, step_y, factor);
+        }
+    }
+}
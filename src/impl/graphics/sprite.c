@@ -0,0 +1,367 @@
+#include "../../intf/sprite.h"
+#include "../../intf/graphics.h"
+#include "../../intf/blend.h"
+#include "../../intf/palette.h"
+#include "../../intf/mm.h"
+#include "../../intf/benchmark.h"
+#include "../../intf/pit.h"
+#include "../../intf/cpu.h"
+#include "../../intf/stdint.h"
+
+// An encoded sprite is one block: the sprite_t, then the row table, the
+// runs and the visible pixels. Encoding walks the source twice, once to
+// size the block and once to fill it.
+#define FLIP_CHUNK 64 // Pixels reversed at a time for horizontal flips
+
+static inline int is_transparent(uint32_t pixel, uint32_t key) {
+    if (key != SPRITE_NO_KEY) return (pixel & 0xFFFFFF) == (key & 0xFFFFFF);
+    return (pixel >> 24) == 0;
+}
+
+static inline int is_translucent(uint32_t pixel, uint32_t key) {
+    return key == SPRITE_NO_KEY && (pixel >> 24) != 0xFF;
+}
+
+// Count the runs and visible pixels; rows, runs and visible are written
+// when not null
+static void encode(const uint32_t* pixels, uint32_t stride, uint32_t width, uint32_t height, uint32_t key,
+                   sprite_row_t* rows, sprite_run_t* runs, uint32_t* visible,
+                   uint32_t* run_count, uint32_t* pixel_count) {
+    uint32_t r = 0;
+    uint32_t p = 0;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint32_t* row = pixels + (size_t)y * stride;
+        if (rows) {
+            rows[y].run = r;
+            rows[y].pixel = p;
+        }
+
+        uint32_t x = 0;
+        uint32_t skip = 0;
+        while (x < width) {
+            if (is_transparent(row[x], key)) {
+                skip++;
+                x++;
+                continue;
+            }
+
+            int blend = is_translucent(row[x], key);
+            uint32_t length = 0;
+            while (x < width && !is_transparent(row[x], key) && is_translucent(row[x], key) == blend) {
+                if (visible) visible[p] = blend ? premultiply_pixel(row[x]) : row[x];
+                p++;
+                x++;
+                length++;
+            }
+            if (runs) {
+                runs[r].skip = (uint16_t)skip;
+                runs[r].length = (uint16_t)(length | (blend ? SPRITE_RUN_BLEND : 0));
+            }
+            r++;
+            skip = 0;
+        }
+    }
+    if (rows) {
+        rows[height].run = r;
+        rows[height].pixel = p;
+    }
+    *run_count = r;
+    *pixel_count = p;
+}
+
+static inline size_t data_size(uint32_t height, uint32_t run_count, uint32_t pixel_count) {
+    return (size_t)(height + 1) * sizeof(sprite_row_t) + (size_t)run_count * sizeof(sprite_run_t) +
+           (size_t)pixel_count * sizeof(uint32_t);
+}
+
+static void encode_into(sprite_t* sprite, uint8_t* data, const uint32_t* pixels, uint32_t stride,
+                        uint32_t width, uint32_t height, uint32_t key, uint32_t run_count, uint32_t pixel_count) {
+    sprite_row_t* rows = (sprite_row_t*)data;
+    sprite_run_t* runs = (sprite_run_t*)(rows + height + 1);
+    uint32_t* visible = (uint32_t*)(runs + run_count);
+
+    encode(pixels, stride, width, height, key, rows, runs, visible, &run_count, &pixel_count);
+    sprite->width = width;
+    sprite->height = height;
+    sprite->rows = rows;
+    sprite->runs = runs;
+    sprite->pixels = visible;
+    sprite->visible_pixels = pixel_count;
+}
+
+sprite_t* sprite_create(const uint32_t* pixels, uint32_t stride, uint32_t width, uint32_t height, uint32_t color_key) {
+    if (!pixels || width == 0 || height == 0 || width > SPRITE_MAX_SIZE || height > SPRITE_MAX_SIZE) return 0;
+
+    uint32_t run_count, pixel_count;
+    encode(pixels, stride, width, height, color_key, 0, 0, 0, &run_count, &pixel_count);
+    if (pixel_count == 0) return 0;
+
+    sprite_t* sprite = (sprite_t*)kmalloc(sizeof(sprite_t) + data_size(height, run_count, pixel_count));
+    if (!sprite) return 0;
+    encode_into(sprite, (uint8_t*)(sprite + 1), pixels, stride, width, height, color_key, run_count, pixel_count);
+    return sprite;
+}
+
+void sprite_destroy(sprite_t* sprite) {
+    if (sprite) kfree(sprite);
+}
+
+// Atlas
+
+sprite_atlas_t* sprite_atlas_create(size_t arena_size, uint32_t max_sprites) {
+    if (arena_size == 0 || max_sprites == 0) return 0;
+
+    sprite_atlas_t* atlas = (sprite_atlas_t*)kmalloc(sizeof(sprite_atlas_t));
+    if (!atlas) return 0;
+    atlas->arena = (uint8_t*)kmalloc(arena_size);
+    atlas->sprites = (sprite_t*)kmalloc((size_t)max_sprites * sizeof(sprite_t));
+    if (!atlas->arena || !atlas->sprites) {
+        if (atlas->arena) kfree(atlas->arena);
+        if (atlas->sprites) kfree(atlas->sprites);
+        kfree(atlas);
+        return 0;
+    }
+    atlas->arena_size = arena_size;
+    atlas->used = 0;
+    atlas->count = 0;
+    atlas->capacity = max_sprites;
+    return atlas;
+}
+
+void sprite_atlas_destroy(sprite_atlas_t* atlas) {
+    if (!atlas) return;
+    kfree(atlas->arena);
+    kfree(atlas->sprites);
+    kfree(atlas);
+}
+
+int32_t sprite_atlas_add(sprite_atlas_t* atlas, const uint32_t* sheet, uint32_t stride,
+                         uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color_key) {
+    if (!atlas || !sheet || atlas->count >= atlas->capacity) return -1;
+    if (width == 0 || height == 0 || width > SPRITE_MAX_SIZE || height > SPRITE_MAX_SIZE) return -1;
+
+    const uint32_t* cell = sheet + (size_t)y * stride + x;
+    uint32_t run_count, pixel_count;
+    encode(cell, stride, width, height, color_key, 0, 0, 0, &run_count, &pixel_count);
+    if (pixel_count == 0) return -1;
+
+    size_t size = data_size(height, run_count, pixel_count);
+    if (size > atlas->arena_size - atlas->used) return -1;
+
+    sprite_t* sprite = &atlas->sprites[atlas->count];
+    encode_into(sprite, atlas->arena + atlas->used, cell, stride, width, height, color_key, run_count, pixel_count);
+    atlas->used += (size + 7) & ~(size_t)7; // Keep the row tables 8-byte aligned
+    if (atlas->used > atlas->arena_size) atlas->used = atlas->arena_size;
+    return (int32_t)atlas->count++;
+}
+
+uint32_t sprite_atlas_add_grid(sprite_atlas_t* atlas, const uint32_t* sheet, uint32_t stride,
+                               uint32_t sheet_width, uint32_t sheet_height,
+                               uint32_t cell_width, uint32_t cell_height, uint32_t color_key) {
+    if (cell_width == 0 || cell_height == 0) return 0;
+
+    uint32_t added = 0;
+    for (uint32_t y = 0; y + cell_height <= sheet_height; y += cell_height) {
+        for (uint32_t x = 0; x + cell_width <= sheet_width; x += cell_width) {
+            if (sprite_atlas_add(atlas, sheet, stride, x, y, cell_width, cell_height, color_key) >= 0) added++;
+        }
+    }
+    return added;
+}
+
+const sprite_t* sprite_atlas_get(const sprite_atlas_t* atlas, uint32_t index) {
+    if (!atlas || index >= atlas->count) return 0;
+    return &atlas->sprites[index];
+}
+
+// Drawing
+
+static inline void draw_span(const raster_target_t* target, uint8_t* dst, const uint32_t* src, uint32_t count,
+                             int blend, int32_t x, int32_t y) {
+    const pixel_format_t* format = target->format;
+    if (blend) {
+        format->blend_span(dst, src, count);
+    } else if (format->bpp == COLOR_DEPTH_8BIT) {
+        palette_convert_span(dst, src, count, (uint32_t)x, (uint32_t)y);
+    } else {
+        format->convert_span(dst, src, count);
+    }
+}
+
+// The sprite is already known to overlap the clip rectangle
+static uint64_t draw_clipped(const raster_target_t* target, const sprite_t* sprite, int32_t x, int32_t y,
+                             uint32_t flags) {
+    int32_t width = (int32_t)sprite->width;
+    int32_t height = (int32_t)sprite->height;
+    int32_t x1 = x > target->clip_x1 ? x : target->clip_x1;
+    int32_t y1 = y > target->clip_y1 ? y : target->clip_y1;
+    int32_t x2 = x + width < target->clip_x2 ? x + width : target->clip_x2;
+    int32_t y2 = y + height < target->clip_y2 ? y + height : target->clip_y2;
+    uint32_t bytes = target->format->bytes_per_pixel;
+    int flip_h = (flags & SPRITE_FLIP_H) != 0;
+    uint32_t reversed[FLIP_CHUNK];
+    uint64_t written = 0;
+
+    for (int32_t sy = y1; sy < y2; sy++) {
+        uint32_t row = (flags & SPRITE_FLIP_V) ? (uint32_t)(y + height - 1 - sy) : (uint32_t)(sy - y);
+        const sprite_row_t* rows = &sprite->rows[row];
+        const uint32_t* src = sprite->pixels + rows->pixel;
+        uint8_t* line = target->pixels + (size_t)sy * target->pitch;
+        int32_t column = 0;
+
+        for (uint32_t i = rows[0].run; i < rows[1].run; i++) {
+            const sprite_run_t* run = &sprite->runs[i];
+            int32_t length = run->length & SPRITE_RUN_LENGTH;
+            int blend = (run->length & SPRITE_RUN_BLEND) != 0;
+            column += run->skip;
+
+            // Screen extent of the run; flipped, runs advance leftwards
+            int32_t left = flip_h ? x + width - column - length : x + column;
+            int32_t right = left + length;
+            if (flip_h ? right <= x1 : left >= x2) break;
+
+            int32_t a = left > x1 ? left : x1;
+            int32_t b = right < x2 ? right : x2;
+            if (a < b) {
+                if (!flip_h) {
+                    draw_span(target, line + (size_t)a * bytes, src + (a - left), (uint32_t)(b - a), blend, a, sy);
+                } else {
+                    // Screen column s shows run pixel right - 1 - s
+                    for (int32_t s = a; s < b; s += FLIP_CHUNK) {
+                        int32_t n = b - s < FLIP_CHUNK ? b - s : FLIP_CHUNK;
+                        for (int32_t k = 0; k < n; k++) {
+                            reversed[k] = src[right - 1 - (s + k)];
+                        }
+                        draw_span(target, line + (size_t)s * bytes, reversed, (uint32_t)n, blend, s, sy);
+                    }
+                }
+                written += (uint64_t)(b - a);
+            }
+            src += length;
+            column += length;
+        }
+    }
+    return written;
+}
+
+static inline int overlaps_clip(const raster_target_t* target, const sprite_t* sprite, int32_t x, int32_t y) {
+    return x < target->clip_x2 && y < target->clip_y2 &&
+           x + (int32_t)sprite->width > target->clip_x1 && y + (int32_t)sprite->height > target->clip_y1;
+}
+
+uint64_t sprite_draw(const raster_target_t* target, const sprite_t* sprite, int32_t x, int32_t y, uint32_t flags) {
+    if (!target || !target->pixels || !sprite) return 0;
+    if (!overlaps_clip(target, sprite, x, y)) return 0;
+    return draw_clipped(target, sprite, x, y, flags);
+}
+
+uint64_t sprite_draw_batch(const raster_target_t* target, const sprite_instance_t* instances, uint32_t count) {
+    if (!target || !target->pixels || !instances) return 0;
+
+    uint64_t written = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const sprite_instance_t* instance = &instances[i];
+        if (!instance->sprite || !overlaps_clip(target, instance->sprite, instance->x, instance->y)) continue;
+        written += draw_clipped(target, instance->sprite, instance->x, instance->y, instance->flags);
+    }
+    return written;
+}
+
+// Benchmark
+
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+#define BENCH_SIZE 32
+#define BENCH_FRAMES 8
+#define BENCH_KEY 0xFF00FF
+
+static uint32_t bench_image[BENCH_SIZE * BENCH_SIZE];
+static sprite_instance_t bench_instances[SPRITE_BENCH_COUNT];
+
+// A ring: opaque between radius 8 and 15, key colour elsewhere
+static void build_bench_image(void) {
+    for (int32_t y = 0; y < BENCH_SIZE; y++) {
+        for (int32_t x = 0; x < BENCH_SIZE; x++) {
+            int32_t dx = 2 * x + 1 - BENCH_SIZE;
+            int32_t dy = 2 * y + 1 - BENCH_SIZE;
+            int32_t d = dx * dx + dy * dy;
+            int inside = d <= 30 * 30 && d > 16 * 16;
+            bench_image[y * BENCH_SIZE + x] = inside ? 0xFF000000 | (uint32_t)(x * 8) << 16 | (uint32_t)(y * 8) << 8 | 0x40
+                                                     : BENCH_KEY;
+        }
+    }
+}
+
+// What vga_blit_buffer does for one sprite, with or without a per-pixel key
+static void blit_rect(const raster_target_t* target, int32_t x, int32_t y, int keyed) {
+    int32_t x1 = x > target->clip_x1 ? x : target->clip_x1;
+    int32_t y1 = y > target->clip_y1 ? y : target->clip_y1;
+    int32_t x2 = x + BENCH_SIZE < target->clip_x2 ? x + BENCH_SIZE : target->clip_x2;
+    int32_t y2 = y + BENCH_SIZE < target->clip_y2 ? y + BENCH_SIZE : target->clip_y2;
+    if (x1 >= x2 || y1 >= y2) return;
+
+    for (int32_t sy = y1; sy < y2; sy++) {
+        const uint32_t* src = bench_image + (sy - y) * BENCH_SIZE + (x1 - x);
+        uint32_t* dst = (uint32_t*)(target->pixels + (size_t)sy * target->pitch) + x1;
+        if (!keyed) {
+            target->format->convert_span((uint8_t*)dst, src, (uint32_t)(x2 - x1));
+            continue;
+        }
+        for (int32_t i = 0; i < x2 - x1; i++) {
+            if ((src[i] & 0xFFFFFF) != BENCH_KEY) dst[i] = src[i];
+        }
+    }
+}
+
+static inline uint64_t sprites_per_frame(uint64_t cycles, uint64_t hz) {
+    if (cycles == 0) return 0;
+    return (hz / 60) * BENCH_FRAMES * SPRITE_BENCH_COUNT / cycles;
+}
+
+int sprite_benchmark(sprite_benchmark_t* result) {
+    uint64_t hz = pit_tsc_hz();
+    if (!result || !hz) return 0;
+
+    build_bench_image();
+    sprite_t* sprite = sprite_create(bench_image, BENCH_SIZE, BENCH_SIZE, BENCH_SIZE, BENCH_KEY);
+    raster_target_t target;
+    render_buffer_t* buffer = bench_create_buffer(BENCH_WIDTH, BENCH_HEIGHT, &target);
+    if (!sprite || !buffer) {
+        sprite_destroy(sprite);
+        destroy_render_buffer(buffer);
+        return 0;
+    }
+
+    // Some instances hang off each edge so clipping is part of the cost
+    uint32_t seed = 7;
+    for (uint32_t i = 0; i < SPRITE_BENCH_COUNT; i++) {
+        bench_instances[i].sprite = sprite;
+        bench_instances[i].x = (int32_t)(bench_random(&seed) % (BENCH_WIDTH + BENCH_SIZE)) - BENCH_SIZE / 2;
+        bench_instances[i].y = (int32_t)(bench_random(&seed) % (BENCH_HEIGHT + BENCH_SIZE)) - BENCH_SIZE / 2;
+        bench_instances[i].flags = bench_random(&seed) & (SPRITE_FLIP_H | SPRITE_FLIP_V);
+    }
+
+    uint64_t cycles[3] = { 0, 0, 0 };
+    for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        for (int path = 0; path < 3; path++) {
+            uint64_t start = rdtsc();
+            if (path == 2) {
+                sprite_draw_batch(&target, bench_instances, SPRITE_BENCH_COUNT);
+            } else {
+                for (uint32_t i = 0; i < SPRITE_BENCH_COUNT; i++) {
+                    blit_rect(&target, bench_instances[i].x, bench_instances[i].y, path == 1);
+                }
+            }
+            cycles[path] += rdtsc() - start;
+        }
+    }
+
+    result->blit_sprites_per_frame = sprites_per_frame(cycles[0], hz);
+    result->key_sprites_per_frame = sprites_per_frame(cycles[1], hz);
+    result->rle_sprites_per_frame = sprites_per_frame(cycles[2], hz);
+
+    sprite_destroy(sprite);
+    destroy_render_buffer(buffer);
+    return 1;
+}
@@ -2,31 +2,174 @@
 #include "../../intf/ui.h"
 #include "../../intf/font.h"
 #include "../../intf/ports.h"
+#include "../../intf/mm.h"
+#include "../../intf/vmm.h"
+#include "../../intf/pat.h"
+#include "../../intf/cpu.h"
+#include "../../intf/multiboot.h"
+#include "../../intf/bga.h"
+#include "../../intf/pixel_format.h"
+#include "../../intf/simd.h"
+#include "../../intf/glyph_cache.h"
+#include "../../intf/raster.h"
+#include "../../intf/blend.h"
+#include "../../intf/palette.h"
+#include "../../intf/scale.h"
+#include "../../intf/display_list.h"
+#include "../../intf/sprite.h"
 
 // Global video mode state
 uint32_t current_vga_width = VGA_WIDTH;
 uint32_t current_vga_height = VGA_HEIGHT;
 uint32_t current_color_depth = COLOR_DEPTH_8BIT;
+uint32_t current_vga_pitch = VGA_WIDTH;
 vga_mode_t current_vga_mode = VGA_MODE_13H;
 int graphics_initialized = 0; // Track if graphics mode was successfully initialized
 
 // VGA framebuffers for different modes
 static uint8_t* vga_framebuffer_13h = (uint8_t*)VGA_GRAPHICS_BUFFER;  // Mode 13h: 320x200
 static uint8_t* vga_framebuffer_12h = (uint8_t*)VGA_GRAPHICS_BUFFER;  // Mode 12h: 640x480 (planar)
-static uint8_t* vga_framebuffer_101h = (uint8_t*)VGA_GRAPHICS_BUFFER; // Mode 101h: 640x480
-static uint8_t* vga_framebuffer_103h = (uint8_t*)VGA_GRAPHICS_BUFFER; // Mode 103h: 800x600
 
 // Current active framebuffer
 static uint8_t* vga_framebuffer = (uint8_t*)VGA_GRAPHICS_BUFFER;
 
+// Linear framebuffer handed over by the bootloader (0 if none)
+static const multiboot_tag_framebuffer_t* boot_framebuffer = 0;
+
+// Set while the screen is driven by the BGA; vga_framebuffer then points at
+// the page currently shown, or at the shadow of a live double buffer
+static int bga_active = 0;
+
+// Double buffer presented by flipping BGA pages, if one is live. Drawing
+// meant for the screen goes to its system-RAM shadow and is marked as its
+// damage, so the next present carries it.
+static double_buffer_t* vga_shadowed = 0;
+
+static inline void vga_mark(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (vga_shadowed) damage_add(&vga_shadowed->damage, x, y, width, height);
+}
+
+static void vga_mark_between(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    int32_t left = x1 < x2 ? x1 : x2;
+    int32_t top = y1 < y2 ? y1 : y2;
+    vga_mark(left, top, (uint32_t)((x1 < x2 ? x2 : x1) - left) + 1, (uint32_t)((y1 < y2 ? y2 : y1) - top) + 1);
+}
+
+static void vga_mark_points(const raster_point_t* points, uint32_t count) {
+    if (!vga_shadowed || count == 0) return;
+    int32_t x1 = points[0].x, y1 = points[0].y, x2 = x1, y2 = y1;
+    for (uint32_t i = 1; i < count; i++) {
+        if (points[i].x < x1) x1 = points[i].x;
+        if (points[i].x > x2) x2 = points[i].x;
+        if (points[i].y < y1) y1 = points[i].y;
+        if (points[i].y > y2) y2 = points[i].y;
+    }
+    vga_mark_between(x1, y1, x2, y2);
+}
+
+// Span kernels for the current depth, chosen when the mode is set
+static const pixel_format_t* vga_format = 0;
+
+static vga_mode_hook_fn mode_hooks[VGA_MAX_MODE_HOOKS];
+static uint32_t mode_hook_count = 0;
+
+static inline uint8_t* vga_scanline(uint32_t y) {
+    return vga_framebuffer + (uint64_t)y * current_vga_pitch;
+}
+
+static inline uint8_t* vga_pixel_address(uint32_t x, uint32_t y) {
+    return vga_scanline(y) + x * vga_format->bytes_per_pixel;
+}
+
+static void vga_select_format(void) {
+    vga_format = pixel_format_for_depth(current_color_depth);
+    // 8bpp indices only mean something once the DAC holds our palette
+    if (current_color_depth == COLOR_DEPTH_8BIT) palette_init();
+}
+
+// Clip a rectangle against the screen. Returns 0 if nothing is left.
+static int vga_clip_rect(uint32_t* x, uint32_t* y, uint32_t* width, uint32_t* height) {
+    if (*x >= current_vga_width || *y >= current_vga_height || *width == 0 || *height == 0) return 0;
+    if (*width > current_vga_width - *x) *width = current_vga_width - *x;
+    if (*height > current_vga_height - *y) *height = current_vga_height - *y;
+    return 1;
+}
+
+// Optional clip rectangle for lines and filled shapes
+static int vga_user_clip = 0;
+static int32_t vga_user_clip_x = 0;
+static int32_t vga_user_clip_y = 0;
+static uint32_t vga_user_clip_width = 0;
+static uint32_t vga_user_clip_height = 0;
+
+static void vga_raster_target(raster_target_t* target) {
+    target->pixels = vga_framebuffer;
+    target->pitch = current_vga_pitch;
+    target->format = vga_format;
+    target->clip_x1 = 0;
+    target->clip_y1 = 0;
+    target->clip_x2 = (int32_t)current_vga_width;
+    target->clip_y2 = (int32_t)current_vga_height;
+    if (vga_user_clip) {
+        raster_clip_to(target, vga_user_clip_x, vga_user_clip_y, vga_user_clip_width, vga_user_clip_height);
+    }
+}
+
+void vga_set_clip_rect(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    vga_user_clip_x = x;
+    vga_user_clip_y = y;
+    vga_user_clip_width = width;
+    vga_user_clip_height = height;
+    vga_user_clip = 1;
+}
+
+void vga_reset_clip_rect(void) {
+    vga_user_clip = 0;
+}
+
+void vga_flush_display_list(display_list_t* list, display_list_stats_t* stats) {
+    if (!graphics_initialized) {
+        display_list_reset(list);
+        return;
+    }
+
+    raster_target_t target;
+    vga_raster_target(&target);
+    display_list_flush(list, &target, vga_shadowed ? &vga_shadowed->damage : 0, stats);
+}
+
+void vga_draw_sprite(const sprite_t* sprite, int32_t x, int32_t y, uint32_t flags) {
+    if (!graphics_initialized || !sprite) return;
+    vga_mark(x, y, sprite->width, sprite->height);
+
+    raster_target_t target;
+    vga_raster_target(&target);
+    sprite_draw(&target, sprite, x, y, flags);
+}
+
+void vga_draw_sprites(const sprite_instance_t* instances, uint32_t count) {
+    if (!graphics_initialized) return;
+    for (uint32_t i = 0; vga_shadowed && i < count; i++) {
+        if (instances[i].sprite) {
+            vga_mark(instances[i].x, instances[i].y, instances[i].sprite->width, instances[i].sprite->height);
+        }
+    }
+
+    raster_target_t target;
+    vga_raster_target(&target);
+    sprite_draw_batch(&target, instances, count);
+}
+
 void vga_init_mode13(void) {
     // VGA mode 13h is already set in boot.asm before entering long mode
     // Just configure our variables
     vga_framebuffer = vga_framebuffer_13h;
+    bga_active = 0;
     current_vga_width = VGA_MODE_13H_WIDTH;
     current_vga_height = VGA_MODE_13H_HEIGHT;
     current_vga_mode = VGA_MODE_13H;
     current_color_depth = COLOR_DEPTH_8BIT;
+    current_vga_pitch = VGA_MODE_13H_WIDTH;
 }
 
 void vga_init_mode12h(void) {
@@ -35,58 +178,124 @@ void vga_init_mode12h(void) {
     // For now, just configure variables assuming mode was set in real mode
     // (which it currently isn't, so this mode is effectively disabled)
     vga_framebuffer = vga_framebuffer_12h;
+    bga_active = 0;
     current_vga_width = VGA_MODE_12H_WIDTH;
     current_vga_height = VGA_MODE_12H_HEIGHT;
     current_vga_mode = VGA_MODE_12H;
     current_color_depth = COLOR_DEPTH_16BIT;
+    current_vga_pitch = VGA_MODE_12H_WIDTH * 2;
 }
 
-int vga_init_mode101h(void) {
-    // VESA modes cannot be set in long mode - BIOS interrupts don't work
-    // This function should only be called if VESA was set in boot.asm
-    extern char vesa_success[];
-    if (vesa_success[0]) {
-        // VESA mode was set in real mode, configure for it
-        vga_framebuffer = (uint8_t*)0xA0000; // Assume standard location
-        current_vga_width = VGA_MODE_101H_WIDTH;
-        current_vga_height = VGA_MODE_101H_HEIGHT;
-        current_vga_mode = VGA_MODE_101H;
-        current_color_depth = COLOR_DEPTH_8BIT;
-        return 1; // Success - already set
+// Find the framebuffer GRUB set up from our Multiboot2 header request.
+// Only packed pixel formats we can draw into directly are accepted.
+static const multiboot_tag_framebuffer_t* find_boot_framebuffer(void) {
+    const multiboot_tag_framebuffer_t* tag =
+        (const multiboot_tag_framebuffer_t*)multiboot_find_tag(MULTIBOOT_TAG_TYPE_FRAMEBUFFER);
+    if (!tag || tag->addr == 0 || tag->width == 0 || tag->height == 0) return 0;
+
+    switch (tag->framebuffer_type) {
+        case MULTIBOOT_FRAMEBUFFER_TYPE_INDEXED:
+            return tag->bpp == COLOR_DEPTH_8BIT ? tag : 0;
+        case MULTIBOOT_FRAMEBUFFER_TYPE_RGB:
+            if (tag->bpp == COLOR_DEPTH_16BIT || tag->bpp == COLOR_DEPTH_24BIT ||
+                tag->bpp == COLOR_DEPTH_32BIT) {
+                return tag;
+            }
+            return 0;
+        default:
+            return 0; // EGA text mode
     }
-    return 0; // Cannot set VESA mode in long mode
 }
 
-int vga_init_mode103h(void) {
-    // VESA modes cannot be set in long mode - BIOS interrupts don't work
-    // This function should only be called if VESA was set in boot.asm
-    extern char vesa_success[];
-    if (vesa_success[0]) {
-        // VESA mode was set in real mode, configure for it
-        vga_framebuffer = (uint8_t*)0xA0000; // Assume standard location
-        current_vga_width = VGA_MODE_103H_WIDTH;
-        current_vga_height = VGA_MODE_103H_HEIGHT;
-        current_vga_mode = VGA_MODE_103H;
-        current_color_depth = COLOR_DEPTH_8BIT;
-        return 1; // Success - already set
+int vga_init_linear_framebuffer(void) {
+    if (!boot_framebuffer) {
+        boot_framebuffer = find_boot_framebuffer();
+        if (!boot_framebuffer) return 0;
     }
-    return 0; // Cannot set VESA mode in long mode
+
+    vga_framebuffer = (uint8_t*)boot_framebuffer->addr;
+    bga_active = 0;
+    current_vga_width = boot_framebuffer->width;
+    current_vga_height = boot_framebuffer->height;
+    current_vga_pitch = boot_framebuffer->pitch;
+    current_color_depth = boot_framebuffer->bpp;
+    current_vga_mode = VGA_MODE_LFB;
+
+    // Map it (it may lie above the boot identity map) as write-combining
+    return vga_map_framebuffer(PAT_TYPE_WC);
 }
 
-int vga_init_mode118h(void) {
-    // VESA modes cannot be set in long mode - BIOS interrupts don't work
-    // This function should only be called if VESA was set in boot.asm
-    extern char vesa_success[];
-    if (vesa_success[0]) {
-        // VESA mode was set in real mode, configure for it
-        vga_framebuffer = (uint8_t*)0xA0000; // Assume standard location
-        current_vga_width = VGA_MODE_118H_WIDTH;
-        current_vga_height = VGA_MODE_118H_HEIGHT;
-        current_vga_mode = VGA_MODE_118H;
-        current_color_depth = COLOR_DEPTH_24BIT;
-        return 1; // Success - already set
+int vga_add_mode_hook(vga_mode_hook_fn hook) {
+    if (!hook) return 0;
+    for (uint32_t i = 0; i < mode_hook_count; i++) {
+        if (mode_hooks[i] == hook) return 1;
+    }
+    if (mode_hook_count == VGA_MAX_MODE_HOOKS) return 0;
+
+    mode_hooks[mode_hook_count++] = hook;
+    hook(current_vga_width, current_vga_height);
+    return 1;
+}
+
+static void run_mode_hooks(void) {
+    // The new mode has its own framebuffer; a shadow no longer backs it
+    vga_shadowed = 0;
+    for (uint32_t i = 0; i < mode_hook_count; i++) {
+        mode_hooks[i](current_vga_width, current_vga_height);
+    }
+}
+
+static int set_bga_mode(uint32_t width, uint32_t height, uint32_t bpp) {
+    if (!bga_available() && !bga_init()) return 0;
+    if (!bga_set_mode(width, height, bpp)) {
+        // A failed attempt leaves the adapter disabled
+        if (bga_active) graphics_initialized = 0;
+        bga_active = 0;
+        return 0;
+    }
+
+    vga_framebuffer = bga_page_address(bga_visible_page());
+    bga_active = 1;
+    current_vga_width = width;
+    current_vga_height = height;
+    current_vga_pitch = bga_pitch();
+    current_color_depth = bpp;
+    current_vga_mode = VGA_MODE_BGA;
+    vga_select_format();
+    graphics_initialized = vga_map_framebuffer(PAT_TYPE_WC);
+    return graphics_initialized;
+}
+
+int vga_set_bga_mode(uint32_t width, uint32_t height, uint32_t bpp) {
+    if (!set_bga_mode(width, height, bpp)) return 0;
+    run_mode_hooks();
+    return 1;
+}
+
+// VESA modes cannot be set in long mode - BIOS interrupts don't work.
+// Use the bootloader's framebuffer if it already has the requested
+// resolution (reporting its real depth), else program the BGA directly.
+static int vga_init_vesa_mode(vga_mode_t mode, uint32_t width, uint32_t height, uint32_t bpp) {
+    const multiboot_tag_framebuffer_t* tag = boot_framebuffer ? boot_framebuffer : find_boot_framebuffer();
+    if (tag && tag->width == width && tag->height == height) {
+        if (!vga_init_linear_framebuffer()) return 0;
+    } else if (!set_bga_mode(width, height, bpp)) {
+        return 0;
     }
-    return 0; // Cannot set VESA mode in long mode
+    current_vga_mode = mode;
+    return 1;
+}
+
+int vga_init_mode101h(void) {
+    return vga_init_vesa_mode(VGA_MODE_101H, VGA_MODE_101H_WIDTH, VGA_MODE_101H_HEIGHT, COLOR_DEPTH_8BIT);
+}
+
+int vga_init_mode103h(void) {
+    return vga_init_vesa_mode(VGA_MODE_103H, VGA_MODE_103H_WIDTH, VGA_MODE_103H_HEIGHT, COLOR_DEPTH_8BIT);
+}
+
+int vga_init_mode118h(void) {
+    return vga_init_vesa_mode(VGA_MODE_118H, VGA_MODE_118H_WIDTH, VGA_MODE_118H_HEIGHT, COLOR_DEPTH_24BIT);
 }
 
 int vga_set_mode(vga_mode_t mode) {
@@ -111,12 +320,21 @@ int vga_set_mode(vga_mode_t mode) {
         case VGA_MODE_118H:
             result = vga_init_mode118h();
             break;
+        case VGA_MODE_LFB:
+            result = vga_init_linear_framebuffer();
+            break;
+        case VGA_MODE_BGA:
+            result = set_bga_mode(VGA_MODE_118H_WIDTH, VGA_MODE_118H_HEIGHT, COLOR_DEPTH_32BIT);
+            break;
         default:
             result = 0; // Unknown mode
             break;
     }
 
+    vga_select_format();
     graphics_initialized = result;
+    // Even a failed set may have changed the size (mode 12h does)
+    run_mode_hooks();
     return result;
 }
 
@@ -124,52 +342,8 @@ void vga_set_pixel(uint32_t x, uint32_t y, uint32_t color) {
     if (!graphics_initialized || x >= current_vga_width || y >= current_vga_height) {
         return;
     }
-
-    uint32_t offset = y * current_vga_width + x;
-
-    // For VGA mode 13h (320x200x256), always use 8-bit palette mode
-    if (current_vga_mode == VGA_MODE_13H || current_color_depth == COLOR_DEPTH_8BIT) {
-        ((uint8_t*)vga_framebuffer)[offset] = (uint8_t)color;
-        return;
-    }
-
-    // Handle other modes with different color depths
-    switch (current_color_depth) {
-        case COLOR_DEPTH_8BIT:
-            // 8-bit palette mode
-            switch (current_vga_mode) {
-                case VGA_MODE_13H:
-                case VGA_MODE_101H:
-                case VGA_MODE_103H:
-                    ((uint8_t*)vga_framebuffer)[offset] = (uint8_t)color;
-                    break;
-                case VGA_MODE_12H:
-                    // Planar mode - simplified (only 16 colors)
-                    ((uint8_t*)vga_framebuffer)[offset] = (uint8_t)(color & 0x0F);
-                    break;
-            }
-            break;
-
-        case COLOR_DEPTH_16BIT:
-            // 16-bit RGB (5:6:5)
-            ((uint16_t*)vga_framebuffer)[offset] = (uint16_t)color;
-            break;
-
-        case COLOR_DEPTH_24BIT:
-            // 24-bit RGB
-            {
-                uint8_t* pixel = (uint8_t*)vga_framebuffer + (offset * 3);
-                pixel[0] = (color >> 16) & 0xFF; // Red
-                pixel[1] = (color >> 8) & 0xFF;  // Green
-                pixel[2] = color & 0xFF;         // Blue
-            }
-            break;
-
-        case COLOR_DEPTH_32BIT:
-            // 32-bit RGBA
-            ((uint32_t*)vga_framebuffer)[offset] = color;
-            break;
-    }
+    vga_format->fill_span(vga_pixel_address(x, y), 1, color);
+    vga_mark((int32_t)x, (int32_t)y, 1, 1);
 }
 
 uint32_t vga_get_pixel(uint32_t x, uint32_t y) {
@@ -177,117 +351,88 @@ uint32_t vga_get_pixel(uint32_t x, uint32_t y) {
         return 0;
     }
 
-    uint32_t offset = y * current_vga_width + x;
+    uint8_t* row = vga_scanline(y);
 
     switch (current_color_depth) {
         case COLOR_DEPTH_8BIT:
-            return ((uint8_t*)vga_framebuffer)[offset];
+            return row[x];
 
         case COLOR_DEPTH_16BIT:
-            return ((uint16_t*)vga_framebuffer)[offset];
+            return ((uint16_t*)row)[x];
 
         case COLOR_DEPTH_24BIT:
             {
-                uint8_t* pixel = (uint8_t*)vga_framebuffer + (offset * 3);
-                return (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+                uint8_t* pixel = row + (x * 3);
+                return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
             }
 
         case COLOR_DEPTH_32BIT:
-            return ((uint32_t*)vga_framebuffer)[offset];
+            return ((uint32_t*)row)[x];
 
         default:
             return 0;
     }
 }
 
-void vga_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color) {
-    for (uint32_t py = y; py < y + height && py < current_vga_height; py++) {
-        for (uint32_t px = x; px < x + width && px < current_vga_width; px++) {
-            vga_set_pixel(px, py, color);
-        }
-    }
+void vga_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    vga_fast_fill_rect(x, y, width, height, color);
 }
 
-void vga_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color) {
+void vga_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color) {
     // Clamp to screen bounds
-    if (x >= current_vga_width || y >= current_vga_height) return;
-    if (x + width > current_vga_width) width = current_vga_width - x;
-    if (y + height > current_vga_height) height = current_vga_height - y;
-
-    for (uint32_t i = 0; i < width; i++) {
-        vga_set_pixel(x + i, y, color);
-        vga_set_pixel(x + i, y + height - 1, color);
-    }
-    for (uint32_t i = 0; i < height; i++) {
-        vga_set_pixel(x, y + i, color);
-        vga_set_pixel(x + width - 1, y + i, color);
+    if (!graphics_initialized || !vga_clip_rect(&x, &y, &width, &height)) return;
+    vga_mark((int32_t)x, (int32_t)y, width, height);
+
+    vga_format->fill_span(vga_pixel_address(x, y), width, color);
+    vga_format->fill_span(vga_pixel_address(x, y + height - 1), width, color);
+    for (uint32_t i = 1; i + 1 < height; i++) {
+        vga_format->fill_span(vga_pixel_address(x, y + i), 1, color);
+        vga_format->fill_span(vga_pixel_address(x + width - 1, y + i), 1, color);
     }
 }
 
 void vga_set_desktop_background(void) {
+    vga_draw_desktop_background(0, 0, current_vga_width, current_vga_height);
+}
+
+void vga_draw_desktop_background(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
     if (!graphics_initialized) {
         return; // Don't try to set background if graphics not initialized
     }
+    if (!vga_clip_rect(&x, &y, &width, &height)) return;
+    vga_mark((int32_t)x, (int32_t)y, width, height);
 
     // Create a simple gradient background adapted to current resolution
-    for (uint32_t y = 0; y < current_vga_height; y++) {
-        for (uint32_t x = 0; x < current_vga_width; x++) {
-            // A simple gradient from blue to black
-            uint8_t gradient_color = (uint8_t)(COLOR_BLUE + (y / (current_vga_height / 16)));
-            vga_set_pixel(x, y, gradient_color);
-        }
+    uint32_t band_height = current_vga_height / 16;
+    if (band_height == 0) band_height = 1;
+    for (uint32_t row = y; row < y + height; row++) {
+        // A simple gradient from blue to black in 16 bands
+        uint32_t band = row / band_height;
+        if (band > 15) band = 15;
+        uint32_t gradient_color = rgb_to_color(0, 0, (uint8_t)(170 - band * 170 / 16), 255);
+        vga_format->fill_span(vga_pixel_address(x, row), width, gradient_color);
     }
 }
 
-void vga_clear(uint8_t color) {
-    uint32_t total_pixels = current_vga_width * current_vga_height;
-    for (uint32_t i = 0; i < total_pixels; i++) {
-        vga_framebuffer[i] = color;
-    }
+void vga_clear(uint32_t color) {
+    vga_fast_clear(color);
 }
 
 // Advanced drawing primitives implementation
 
 // Bresenham's line algorithm
-void vga_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint8_t color) {
-    int32_t dx = (int32_t)x2 - (int32_t)x1;
-    int32_t dy = (int32_t)y2 - (int32_t)y1;
-    int32_t dx_abs = dx < 0 ? -dx : dx;
-    int32_t dy_abs = dy < 0 ? -dy : dy;
-    int32_t px = x1;
-    int32_t py = y1;
-    int32_t sx = dx < 0 ? -1 : 1;
-    int32_t sy = dy < 0 ? -1 : 1;
-
-    vga_set_pixel(px, py, color);
-
-    if (dx_abs > dy_abs) {
-        int32_t err = dx_abs / 2;
-        while (px != x2) {
-            err -= dy_abs;
-            if (err < 0) {
-                py += sy;
-                err += dx_abs;
-            }
-            px += sx;
-            vga_set_pixel(px, py, color);
-        }
-    } else {
-        int32_t err = dy_abs / 2;
-        while (py != y2) {
-            err -= dx_abs;
-            if (err < 0) {
-                px += sx;
-                err += dy_abs;
-            }
-            py += sy;
-            vga_set_pixel(px, py, color);
-        }
-    }
+void vga_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t color) {
+    if (!graphics_initialized) return;
+
+    // Clipped before stepping; axis-aligned lines become span fills
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_draw_line(&target, (int32_t)x1, (int32_t)y1, (int32_t)x2, (int32_t)y2, color);
+    vga_mark_between((int32_t)x1, (int32_t)y1, (int32_t)x2, (int32_t)y2);
 }
 
 // Midpoint circle algorithm
-void vga_draw_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint8_t color) {
+void vga_draw_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint32_t color) {
     int32_t x = radius;
     int32_t y = 0;
     int32_t err = 0;
@@ -313,182 +458,243 @@ void vga_draw_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint
     }
 }
 
-void vga_fill_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint8_t color) {
-    int32_t x = radius;
-    int32_t y = 0;
-    int32_t err = 0;
-
-    while (x >= y) {
-        // Draw horizontal lines to fill the circle
-        vga_draw_horizontal_line(center_x - x, center_y + y, 2 * x + 1, color);
-        vga_draw_horizontal_line(center_x - x, center_y - y, 2 * x + 1, color);
-        vga_draw_horizontal_line(center_x - y, center_y + x, 2 * y + 1, color);
-        vga_draw_horizontal_line(center_x - y, center_y - x, 2 * y + 1, color);
+void vga_fill_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint32_t color) {
+    if (!graphics_initialized) return;
 
-        if (err <= 0) {
-            y += 1;
-            err += 2 * y + 1;
-        }
-        if (err > 0) {
-            x -= 1;
-            err -= 2 * x + 1;
-        }
-    }
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_fill_circle(&target, (int32_t)center_x, (int32_t)center_y, radius, color);
+    vga_mark((int32_t)center_x - (int32_t)radius, (int32_t)center_y - (int32_t)radius, 2 * radius + 1, 2 * radius + 1);
 }
 
 // Triangle drawing using line algorithm
-void vga_draw_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint8_t color) {
+void vga_draw_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint32_t color) {
     vga_draw_line(x1, y1, x2, y2, color);
     vga_draw_line(x2, y2, x3, y3, color);
     vga_draw_line(x3, y3, x1, y1, color);
 }
 
-// Triangle filling using scanline algorithm
-void vga_fill_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint8_t color) {
-    // Sort vertices by y-coordinate
-    if (y1 > y2) { uint32_t t = y1; y1 = y2; y2 = t; t = x1; x1 = x2; x2 = t; }
-    if (y2 > y3) { uint32_t t = y2; y2 = y3; y3 = t; t = x2; x2 = x3; x3 = t; }
-    if (y1 > y2) { uint32_t t = y1; y1 = y2; y2 = t; t = x1; x1 = x2; x2 = t; }
-
-    if (y1 == y3) return; // Degenerate triangle
+// Filled shapes go through the scanline span rasterizer (raster.c)
+void vga_fill_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint32_t color) {
+    if (!graphics_initialized) return;
 
-    int32_t dx1 = x2 - x1;
-    int32_t dy1 = y2 - y1;
-    int32_t dx2 = x3 - x1;
-    int32_t dy2 = y3 - y1;
-    int32_t dx3 = x3 - x2;
-    int32_t dy3 = y3 - y2;
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_fill_triangle(&target, (int32_t)x1, (int32_t)y1, (int32_t)x2, (int32_t)y2, (int32_t)x3, (int32_t)y3, color);
+    raster_point_t corners[3] = { { (int32_t)x1, (int32_t)y1 }, { (int32_t)x2, (int32_t)y2 }, { (int32_t)x3, (int32_t)y3 } };
+    vga_mark_points(corners, 3);
+}
 
-    int32_t sa = 0, sb = 0;
-    if (dy1) sa = dx1 << 16 / dy1;
-    if (dy2) sb = dx2 << 16 / dy2;
-    if (dy3) {
-        int32_t sc = dx3 << 16 / dy3;
-        sa = sc;
-    }
+void vga_fill_polygon(const raster_point_t* points, uint32_t count, uint32_t color) {
+    if (!graphics_initialized) return;
 
-    int32_t x_left = x1 << 16, x_right = x1 << 16;
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_fill_polygon(&target, points, count, color);
+    vga_mark_points(points, count);
+}
 
-    // First half
-    for (uint32_t y = y1; y <= y2; y++) {
-        vga_draw_horizontal_line(x_left >> 16, y, (x_right >> 16) - (x_left >> 16) + 1, color);
-        x_left += sa;
-        x_right += sb;
-    }
+void vga_fill_rounded_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t radius, uint32_t color) {
+    if (!graphics_initialized) return;
 
-    // Second half
-    x_left = x2 << 16;
-    for (uint32_t y = y2 + 1; y <= y3; y++) {
-        vga_draw_horizontal_line(x_left >> 16, y, (x_right >> 16) - (x_left >> 16) + 1, color);
-        x_left += sa;
-        x_right += sb;
-    }
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_fill_rounded_rect(&target, (int32_t)x, (int32_t)y, width, height, radius, color);
+    vga_mark((int32_t)x, (int32_t)y, width, height);
 }
 
 // Utility functions for performance
-void vga_draw_horizontal_line(uint32_t x, uint32_t y, uint32_t length, uint8_t color) {
-    if (y >= current_vga_height) return;
-    uint32_t start_x = x;
-    uint32_t end_x = x + length - 1;
-    if (start_x >= current_vga_width) return;
-    if (end_x >= current_vga_width) end_x = current_vga_width - 1;
+void vga_draw_horizontal_line(uint32_t x, uint32_t y, uint32_t length, uint32_t color) {
+    if (!graphics_initialized || length == 0) return;
 
-    for (uint32_t px = start_x; px <= end_x; px++) {
-        vga_set_pixel(px, y, color);
-    }
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_draw_line(&target, (int32_t)x, (int32_t)y, (int32_t)(x + length - 1), (int32_t)y, color);
+    vga_mark((int32_t)x, (int32_t)y, length, 1);
 }
 
-void vga_draw_vertical_line(uint32_t x, uint32_t y, uint32_t length, uint8_t color) {
-    if (x >= current_vga_width) return;
-    uint32_t start_y = y;
-    uint32_t end_y = y + length - 1;
-    if (start_y >= current_vga_height) return;
-    if (end_y >= current_vga_height) end_y = current_vga_height - 1;
+void vga_draw_vertical_line(uint32_t x, uint32_t y, uint32_t length, uint32_t color) {
+    if (!graphics_initialized || length == 0) return;
 
-    for (uint32_t py = start_y; py <= end_y; py++) {
-        vga_set_pixel(x, py, color);
-    }
+    raster_target_t target;
+    vga_raster_target(&target);
+    raster_draw_line(&target, (int32_t)x, (int32_t)y, (int32_t)x, (int32_t)(y + length - 1), color);
+    vga_mark((int32_t)x, (int32_t)y, 1, length);
 }
 
 // Performance optimized functions
-void vga_fast_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color) {
-    // Clamp to screen bounds
-    if (x >= current_vga_width || y >= current_vga_height) return;
-    if (x + width > current_vga_width) width = current_vga_width - x;
-    if (y + height > current_vga_height) height = current_vga_height - y;
-
-    // Use direct memory access for better performance
-    uint8_t* start = vga_framebuffer + (y * current_vga_width + x);
-    for (uint32_t row = 0; row < height; row++) {
-        uint8_t* row_start = start + (row * current_vga_width);
-        for (uint32_t col = 0; col < width; col++) {
-            row_start[col] = color;
+
+void vga_fast_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    // Clamp to screen bounds once, then fill whole spans
+    if (!graphics_initialized || !vga_clip_rect(&x, &y, &width, &height)) return;
+    vga_mark((int32_t)x, (int32_t)y, width, height);
+
+    uint8_t* row = vga_pixel_address(x, y);
+    for (uint32_t i = 0; i < height; i++, row += current_vga_pitch) {
+        vga_format->fill_span(row, width, color);
+    }
+}
+
+// Same-row moves go through a bounce buffer a chunk at a time, walking
+// away from the side the pixels move towards so no chunk is read after it
+// has been overwritten
+#define VGA_MOVE_CHUNK 4096
+static uint8_t vga_move_buffer[VGA_MOVE_CHUNK];
+
+static void vga_move_row(uint8_t* dst, const uint8_t* src, uint32_t bytes) {
+    if (dst < src) {
+        for (uint32_t done = 0; done < bytes; done += VGA_MOVE_CHUNK) {
+            uint32_t n = bytes - done < VGA_MOVE_CHUNK ? bytes - done : VGA_MOVE_CHUNK;
+            fast_copy(vga_move_buffer, src + done, n);
+            fast_copy(dst + done, vga_move_buffer, n);
+        }
+    } else {
+        for (uint32_t left = bytes; left > 0;) {
+            uint32_t n = left < VGA_MOVE_CHUNK ? left : VGA_MOVE_CHUNK;
+            left -= n;
+            fast_copy(vga_move_buffer, src + left, n);
+            fast_copy(dst + left, vga_move_buffer, n);
         }
     }
 }
 
-void vga_fast_clear(uint8_t color) {
-    // Use 32-bit operations for faster clearing when possible
-    uint32_t* framebuffer_32 = (uint32_t*)vga_framebuffer;
-    uint32_t color_32 = color | (color << 8) | (color << 16) | (color << 24);
-    uint32_t pixel_count = current_vga_width * current_vga_height;
-    uint32_t dword_count = pixel_count / 4;
+int vga_move_rect(uint32_t src_x, uint32_t src_y, uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height) {
+    if (!graphics_initialized || width == 0 || height == 0) return 0;
+    if (width > current_vga_width || height > current_vga_height) return 0;
+    if (src_x > current_vga_width - width || dest_x > current_vga_width - width) return 0;
+    if (src_y > current_vga_height - height || dest_y > current_vga_height - height) return 0;
+    if (src_x == dest_x && src_y == dest_y) return 1;
+    vga_mark((int32_t)dest_x, (int32_t)dest_y, width, height);
+
+    uint32_t bytes = width * vga_format->bytes_per_pixel;
+    if (src_y == dest_y) {
+        for (uint32_t y = src_y; y < src_y + height; y++) {
+            vga_move_row(vga_pixel_address(dest_x, y), vga_pixel_address(src_x, y), bytes);
+        }
+        return 1;
+    }
 
-    for (uint32_t i = 0; i < dword_count; i++) {
-        framebuffer_32[i] = color_32;
+    // Different scanlines never overlap; copy rows in the order that reads
+    // each source row before the destination reaches it
+    for (uint32_t i = 0; i < height; i++) {
+        uint32_t row = dest_y > src_y ? height - 1 - i : i;
+        fast_copy(vga_pixel_address(dest_x, dest_y + row), vga_pixel_address(src_x, src_y + row), bytes);
     }
+    return 1;
+}
 
-    // Handle remaining pixels
-    uint32_t remaining = pixel_count % 4;
-    uint8_t* remaining_pixels = (uint8_t*)&framebuffer_32[dword_count];
-    for (uint32_t i = 0; i < remaining; i++) {
-        remaining_pixels[i] = color;
+void vga_fast_clear(uint32_t color) {
+    if (!vga_format) vga_select_format();
+    if (vga_shadowed) damage_add_full(&vga_shadowed->damage);
+
+    // Without padding between scanlines the screen is one long span
+    if (current_vga_pitch == current_vga_width * vga_format->bytes_per_pixel) {
+        vga_format->fill_span(vga_framebuffer, current_vga_width * current_vga_height, color);
+        return;
+    }
+    for (uint32_t y = 0; y < current_vga_height; y++) {
+        vga_format->fill_span(vga_scanline(y), current_vga_width, color);
     }
 }
 
-// Basic bitmap font rendering (8x8 characters)
-// Font data is now in font.c and included via font.h
+// Framebuffer memory type
 
-void vga_draw_char(uint32_t x, uint32_t y, char c, uint8_t color) {
-    if ((uint8_t)c < 32 || (uint8_t)c > 126) return; // Only printable ASCII (32-126, excluding DEL)
+#define VGA_BENCH_CLEARS 16
 
-    const uint8_t* char_bitmap = font_8x8[(uint8_t)c - 32];
+// Physical range behind the current mode (every page when flipping)
+static uint64_t vga_framebuffer_start(void) {
+    return bga_active ? bga_framebuffer_phys() : (uint64_t)vga_framebuffer;
+}
 
-    for (uint32_t row = 0; row < 8; row++) {
-        uint8_t row_data = char_bitmap[row];
-        for (uint32_t col = 0; col < 8; col++) {
-            if (row_data & (1 << (7 - col))) {
-                vga_set_pixel(x + col, y + row, color);
-            }
-        }
-    }
+static uint64_t vga_framebuffer_size(void) {
+    if (bga_active) return bga_framebuffer_size();
+    if ((uint64_t)vga_framebuffer == VGA_GRAPHICS_BUFFER) return VGA_LEGACY_WINDOW_SIZE;
+    return (uint64_t)current_vga_pitch * current_vga_height;
 }
 
-void vga_draw_string(uint32_t x, uint32_t y, const char* str, uint8_t color) {
-    if (!str) return; // NULL check
-    uint32_t current_x = x;
-    uint32_t line_height = 10; // Character line height
-    uint32_t char_width = 8;  // Character width
-    while (*str) {
-        if (*str == '\n') {
-            y += line_height;
-            current_x = x;
-        } else {
-            vga_draw_char(current_x, y, *str, color);
-            current_x += char_width;
+int vga_map_framebuffer(pat_type_t type) {
+    uint64_t base = vga_framebuffer_start() & ~(uint64_t)(VMM_PAGE_4K - 1);
+    uint64_t end = vga_framebuffer_start() + vga_framebuffer_size();
+    end = (end + VMM_PAGE_4K - 1) & ~(uint64_t)(VMM_PAGE_4K - 1);
+    return pat_map_range(base, base, end - base, type);
+}
+
+uint32_t vga_benchmark_memory_types(vga_clear_timing_t* results, uint32_t max_results) {
+    static const pat_type_t types[VGA_BENCH_MAX_TYPES] = {
+        PAT_TYPE_UC, PAT_TYPE_WT, PAT_TYPE_WB, PAT_TYPE_WC
+    };
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < VGA_BENCH_MAX_TYPES && count < max_results; i++) {
+        // Without PAT, WC falls back to UC- and would only repeat the UC run
+        if (types[i] == PAT_TYPE_WC && !pat_supported()) continue;
+        if (!vga_map_framebuffer(types[i])) continue;
+
+        vga_fast_clear(0); // Warm up the TLB
+        uint64_t start = rdtsc();
+        for (uint32_t n = 0; n < VGA_BENCH_CLEARS; n++) {
+            vga_fast_clear((uint8_t)n);
         }
-        str++;
+        uint64_t end = rdtsc();
+
+        results[count].type = types[i];
+        results[count].cycles_per_clear = (end - start) / VGA_BENCH_CLEARS;
+        count++;
     }
+
+    vga_map_framebuffer(PAT_TYPE_WC);
+    vga_fast_clear(0);
+    return count;
+}
+
+// Basic bitmap font rendering (8x8 characters)
+// Font data is now in font.c and included via font.h
+
+static void vga_glyph_target(glyph_target_t* target) {
+    target->pixels = vga_framebuffer;
+    target->pitch = current_vga_pitch;
+    target->format = vga_format;
+    target->clip_x1 = 0;
+    target->clip_y1 = 0;
+    target->clip_x2 = (int32_t)current_vga_width;
+    target->clip_y2 = (int32_t)current_vga_height;
+}
+
+static void render_buffer_glyph_target(render_buffer_t* buffer, glyph_target_t* target) {
+    target->pixels = (uint8_t*)buffer->pixels;
+    target->pitch = buffer->width * sizeof(uint32_t);
+    target->format = pixel_format_for_depth(COLOR_DEPTH_32BIT);
+    target->clip_x1 = 0;
+    target->clip_y1 = 0;
+    target->clip_x2 = (int32_t)buffer->width;
+    target->clip_y2 = (int32_t)buffer->height;
+}
+
+void vga_draw_char(uint32_t x, uint32_t y, char c, uint32_t color) {
+    if (!graphics_initialized) return;
+
+    glyph_target_t target;
+    vga_glyph_target(&target);
+    glyph_draw(glyph_cache_lookup(c, color, vga_format), &target, (int32_t)x, (int32_t)y);
+    vga_mark((int32_t)x, (int32_t)y, GLYPH_WIDTH, GLYPH_HEIGHT);
+}
+
+void vga_draw_string(uint32_t x, uint32_t y, const char* str, uint32_t color) {
+    if (!str || !graphics_initialized) return; // NULL check
+
+    glyph_target_t target;
+    uint32_t width, height;
+    vga_glyph_target(&target);
+    glyph_draw_text(&target, (int32_t)x, (int32_t)y, str, color, &width, &height);
+    vga_mark((int32_t)x, (int32_t)y, width, height);
 }
 
 // Color conversion utilities
 uint32_t rgb_to_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
     switch (current_color_depth) {
         case COLOR_DEPTH_8BIT:
-            // Improved palette approximation using weighted average
-            // Standard luminance formula: 0.299*R + 0.587*G + 0.114*B
-            uint32_t luminance = (r * 299 + g * 587 + b * 114) / 1000;
-            return luminance % 256;
+            // Nearest entry of the fixed palette
+            return palette_index(((uint32_t)r << 16) | ((uint32_t)g << 8) | b);
 
         case COLOR_DEPTH_16BIT:
             // 5:6:5 RGB
@@ -507,11 +713,17 @@ uint32_t rgb_to_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
     }
 }
 
+uint32_t argb_to_color(uint32_t argb) {
+    return rgb_to_color((uint8_t)(argb >> 16), (uint8_t)(argb >> 8), (uint8_t)argb, (uint8_t)(argb >> 24));
+}
+
 void color_to_rgb(uint32_t color, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a) {
     switch (current_color_depth) {
         case COLOR_DEPTH_8BIT:
-            // Simple grayscale approximation
-            *r = *g = *b = (uint8_t)color;
+            // Palette entry the index refers to
+            *r = (palette_colors[color & 0xFF] >> 16) & 0xFF;
+            *g = (palette_colors[color & 0xFF] >> 8) & 0xFF;
+            *b = palette_colors[color & 0xFF] & 0xFF;
             *a = 255;
             break;
 
@@ -543,13 +755,39 @@ void color_to_rgb(uint32_t color, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a
 
 // Software rendering pipeline implementation
 
+// Pixel storage above this size is reserved through the VMM and backed with
+// zeroed frames on first touch, so large buffers only cost the pages drawn to
+#define LAZY_PIXEL_THRESHOLD (64 * 1024)
+
+static uint32_t* alloc_pixels(size_t bytes, int* zeroed) {
+    if (bytes >= LAZY_PIXEL_THRESHOLD) {
+        void* pixels = vmm_reserve(bytes, VMM_WRITABLE);
+        if (pixels) {
+            if (zeroed) *zeroed = 1;
+            return (uint32_t*)pixels;
+        }
+    }
+    if (zeroed) *zeroed = 0;
+    return (uint32_t*)kmalloc(bytes);
+}
+
+static void free_pixels(uint32_t* pixels) {
+    if (!pixels) return;
+    if (vmm_is_reserved(pixels)) {
+        vmm_release(pixels);
+    } else {
+        kfree(pixels);
+    }
+}
+
 render_buffer_t* create_render_buffer(uint32_t width, uint32_t height) {
     render_buffer_t* buffer = (render_buffer_t*)kmalloc(sizeof(render_buffer_t));
     if (!buffer) return 0;
 
     buffer->width = width;
     buffer->height = height;
-    buffer->pixels = (uint32_t*)kmalloc(width * height * sizeof(uint32_t));
+    buffer->damage = 0;
+    buffer->pixels = alloc_pixels((size_t)width * height * sizeof(uint32_t), 0);
 
     if (!buffer->pixels) {
         kfree(buffer);
@@ -561,9 +799,7 @@ render_buffer_t* create_render_buffer(uint32_t width, uint32_t height) {
 
 void destroy_render_buffer(render_buffer_t* buffer) {
     if (buffer) {
-        if (buffer->pixels) {
-            kfree(buffer->pixels);
-        }
+        free_pixels(buffer->pixels);
         kfree(buffer);
     }
 }
@@ -571,73 +807,85 @@ void destroy_render_buffer(render_buffer_t* buffer) {
 void clear_render_buffer(render_buffer_t* buffer, uint32_t color) {
     if (!buffer || !buffer->pixels) return;
 
-    uint32_t total_pixels = buffer->width * buffer->height;
-    for (uint32_t i = 0; i < total_pixels; i++) {
-        buffer->pixels[i] = color;
-    }
+    fast_fill(buffer->pixels, color, (size_t)buffer->width * buffer->height * sizeof(uint32_t));
+    damage_add_full(buffer->damage);
 }
 
 void render_buffer_to_screen(render_buffer_t* buffer, uint32_t screen_x, uint32_t screen_y) {
     if (!buffer || !buffer->pixels) return;
+    vga_blit_buffer(buffer->pixels, buffer->width, buffer->height, screen_x, screen_y, buffer->width, buffer->height);
+}
 
-    for (uint32_t y = 0; y < buffer->height; y++) {
-        for (uint32_t x = 0; x < buffer->width; x++) {
-            uint32_t screen_pos_x = screen_x + x;
-            uint32_t screen_pos_y = screen_y + y;
+// Software rendering primitives. Each public primitive marks its bounding
+// box once; the internal helpers below only write pixels.
 
-            if (screen_pos_x < current_vga_width && screen_pos_y < current_vga_height) {
-                uint32_t color = buffer->pixels[y * buffer->width + x];
-                vga_set_pixel(screen_pos_x, screen_pos_y, color);
-            }
+static inline void mark_damage(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (buffer->damage) damage_add(buffer->damage, x, y, width, height);
+}
+
+// Bounding box of the span between two coordinates
+static inline void mark_damage_between(render_buffer_t* buffer, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    int32_t left = x1 < x2 ? x1 : x2;
+    int32_t top = y1 < y2 ? y1 : y2;
+    mark_damage(buffer, left, top, (uint32_t)((x1 < x2 ? x2 : x1) - left) + 1,
+                (uint32_t)((y1 < y2 ? y2 : y1) - top) + 1);
+}
+
+void render_buffer_raster_target(render_buffer_t* buffer, raster_target_t* target) {
+    target->pixels = (uint8_t*)buffer->pixels;
+    target->pitch = buffer->width * sizeof(uint32_t);
+    target->format = pixel_format_for_depth(COLOR_DEPTH_32BIT);
+    target->clip_x1 = 0;
+    target->clip_y1 = 0;
+    target->clip_x2 = (int32_t)buffer->width;
+    target->clip_y2 = (int32_t)buffer->height;
+}
+
+void render_buffer_flush_display_list(render_buffer_t* buffer, display_list_t* list, display_list_stats_t* stats) {
+    if (!buffer || !buffer->pixels) {
+        display_list_reset(list);
+        return;
+    }
+
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    display_list_flush(list, &target, buffer->damage, stats);
+}
+
+void draw_sprites_software(render_buffer_t* buffer, const sprite_instance_t* instances, uint32_t count) {
+    if (!buffer || !buffer->pixels || !instances) return;
+
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    sprite_draw_batch(&target, instances, count);
+    if (buffer->damage) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (!instances[i].sprite) continue;
+            mark_damage(buffer, instances[i].x, instances[i].y, instances[i].sprite->width, instances[i].sprite->height);
         }
     }
 }
 
-// Software rendering primitives
+static inline void put_pixel(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t color) {
+    if (x < 0 || y < 0 || x >= (int32_t)buffer->width || y >= (int32_t)buffer->height) return;
+    buffer->pixels[y * buffer->width + x] = color;
+}
 
 void draw_pixel_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t color) {
     if (!buffer || !buffer->pixels) return;
     if (x < 0 || y < 0 || x >= (int32_t)buffer->width || y >= (int32_t)buffer->height) return;
 
     buffer->pixels[y * buffer->width + x] = color;
+    mark_damage(buffer, x, y, 1, 1);
 }
 
 void draw_line_software(render_buffer_t* buffer, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
-    if (!buffer) return;
+    if (!buffer || !buffer->pixels) return;
 
-    int32_t dx = x2 - x1;
-    int32_t dy = y2 - y1;
-    int32_t dx_abs = dx < 0 ? -dx : dx;
-    int32_t dy_abs = dy < 0 ? -dy : dy;
-    int32_t px = x1;
-    int32_t py = y1;
-    int32_t sx = dx < 0 ? -1 : 1;
-    int32_t sy = dy < 0 ? -1 : 1;
-
-    draw_pixel_software(buffer, px, py, color);
-
-    if (dx_abs > dy_abs) {
-        int32_t err = dx_abs / 2;
-        while (px != x2) {
-            err -= dy_abs;
-            if (err < 0) {
-                py += sy;
-                err += dx_abs;
-            }
-            px += sx;
-            draw_pixel_software(buffer, px, py, color);
-        }
-    } else {
-        int32_t err = dy_abs / 2;
-        while (py != y2) {
-            err -= dx_abs;
-            if (err < 0) {
-                px += sx;
-                err += dy_abs;
-            }
-            py += sy;
-            draw_pixel_software(buffer, px, py, color);
-        }
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    if (raster_draw_line(&target, x1, y1, x2, y2, color)) {
+        mark_damage_between(buffer, x1, y1, x2, y2);
     }
 }
 
@@ -660,33 +908,31 @@ void fill_rect_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t
     int32_t start_y = y < 0 ? 0 : y;
     int32_t end_x = x + width > (int32_t)buffer->width ? buffer->width : x + width;
     int32_t end_y = y + height > (int32_t)buffer->height ? buffer->height : y + height;
+    if (start_x >= end_x || start_y >= end_y) return;
 
+    size_t span_bytes = (size_t)(end_x - start_x) * sizeof(uint32_t);
     for (int32_t py = start_y; py < end_y; py++) {
-        for (int32_t px = start_x; px < end_x; px++) {
-            uint32_t index = (uint32_t)py * buffer->width + (uint32_t)px;
-            if (index < buffer->width * buffer->height) {
-                buffer->pixels[index] = color;
-            }
-        }
+        fast_fill(&buffer->pixels[(uint32_t)py * buffer->width + (uint32_t)start_x], color, span_bytes);
     }
+    mark_damage(buffer, start_x, start_y, (uint32_t)(end_x - start_x), (uint32_t)(end_y - start_y));
 }
 
 void draw_circle_software(render_buffer_t* buffer, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color) {
-    if (!buffer || radius == 0) return;
+    if (!buffer || !buffer->pixels || radius == 0) return;
 
     int32_t x = radius;
     int32_t y = 0;
     int32_t err = 0;
 
     while (x >= y) {
-        draw_pixel_software(buffer, center_x + x, center_y + y, color);
-        draw_pixel_software(buffer, center_x + y, center_y + x, color);
-        draw_pixel_software(buffer, center_x - y, center_y + x, color);
-        draw_pixel_software(buffer, center_x - x, center_y + y, color);
-        draw_pixel_software(buffer, center_x - x, center_y - y, color);
-        draw_pixel_software(buffer, center_x - y, center_y - x, color);
-        draw_pixel_software(buffer, center_x + y, center_y - x, color);
-        draw_pixel_software(buffer, center_x + x, center_y - y, color);
+        put_pixel(buffer, center_x + x, center_y + y, color);
+        put_pixel(buffer, center_x + y, center_y + x, color);
+        put_pixel(buffer, center_x - y, center_y + x, color);
+        put_pixel(buffer, center_x - x, center_y + y, color);
+        put_pixel(buffer, center_x - x, center_y - y, color);
+        put_pixel(buffer, center_x - y, center_y - x, color);
+        put_pixel(buffer, center_x + y, center_y - x, color);
+        put_pixel(buffer, center_x + x, center_y - y, color);
 
         if (err <= 0) {
             y += 1;
@@ -697,113 +943,155 @@ void draw_circle_software(render_buffer_t* buffer, int32_t center_x, int32_t cen
             err -= 2 * x + 1;
         }
     }
+    mark_damage(buffer, center_x - (int32_t)radius, center_y - (int32_t)radius, 2 * radius + 1, 2 * radius + 1);
 }
 
 void fill_circle_software(render_buffer_t* buffer, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color) {
-    if (!buffer || radius == 0) return;
+    if (!buffer || !buffer->pixels || radius == 0) return;
 
-    int32_t x = radius;
-    int32_t y = 0;
-    int32_t err = 0;
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    raster_fill_circle(&target, center_x, center_y, radius, color);
+    mark_damage(buffer, center_x - (int32_t)radius, center_y - (int32_t)radius, 2 * radius + 1, 2 * radius + 1);
+}
 
-    while (x >= y) {
-        // Draw horizontal lines to fill the circle
-        draw_line_software(buffer, center_x - x, center_y + y, center_x + x, center_y + y, color);
-        draw_line_software(buffer, center_x - x, center_y - y, center_x + x, center_y - y, color);
-        draw_line_software(buffer, center_x - y, center_y + x, center_x + y, center_y + x, color);
-        draw_line_software(buffer, center_x - y, center_y - x, center_x + y, center_y - x, color);
+void fill_triangle_software(render_buffer_t* buffer, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                            int32_t x3, int32_t y3, uint32_t color) {
+    raster_point_t points[3] = { { x1, y1 }, { x2, y2 }, { x3, y3 } };
+    fill_polygon_software(buffer, points, 3, color);
+}
 
-        if (err <= 0) {
-            y += 1;
-            err += 2 * y + 1;
-        }
-        if (err > 0) {
-            x -= 1;
-            err -= 2 * x + 1;
-        }
+void fill_polygon_software(render_buffer_t* buffer, const raster_point_t* points, uint32_t count, uint32_t color) {
+    if (!buffer || !buffer->pixels || !points || count == 0) return;
+
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    raster_fill_polygon(&target, points, count, color);
+
+    int32_t left = points[0].x, top = points[0].y, right = points[0].x, bottom = points[0].y;
+    for (uint32_t i = 1; i < count; i++) {
+        if (points[i].x < left) left = points[i].x;
+        if (points[i].x > right) right = points[i].x;
+        if (points[i].y < top) top = points[i].y;
+        if (points[i].y > bottom) bottom = points[i].y;
     }
+    mark_damage(buffer, left, top, (uint32_t)(right - left), (uint32_t)(bottom - top));
 }
 
-// Alpha blending function
-uint32_t blend_colors(uint32_t src, uint32_t dst) {
-    uint8_t src_a = (src >> 24) & 0xFF;
-    uint8_t src_r = (src >> 16) & 0xFF;
-    uint8_t src_g = (src >> 8) & 0xFF;
-    uint8_t src_b = src & 0xFF;
+void fill_rounded_rect_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t width, uint32_t height,
+                                uint32_t radius, uint32_t color) {
+    if (!buffer || !buffer->pixels) return;
+
+    raster_target_t target;
+    render_buffer_raster_target(buffer, &target);
+    raster_fill_rounded_rect(&target, x, y, width, height, radius, color);
+    mark_damage(buffer, x, y, width, height);
+}
+
+// Text into a render buffer. Colours are 0xAARRGGBB as for the other
+// software primitives.
+void draw_char_software(render_buffer_t* buffer, int32_t x, int32_t y, char c, uint32_t color) {
+    if (!buffer || !buffer->pixels) return;
 
-    uint8_t dst_a = (dst >> 24) & 0xFF;
-    uint8_t dst_r = (dst >> 16) & 0xFF;
-    uint8_t dst_g = (dst >> 8) & 0xFF;
-    uint8_t dst_b = dst & 0xFF;
+    glyph_target_t target;
+    render_buffer_glyph_target(buffer, &target);
+    glyph_draw(glyph_cache_lookup(c, color, target.format), &target, x, y);
+    mark_damage(buffer, x, y, GLYPH_WIDTH, GLYPH_HEIGHT);
+}
 
-    // Proper alpha blending formula
-    uint32_t out_a = src_a + dst_a * (255 - src_a) / 255;
-    if (out_a == 0) return 0; // Avoid division by zero
+void draw_string_software(render_buffer_t* buffer, int32_t x, int32_t y, const char* str, uint32_t color) {
+    if (!buffer || !buffer->pixels || !str) return;
 
-    uint32_t out_r = (src_r * src_a + dst_r * dst_a * (255 - src_a) / 255) / out_a;
-    uint32_t out_g = (src_g * src_a + dst_g * dst_a * (255 - src_a) / 255) / out_a;
-    uint32_t out_b = (src_b * src_a + dst_b * dst_a * (255 - src_a) / 255) / out_a;
+    glyph_target_t target;
+    uint32_t width, height;
+    render_buffer_glyph_target(buffer, &target);
+    glyph_draw_text(&target, x, y, str, color, &width, &height);
+    mark_damage(buffer, x, y, width, height);
+}
 
-    return ((uint8_t)out_a << 24) | ((uint8_t)out_r << 16) | ((uint8_t)out_g << 8) | (uint8_t)out_b;
+// Straight-alpha "over" for one pixel, computed in premultiplied form so
+// the only division left is the table lookup in unpremultiply_pixel
+uint32_t blend_colors(uint32_t src, uint32_t dst) {
+    return unpremultiply_pixel(blend_premultiplied(premultiply_pixel(src), premultiply_pixel(dst)));
 }
 
 // Graphics acceleration optimizations
 
 void vga_blit_buffer(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
                       uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height) {
-    if (!src_buffer || width == 0 || height == 0) return;
+    if (!src_buffer || width == 0 || height == 0 || !graphics_initialized) return;
+
+    // Clip against the source, then the screen, once for the whole blit
+    if (width > src_width) width = src_width;
+    if (height > src_height) height = src_height;
+    if (!vga_clip_rect(&dest_x, &dest_y, &width, &height)) return;
+    vga_mark((int32_t)dest_x, (int32_t)dest_y, width, height);
+
+    uint8_t* dst = vga_pixel_address(dest_x, dest_y);
+    const uint32_t* src = src_buffer;
+    for (uint32_t y = 0; y < height; y++, dst += current_vga_pitch, src += src_width) {
+        if (current_color_depth == COLOR_DEPTH_8BIT) {
+            // Quantise with the dither pattern anchored to the screen
+            palette_convert_span(dst, src, width, dest_x, dest_y + y);
+        } else {
+            vga_format->convert_span(dst, src, width);
+        }
+    }
+}
 
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t src_x = x;
-            uint32_t src_y = y;
+void vga_blend_buffer(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
+                      uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height) {
+    if (!src_buffer || width == 0 || height == 0 || !graphics_initialized) return;
 
-            if (src_x < src_width && src_y < src_height) {
-                uint32_t color = src_buffer[src_y * src_width + src_x];
-                vga_set_pixel(dest_x + x, dest_y + y, color);
-            }
-        }
+    if (width > src_width) width = src_width;
+    if (height > src_height) height = src_height;
+    if (!vga_clip_rect(&dest_x, &dest_y, &width, &height)) return;
+    vga_mark((int32_t)dest_x, (int32_t)dest_y, width, height);
+
+    uint8_t* dst = vga_pixel_address(dest_x, dest_y);
+    const uint32_t* src = src_buffer;
+    for (uint32_t y = 0; y < height; y++, dst += current_vga_pitch, src += src_width) {
+        vga_format->blend_span(dst, src, width);
     }
 }
 
 void vga_blit_buffer_scaled(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
                             uint32_t dest_x, uint32_t dest_y, uint32_t dest_width, uint32_t dest_height) {
-    if (!src_buffer || src_width == 0 || src_height == 0 || dest_width == 0 || dest_height == 0) return;
-
-    for (uint32_t dy = 0; dy < dest_height; dy++) {
-        for (uint32_t dx = 0; dx < dest_width; dx++) {
-            // Bilinear scaling
-            uint32_t sx = (dx * src_width) / dest_width;
-            uint32_t sy = (dy * src_height) / dest_height;
+    vga_blit_buffer_filtered(src_buffer, src_width, src_height, dest_x, dest_y,
+                             dest_width, dest_height, SCALE_NEAREST);
+}
 
-            if (sx < src_width && sy < src_height) {
-                uint32_t color = src_buffer[sy * src_width + sx];
-                vga_set_pixel(dest_x + dx, dest_y + dy, color);
-            }
-        }
-    }
+void vga_blit_buffer_filtered(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
+                              uint32_t dest_x, uint32_t dest_y, uint32_t dest_width, uint32_t dest_height,
+                              scale_filter_t filter) {
+    if (!src_buffer || src_width == 0 || src_height == 0 || dest_width == 0 || dest_height == 0) return;
+    if (!graphics_initialized) return;
+
+    uint32_t width = dest_width;
+    uint32_t height = dest_height;
+    if (!vga_clip_rect(&dest_x, &dest_y, &width, &height)) return;
+    vga_mark((int32_t)dest_x, (int32_t)dest_y, width, height);
+
+    scale_target_t target;
+    target.pixels = vga_pixel_address(dest_x, dest_y);
+    target.pitch = current_vga_pitch;
+    target.format = vga_format;
+    target.x = dest_x;
+    target.y = dest_y;
+    target.width = width;
+    target.height = height;
+    scale_blit(&target, src_buffer, src_width, src_height, dest_width, dest_height, filter);
 }
 
-// Fast memory operations using inline assembly for better performance
+// Fast memory operations - vector kernels chosen at boot (see simd.c)
 void vga_memcpy_fast(void* dest, const void* src, uint32_t count) {
     if (!dest || !src || count == 0) return; // NULL and zero checks
-    __asm__ volatile (
-        "rep movsb"
-        : "+D"(dest), "+S"(src), "+c"(count)
-        :
-        : "memory"
-    );
+    fast_copy(dest, src, count);
 }
 
 void vga_memset_fast(void* dest, uint32_t value, uint32_t count) {
     if (!dest || count == 0) return; // NULL and zero checks
-    // Simple implementation for freestanding environment
-    uint8_t* dest8 = (uint8_t*)dest;
-    uint8_t value8 = value & 0xFF;
-
-    for (uint32_t i = 0; i < count; i++) {
-        dest8[i] = value8;
-    }
+    fast_fill(dest, (value & 0xFF) * 0x01010101U, count);
 }
 
 // Double buffering implementation
@@ -814,50 +1102,188 @@ double_buffer_t* create_double_buffer(uint32_t width, uint32_t height) {
     db->width = width;
     db->height = height;
     db->current_buffer = 0;
+    db->hardware = 0;
+    db->shadow = 0;
+    damage_init(&db->damage, width, height);
+    damage_init(&db->stale[0], width, height);
+    damage_init(&db->stale[1], width, height);
+    db->target.width = width;
+    db->target.height = height;
+    db->target.damage = &db->damage;
 
     uint32_t buffer_size = width * height * sizeof(uint32_t);
 
-    db->front_buffer = (uint32_t*)kmalloc(buffer_size);
-    db->back_buffer = (uint32_t*)kmalloc(buffer_size);
+    // One full-screen 32bpp buffer on the BGA uses the two on-card pages.
+    // Drawing, immediate-mode drawing included, goes to a shadow in system
+    // RAM; presenting writes the damage into the hidden page and moves the
+    // Y offset, so VRAM is not read after the shadow is first filled.
+    if (bga_active && !vga_shadowed && width == current_vga_width && height == current_vga_height &&
+        current_color_depth == COLOR_DEPTH_32BIT && current_vga_pitch == width * sizeof(uint32_t)) {
+        db->shadow = alloc_pixels(buffer_size, 0);
+        if (!db->shadow) {
+            kfree(db);
+            return 0;
+        }
+
+        // Start from what is on screen; the hidden page holds anything
+        uint32_t visible = bga_visible_page();
+        fast_copy(db->shadow, bga_page_address(visible), buffer_size);
+        damage_add_full(&db->stale[1 - visible]);
+
+        db->front_buffer = (uint32_t*)bga_page_address(1 - visible);
+        db->back_buffer = (uint32_t*)bga_page_address(visible);
+        db->hardware = 1;
+        vga_shadowed = db;
+        vga_framebuffer = (uint8_t*)db->shadow;
+        return db;
+    }
+
+    int front_zeroed = 0;
+    int back_zeroed = 0;
+    db->front_buffer = alloc_pixels(buffer_size, &front_zeroed);
+    db->back_buffer = alloc_pixels(buffer_size, &back_zeroed);
 
     if (!db->front_buffer || !db->back_buffer) {
-        if (db->front_buffer) kfree(db->front_buffer);
-        if (db->back_buffer) kfree(db->back_buffer);
+        free_pixels(db->front_buffer);
+        free_pixels(db->back_buffer);
         kfree(db);
         return 0;
     }
 
-    // Clear both buffers
-    vga_memset_fast(db->front_buffer, 0, buffer_size);
-    vga_memset_fast(db->back_buffer, 0, buffer_size);
+    // Clear both buffers (demand-paged buffers already read as zero)
+    if (!front_zeroed) vga_memset_fast(db->front_buffer, 0, buffer_size);
+    if (!back_zeroed) vga_memset_fast(db->back_buffer, 0, buffer_size);
 
     return db;
 }
 
 void destroy_double_buffer(double_buffer_t* db) {
     if (db) {
-        if (db->front_buffer) kfree(db->front_buffer);
-        if (db->back_buffer) kfree(db->back_buffer);
+        if (db == vga_shadowed) {
+            // Immediate-mode drawing goes back to the page on screen
+            vga_shadowed = 0;
+            vga_framebuffer = bga_page_address(bga_visible_page());
+        }
+        if (db->hardware) {
+            free_pixels(db->shadow);
+        } else {
+            free_pixels(db->front_buffer);
+            free_pixels(db->back_buffer);
+        }
         kfree(db);
     }
 }
 
-void swap_buffers(double_buffer_t* db) {
-    if (!db) return;
-    db->current_buffer = 1 - db->current_buffer;
-}
 
 uint32_t* get_current_buffer(double_buffer_t* db) {
     if (!db) return 0;
+    if (db->shadow) return db->shadow;
     return db->current_buffer ? db->back_buffer : db->front_buffer;
 }
 
+render_buffer_t* get_render_target(double_buffer_t* db) {
+    if (!db) return 0;
+    db->target.pixels = get_current_buffer(db);
+    return &db->target;
+}
+
+// Copy a rectangle between two full-size buffers
+static void copy_rect(double_buffer_t* db, const uint32_t* from, uint32_t* to, const damage_rect_t* rect) {
+    size_t offset = (size_t)rect->y1 * db->width + rect->x1;
+    size_t row_bytes = (size_t)(rect->x2 - rect->x1) * sizeof(uint32_t);
+    for (uint32_t y = rect->y1; y < rect->y2; y++, offset += db->width) {
+        fast_copy(to + offset, from + offset, row_bytes);
+    }
+}
+
+static void add_damage(damage_region_t* to, const damage_region_t* from) {
+    if (from->full) {
+        damage_add_full(to);
+        return;
+    }
+    for (uint32_t i = 0; i < from->count; i++) {
+        const damage_rect_t* rect = &from->rects[i];
+        damage_add(to, (int32_t)rect->x1, (int32_t)rect->y1, rect->x2 - rect->x1, rect->y2 - rect->y1);
+    }
+}
+
+// Copy where region says to differs from from, then clear region
+static void copy_region(double_buffer_t* db, const uint32_t* from, uint32_t* to, damage_region_t* region) {
+    if (damage_prefers_full(region)) {
+        fast_copy(to, from, (size_t)db->width * db->height * sizeof(uint32_t));
+    } else {
+        for (uint32_t i = 0; i < region->count; i++) {
+            copy_rect(db, from, to, &region->rects[i]);
+        }
+    }
+    damage_clear(region);
+}
+
+// Damage rectangles are bounding boxes, so the buffer drawn into next has
+// to match the current one everywhere they might not cover: catch it up on
+// what it missed, including damage not presented yet
+void swap_buffers(double_buffer_t* db) {
+    if (!db || db->shadow) return;
+
+    uint32_t* from = get_current_buffer(db);
+    db->current_buffer = 1 - db->current_buffer;
+    add_damage(&db->stale[db->current_buffer], &db->damage);
+    copy_region(db, from, get_current_buffer(db), &db->stale[db->current_buffer]);
+}
+
+// Write the shadow into the hidden BGA page where it is stale, then scan
+// that page out. Both pages lag the shadow by the new damage first; only
+// the hidden page is brought up to date.
+static void flip_shadow(double_buffer_t* db) {
+    if (!db->damage.full && db->damage.count == 0) return;
+    add_damage(&db->stale[0], &db->damage);
+    add_damage(&db->stale[1], &db->damage);
+    damage_clear(&db->damage);
+
+    uint32_t page = 1 - bga_visible_page();
+    copy_region(db, db->shadow, (uint32_t*)bga_page_address(page), &db->stale[page]);
+    bga_show_page(page);
+}
+
 void present_buffer(double_buffer_t* db) {
     if (!db || db->width == 0 || db->height == 0) return;
 
     uint32_t* current = get_current_buffer(db);
-    if (current) {
-        vga_blit_buffer(current, db->width, db->height, 0, 0, db->width, db->height);
+    if (!current) return;
+
+    if (db == vga_shadowed) {
+        flip_shadow(db);
+        return;
     }
+
+    vga_blit_buffer(current, db->width, db->height, 0, 0, db->width, db->height);
+    // Drawing may not have been tracked, so the other buffer may differ anywhere
+    damage_add_full(&db->stale[1 - db->current_buffer]);
+    damage_clear(&db->damage);
 }
 
+void present_damage(double_buffer_t* db) {
+    if (!db || db->width == 0 || db->height == 0) return;
+
+    uint32_t* current = get_current_buffer(db);
+    if (!current) return;
+    if (!db->damage.full && db->damage.count == 0) return;
+
+    if (db == vga_shadowed) {
+        flip_shadow(db);
+        return;
+    }
+
+    add_damage(&db->stale[1 - db->current_buffer], &db->damage);
+    if (damage_prefers_full(&db->damage)) {
+        vga_blit_buffer(current, db->width, db->height, 0, 0, db->width, db->height);
+    } else {
+        for (uint32_t i = 0; i < db->damage.count; i++) {
+            const damage_rect_t* rect = &db->damage.rects[i];
+            vga_blit_buffer(current + (size_t)rect->y1 * db->width + rect->x1, db->width,
+                            db->height - rect->y1, rect->x1, rect->y1,
+                            rect->x2 - rect->x1, rect->y2 - rect->y1);
+        }
+    }
+    damage_clear(&db->damage);
+}
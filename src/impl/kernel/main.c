@@ -6,10 +6,18 @@
 #include "../../intf/window.h"
 #include "../../intf/fs.h"
 #include "../../intf/mm.h"
+#include "../../intf/pmm.h"
+#include "../../intf/vmm.h"
+#include "../../intf/idt.h"
+#include "../../intf/pat.h"
+#include "../../intf/simd.h"
+#include "../../intf/raster.h"
 #include "../../intf/scheduler.h"
 #include "../../intf/keyboard.h"
 #include "../../intf/mouse.h"
+#include "../../intf/input.h"
 #include "../../intf/ports.h"
+#include "../../intf/pic.h"
 
 
 void process1_entry() {
@@ -52,19 +60,210 @@ void process2_entry() {
     }
 }
 
+// Write to the linear framebuffer when we have one, the text console otherwise
+static void print_at(char* video_memory, uint32_t row, uint32_t col, const char* text, uint8_t attr) {
+    if (graphics_initialized && current_vga_mode == VGA_MODE_LFB) {
+        vga_draw_string(col * 8, row * 10, text, rgb_to_color(0xFF, 0xFF, 0xFF, 0xFF));
+        return;
+    }
+    for (size_t i = 0; text[i] != '\0'; i++) {
+        video_memory[(row * 80 + col + i) * 2] = text[i];
+        video_memory[(row * 80 + col + i) * 2 + 1] = attr;
+    }
+}
+
+static void u64_to_str(uint64_t value, char* out) {
+    char digits[21];
+    int len = 0;
+    do {
+        digits[len++] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+    for (int i = 0; i < len; i++) {
+        out[i] = digits[len - 1 - i];
+    }
+    out[len] = '\0';
+}
+
+// Report how long vga_fast_clear takes per framebuffer memory type
+static void report_framebuffer_benchmark(char* video_memory, const vga_clear_timing_t* timings, uint32_t count) {
+    char number[21];
+
+    print_at(video_memory, 3, 0, "vga_fast_clear cycles:", 0x07);
+    for (uint32_t i = 0; i < count; i++) {
+        u64_to_str(timings[i].cycles_per_clear, number);
+        print_at(video_memory, 4 + i, 2, pat_type_name(timings[i].type), 0x07);
+        print_at(video_memory, 4 + i, 6, number, 0x07);
+    }
+}
+
+// Report filled-shape throughput, old per-pixel spans against the rasterizer
+static void report_raster_benchmark(char* video_memory, uint32_t first_row) {
+    raster_benchmark_t results[RASTER_BENCH_SHAPES];
+    uint32_t count = raster_benchmark(results, RASTER_BENCH_SHAPES);
+    char number[21];
+
+    print_at(video_memory, first_row, 0, "fill Mpixels/s (old, spans):", 0x07);
+    for (uint32_t i = 0; i < count; i++) {
+        print_at(video_memory, first_row + 1 + i, 2, results[i].shape, 0x07);
+        u64_to_str(results[i].legacy_pixels_per_second / 1000000, number);
+        print_at(video_memory, first_row + 1 + i, 12, number, 0x07);
+        u64_to_str(results[i].span_pixels_per_second / 1000000, number);
+        print_at(video_memory, first_row + 1 + i, 20, number, 0x07);
+    }
+}
+
+// Record one desktop frame and run it into an off-screen buffer, reporting
+// the pixels drawing it op by op would write against what the flush wrote
+static void report_display_list(char* video_memory, uint32_t row) {
+    render_buffer_t* buffer = create_render_buffer(VGA_MODE_13H_WIDTH, VGA_MODE_13H_HEIGHT);
+    display_list_t* list = display_list_create(DISPLAY_DEFAULT_ARENA);
+    if (buffer && list) {
+        display_list_stats_t stats;
+        char number[21];
+
+        ui_init();
+        ui_record_frame(list);
+        render_buffer_flush_display_list(buffer, list, &stats);
+
+        print_at(video_memory, row, 0, "UI frame pixels (immediate, list):", 0x07);
+        u64_to_str(stats.pixels_immediate, number);
+        print_at(video_memory, row, 36, number, 0x07);
+        u64_to_str(stats.pixels_written, number);
+        print_at(video_memory, row, 46, number, 0x07);
+    }
+    display_list_destroy(list);
+    destroy_render_buffer(buffer);
+}
+
+// Report the tiled scene: drawn op by op, then through the tiles
+static void report_tiled_scene(char* video_memory, uint32_t row) {
+    display_list_benchmark_t result;
+    char number[21];
+
+    if (!display_list_benchmark(&result)) return;
+    print_at(video_memory, row, 0, "scene Mpixels/s (direct, tiled):", 0x07);
+    u64_to_str(result.immediate_pixels_per_second / 1000000, number);
+    print_at(video_memory, row, 34, number, 0x07);
+    u64_to_str(result.tiled_pixels_per_second / 1000000, number);
+    print_at(video_memory, row, 42, number, 0x07);
+}
+
+// Report how many 32x32 sprites fit in a 60 Hz frame: opaque blit, per-pixel
+// colour key, run-length encoded
+static void report_sprite_benchmark(char* video_memory, uint32_t row) {
+    sprite_benchmark_t result;
+    char number[21];
+
+    if (!sprite_benchmark(&result)) return;
+    print_at(video_memory, row, 0, "sprites per 60Hz frame (blit, key, RLE):", 0x07);
+    u64_to_str(result.blit_sprites_per_frame, number);
+    print_at(video_memory, row, 44, number, 0x07);
+    u64_to_str(result.key_sprites_per_frame, number);
+    print_at(video_memory, row, 52, number, 0x07);
+    u64_to_str(result.rle_sprites_per_frame, number);
+    print_at(video_memory, row, 60, number, 0x07);
+}
+
+// Draw the desktop, then switch tabs: the update repaints only the two
+// tabs that changed, not the frame
+static void report_shell_update(char* video_memory, uint32_t row) {
+    display_list_stats_t stats;
+    char number[21];
+
+    ui_init();
+    ui_draw_frame(&stats);
+    ui_select_tab(1);
+    uint64_t written = ui_update();
+
+    print_at(video_memory, row, 0, "UI repaint pixels (frame, tab switch):", 0x07);
+    u64_to_str(stats.pixels_written, number);
+    print_at(video_memory, row, 40, number, 0x07);
+    u64_to_str(written, number);
+    print_at(video_memory, row, 50, number, 0x07);
+}
+
+// Churn the heap, then show its free space with the survivors still live
+// and again once they are released
+#define HEAP_STRESS_ITERATIONS 20000
+
+static void print_heap_stats(char* video_memory, uint32_t row, const char* label, const mm_stats_t* stats) {
+    char number[21];
+
+    print_at(video_memory, row, 0, label, 0x07);
+    u64_to_str(stats->free_bytes, number);
+    print_at(video_memory, row, 42, number, 0x07);
+    u64_to_str(stats->largest_free_block, number);
+    print_at(video_memory, row, 52, number, 0x07);
+    u64_to_str(stats->free_block_count, number);
+    print_at(video_memory, row, 62, number, 0x07);
+}
+
+static void report_heap_stress(char* video_memory, uint32_t row) {
+    mm_stats_t under_load;
+    mm_stats_t after_release;
+
+    mm_stress_test(HEAP_STRESS_ITERATIONS, 1, &under_load, &after_release);
+    print_heap_stats(video_memory, row, "heap under load (free, largest, blocks):", &under_load);
+    print_heap_stats(video_memory, row + 1, "heap after release:", &after_release);
+}
+
 void kernel_main(void) {
     // Simple kernel main - just print a message and loop
     char* video_memory = (char*)0xB8000;
 
-    // Print "Kernel running!" message
-    const char* msg = "Kernel running!";
-    for (size_t i = 0; msg[i] != '\0'; i++) {
-        video_memory[160 + i * 2] = msg[i];
-        video_memory[160 + i * 2 + 1] = 0x0A; // Green on black
+    // Enable SSE/AVX and pick the memset/memcpy kernels before anything
+    // large gets cleared or copied
+    simd_init();
+
+    // Bring up the static heap, then let it grow into the RAM reported by
+    // the Multiboot2 memory map
+    mm_init();
+    pmm_init();
+
+    // Exceptions (including demand-paging faults) need the IDT and TSS
+    idt_init();
+    vmm_init();
+
+    // Framebuffer stores go through write-combining buffers. Prefer the
+    // linear framebuffer GRUB set up for us, else keep the legacy window.
+    pat_init();
+    if (!vga_set_mode(VGA_MODE_LFB)) {
+        vga_map_framebuffer(PAT_TYPE_WC);
     }
 
-    // Simple main loop
+    // The benchmark clears the screen, so run it before printing anything
+    vga_clear_timing_t timings[VGA_BENCH_MAX_TYPES];
+    uint32_t timing_count = vga_benchmark_memory_types(timings, VGA_BENCH_MAX_TYPES);
+
+    print_at(video_memory, 1, 0, "Kernel running!", 0x0A); // Green on black
+    print_at(video_memory, 2, 0, "Memory kernels:", 0x07);
+    print_at(video_memory, 2, 16, simd_impl_name(), 0x07);
+    report_framebuffer_benchmark(video_memory, timings, timing_count);
+    report_raster_benchmark(video_memory, 5 + timing_count);
+    report_display_list(video_memory, 6 + timing_count + RASTER_BENCH_SHAPES);
+    report_tiled_scene(video_memory, 7 + timing_count + RASTER_BENCH_SHAPES);
+    report_sprite_benchmark(video_memory, 8 + timing_count + RASTER_BENCH_SHAPES);
+    report_shell_update(video_memory, 9 + timing_count + RASTER_BENCH_SHAPES);
+    report_heap_stress(video_memory, 10 + timing_count + RASTER_BENCH_SHAPES);
+
+    // Keyboard and mouse interrupts feed the queue the loop below drains
+    input_init();
+    keyboard_init();
+    mouse_init();
+    pic_unmask(1);  // Keyboard
+    pic_unmask(12); // Mouse
+    __asm__ volatile("sti");
+
+    // Simple main loop: once per pass hand queued input to the shell and
+    // repaint what changed
     for(;;) {
+        input_event_t event;
+        while (input_poll(&event)) {
+            ui_handle_event(&event);
+        }
+        ui_update();
+
         // Just busy wait - no complex initialization
         for (volatile int i = 0; i < 100000; i++) {
             // Do nothing
@@ -1,69 +1,362 @@
 #include "../../intf/mm.h"
 #include "../../intf/stdint.h"
 #include "../../intf/string.h"
+#include "../../intf/pmm.h"
 
-// Simple heap implementation with basic free list
-#define BLOCK_SIZE sizeof(block_t)
-#define MIN_BLOCK_SIZE 16
+// Two-level heap:
+//  - Slab layer: requests up to 2KB are rounded up to a power-of-two size
+//    class and served from that class's free list in O(1). Objects live in
+//    4KB slab pages carved from the front of the heap.
+//  - Large-object path: everything bigger goes to a boundary-tag allocator
+//    over the rest of the heap, so pixel buffers never compete with
+//    window/buffer headers for space. When the static heap runs out, the
+//    large-object heap grows with contiguous runs from the page-frame allocator.
+#define SLAB_PAGE_SIZE 4096
+#define SLAB_ARENA_SIZE (256 * 1024)
+#define SLAB_PAGE_COUNT (SLAB_ARENA_SIZE / SLAB_PAGE_SIZE)
+#define SLAB_MIN_SHIFT 4   // 16 bytes
+#define SLAB_MAX_SHIFT 11  // 2KB
+#define SLAB_CLASS_COUNT (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_MAX_SIZE (1UL << SLAB_MAX_SHIFT)
+#define SLAB_PAGE_UNUSED 0xFF
+
+// Large-object heap: every block carries its size in a header and a footer
+// (boundary tags), so kfree can find and merge both neighbours in O(1).
+// Free blocks sit on segregated lists binned by power-of-two size.
+#define BLOCK_ALLOCATED 0x1UL
+#define BLOCK_SIZE_MASK (~(size_t)0xF)
+#define BLOCK_HEADER_SIZE (2 * sizeof(size_t))  // size + reserved
+#define BLOCK_FOOTER_SIZE sizeof(size_t)
+#define BLOCK_OVERHEAD (BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE)
+#define MIN_BLOCK_SIZE 48  // Header + free-list links + footer, 16-byte rounded
+#define BIN_MIN_SHIFT 5    // Bin 0 holds blocks of 32-63 bytes
+#define BIN_COUNT 32
+#define HEAP_GROW_MIN_SIZE (64 * 1024) // Smallest chunk requested from the PMM
 
 typedef struct block {
-    size_t size;
-    int free;
-    struct block* next;
+    size_t size;               // Whole block incl. header/footer; bit 0 = allocated
+    size_t reserved;           // Pads the header so payloads stay 16-byte aligned
+    struct block* next_free;   // Free-list links, only valid while the block is free
+    struct block* prev_free;   // (they overlay the first bytes of the payload)
 } block_t;
 
-static uint8_t heap[HEAP_SIZE];
-static block_t* free_list = 0;
+typedef struct slab_object {
+    struct slab_object* next;
+} slab_object_t;
+
+static uint8_t heap[HEAP_SIZE] __attribute__((aligned(SLAB_PAGE_SIZE)));
+static uint8_t* const slab_arena = heap;
+
+static slab_object_t* slab_free_lists[SLAB_CLASS_COUNT];
+static uint8_t slab_page_class[SLAB_PAGE_COUNT]; // Size class owning each slab page
+static uint32_t slab_next_page = 0;              // Next never-used slab page
+
+static block_t* bins[BIN_COUNT];
+static uint32_t bin_bitmap = 0; // Bit i set when bins[i] is non-empty
+
+// Map a request size to its size class: ceil(log2(size)) - SLAB_MIN_SHIFT
+static inline uint32_t slab_class_for(size_t size) {
+    if (size <= (1UL << SLAB_MIN_SHIFT)) return 0;
+    return (uint32_t)(64 - __builtin_clzl(size - 1)) - SLAB_MIN_SHIFT;
+}
+
+// Hand a fresh slab page to a size class and thread its objects onto the
+// class free list. Runs once per page, so small allocations stay O(1) amortized.
+static int slab_refill(uint32_t cls) {
+    if (slab_next_page >= SLAB_PAGE_COUNT) return 0; // Arena exhausted
+
+    uint32_t page = slab_next_page++;
+    slab_page_class[page] = (uint8_t)cls;
+
+    size_t object_size = 1UL << (cls + SLAB_MIN_SHIFT);
+    uint8_t* base = slab_arena + (size_t)page * SLAB_PAGE_SIZE;
+    slab_object_t* head = slab_free_lists[cls];
+
+    // Push in reverse so objects are handed out in address order
+    for (size_t offset = SLAB_PAGE_SIZE; offset >= object_size; offset -= object_size) {
+        slab_object_t* obj = (slab_object_t*)(base + offset - object_size);
+        obj->next = head;
+        head = obj;
+    }
+    slab_free_lists[cls] = head;
+    return 1;
+}
+
+static void* slab_alloc(size_t size) {
+    uint32_t cls = slab_class_for(size);
+    if (!slab_free_lists[cls] && !slab_refill(cls)) {
+        return 0;
+    }
+
+    slab_object_t* obj = slab_free_lists[cls];
+    slab_free_lists[cls] = obj->next;
+    return obj;
+}
+
+static inline int slab_owns(void* ptr) {
+    return (uint8_t*)ptr >= slab_arena && (uint8_t*)ptr < slab_arena + SLAB_ARENA_SIZE;
+}
+
+static void slab_free(void* ptr) {
+    uint32_t page = (uint32_t)(((uint8_t*)ptr - slab_arena) / SLAB_PAGE_SIZE);
+    uint8_t cls = slab_page_class[page];
+    if (cls == SLAB_PAGE_UNUSED) return; // Not a slab object - ignore
+
+    slab_object_t* obj = (slab_object_t*)ptr;
+    obj->next = slab_free_lists[cls];
+    slab_free_lists[cls] = obj;
+}
+
+// Boundary-tag helpers
+
+static inline size_t block_size(const block_t* block) {
+    return block->size & BLOCK_SIZE_MASK;
+}
+
+static inline int block_is_free(const block_t* block) {
+    return !(block->size & BLOCK_ALLOCATED);
+}
+
+static inline size_t* block_footer(block_t* block) {
+    return (size_t*)((uint8_t*)block + block_size(block) - BLOCK_FOOTER_SIZE);
+}
+
+static inline void block_set(block_t* block, size_t size, int allocated) {
+    block->size = size | (allocated ? BLOCK_ALLOCATED : 0);
+    *block_footer(block) = block->size;
+}
+
+static inline block_t* block_next(block_t* block) {
+    return (block_t*)((uint8_t*)block + block_size(block));
+}
+
+// Previous neighbour is found through its footer, which sits right before us
+static inline block_t* block_prev(block_t* block) {
+    size_t prev_size = *(size_t*)((uint8_t*)block - BLOCK_FOOTER_SIZE) & BLOCK_SIZE_MASK;
+    return (block_t*)((uint8_t*)block - prev_size);
+}
+
+static inline int block_prev_is_free(block_t* block) {
+    return !(*(size_t*)((uint8_t*)block - BLOCK_FOOTER_SIZE) & BLOCK_ALLOCATED);
+}
+
+static inline uint32_t bin_for(size_t size) {
+    uint32_t bin = (uint32_t)(63 - __builtin_clzl(size)) - BIN_MIN_SHIFT;
+    return bin < BIN_COUNT ? bin : BIN_COUNT - 1;
+}
+
+static void bin_insert(block_t* block) {
+    uint32_t bin = bin_for(block_size(block));
+    block->prev_free = 0;
+    block->next_free = bins[bin];
+    if (bins[bin]) bins[bin]->prev_free = block;
+    bins[bin] = block;
+    bin_bitmap |= 1U << bin;
+}
+
+static void bin_remove(block_t* block) {
+    uint32_t bin = bin_for(block_size(block));
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        bins[bin] = block->next_free;
+    }
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+    if (!bins[bin]) bin_bitmap &= ~(1U << bin);
+}
+
+// Add a region of memory to the large-object heap. The region is bracketed
+// by an allocated prologue footer and epilogue header so merges never run
+// off either end.
+static void large_add_region(uint8_t* base, size_t size) {
+    // Align the region so block headers (and payloads) are 16-byte aligned
+    uint8_t* start = (uint8_t*)(((size_t)base + 15) & ~(size_t)15);
+    size -= (size_t)(start - base);
+    size &= BLOCK_SIZE_MASK;
+    if (size < 2 * BLOCK_HEADER_SIZE + MIN_BLOCK_SIZE) return;
+
+    // Prologue: a fake allocated footer in the last word of the first 16 bytes
+    *(size_t*)(start + BLOCK_HEADER_SIZE - BLOCK_FOOTER_SIZE) = BLOCK_ALLOCATED;
+
+    // Epilogue: a zero-sized allocated header at the very end
+    block_t* epilogue = (block_t*)(start + size - BLOCK_HEADER_SIZE);
+    epilogue->size = BLOCK_ALLOCATED;
+
+    block_t* block = (block_t*)(start + BLOCK_HEADER_SIZE);
+    block_set(block, size - 2 * BLOCK_HEADER_SIZE, 0);
+    bin_insert(block);
+}
+
+static block_t* large_find_fit(size_t size) {
+    uint32_t bin = bin_for(size);
+
+    // The request's own bin mixes sizes above and below it - take the first fit
+    for (block_t* block = bins[bin]; block; block = block->next_free) {
+        if (block_size(block) >= size) return block;
+    }
+
+    // Any block in a larger bin is big enough - take the head of the smallest one
+    uint32_t larger = bin + 1 < BIN_COUNT ? bin_bitmap & ~((2U << bin) - 1) : 0;
+    if (!larger) return 0;
+    return bins[__builtin_ctz(larger)];
+}
+
+static void* large_alloc(size_t size) {
+    // Payload rounded to 16 bytes (SIMD alignment) plus header/footer
+    size_t needed = ((size + BLOCK_OVERHEAD + 15) & ~(size_t)15);
+    if (needed < MIN_BLOCK_SIZE) needed = MIN_BLOCK_SIZE;
+
+    block_t* block = large_find_fit(needed);
+    if (!block) return 0; // Out of memory
+
+    bin_remove(block);
+
+    size_t available = block_size(block);
+    if (available - needed >= MIN_BLOCK_SIZE) {
+        // Split and return the tail to the free lists
+        block_set(block, needed, 1);
+        block_t* rest = block_next(block);
+        block_set(rest, available - needed, 0);
+        bin_insert(rest);
+    } else {
+        block_set(block, available, 1);
+    }
+
+    return (uint8_t*)block + BLOCK_HEADER_SIZE;
+}
+
+static void large_free(void* ptr) {
+    block_t* block = (block_t*)((uint8_t*)ptr - BLOCK_HEADER_SIZE);
+    if (block_is_free(block)) return; // Double free - ignore
+
+    size_t size = block_size(block);
+
+    // Merge forward
+    block_t* next = block_next(block);
+    if (block_is_free(next)) {
+        bin_remove(next);
+        size += block_size(next);
+    }
+
+    // Merge backward through the previous block's footer
+    if (block_prev_is_free(block)) {
+        block_t* prev = block_prev(block);
+        bin_remove(prev);
+        size += block_size(prev);
+        block = prev;
+    }
+
+    block_set(block, size, 0);
+    bin_insert(block);
+}
+
+// Pull a new region from the page-frame allocator big enough for `size`
+static int large_grow(size_t size) {
+    // Request plus region prologue/epilogue, block tags and alignment slack
+    size_t bytes = size + 2 * BLOCK_HEADER_SIZE + BLOCK_OVERHEAD + 16;
+    if (bytes < HEAP_GROW_MIN_SIZE) bytes = HEAP_GROW_MIN_SIZE;
+
+    size_t pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint64_t region = pmm_alloc_contiguous(pages);
+    if (!region) return 0;
+
+    large_add_region((uint8_t*)region, pages * PAGE_SIZE);
+    return 1;
+}
 
 void mm_init() {
     memset(heap, 0, HEAP_SIZE);
-    free_list = (block_t*)heap;
-    free_list->size = HEAP_SIZE - BLOCK_SIZE;
-    free_list->free = 1;
-    free_list->next = 0;
-}
 
-void* kmalloc(size_t size) {
-    // Ensure proper alignment for all data types (16-byte alignment for SIMD)
-    size = (size + 15) & ~15; // 16-byte alignment
-    size_t total_size = size + BLOCK_SIZE;
-
-    block_t* current = free_list;
-    block_t* prev = 0;
-
-    while (current) {
-        if (current->free && current->size >= size) {
-            // Found a suitable block
-            if (current->size >= size + BLOCK_SIZE + MIN_BLOCK_SIZE) {
-                // Split the block
-                block_t* new_block = (block_t*)((uint8_t*)current + BLOCK_SIZE + size);
-                new_block->size = current->size - size - BLOCK_SIZE;
-                new_block->free = 1;
-                new_block->next = current->next;
-
-                current->size = size;
-                current->next = new_block;
-            }
+    for (size_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        slab_free_lists[i] = 0;
+    }
+    for (size_t i = 0; i < SLAB_PAGE_COUNT; i++) {
+        slab_page_class[i] = SLAB_PAGE_UNUSED;
+    }
+    slab_next_page = 0;
 
-            current->free = 0;
-            return (void*)((uint8_t*)current + BLOCK_SIZE);
-        }
-        prev = current;
-        current = current->next;
+    for (size_t i = 0; i < BIN_COUNT; i++) {
+        bins[i] = 0;
     }
+    bin_bitmap = 0;
 
-    return 0; // Out of memory
+    large_add_region(heap + SLAB_ARENA_SIZE, HEAP_SIZE - SLAB_ARENA_SIZE);
+}
+
+void* kmalloc(size_t size) {
+    if (size <= SLAB_MAX_SIZE) {
+        void* ptr = slab_alloc(size);
+        if (ptr) return ptr;
+        // Slab arena exhausted - fall back to the large-object path
+    }
+    void* ptr = large_alloc(size);
+    if (!ptr && large_grow(size)) {
+        ptr = large_alloc(size);
+    }
+    return ptr;
 }
 
 void kfree(void* ptr) {
     if (!ptr) return;
 
-    block_t* block = (block_t*)((uint8_t*)ptr - BLOCK_SIZE);
-    block->free = 1;
+    if (slab_owns(ptr)) {
+        slab_free(ptr);
+    } else {
+        large_free(ptr);
+    }
+}
+
+void mm_get_stats(mm_stats_t* stats) {
+    if (!stats) return;
+
+    stats->free_bytes = 0;
+    stats->largest_free_block = 0;
+    stats->free_block_count = 0;
 
-    // Simple coalescing: merge with next block if also free
-    if (block->next && block->next->free) {
-        block->size += block->next->size + BLOCK_SIZE;
-        block->next = block->next->next;
+    for (size_t i = 0; i < BIN_COUNT; i++) {
+        for (block_t* block = bins[i]; block; block = block->next_free) {
+            size_t payload = block_size(block) - BLOCK_OVERHEAD;
+            stats->free_bytes += payload;
+            stats->free_block_count++;
+            if (payload > stats->largest_free_block) {
+                stats->largest_free_block = payload;
+            }
+        }
     }
-}
\ No newline at end of file
+}
+
+// Fragmentation stress test: churns random-sized allocations through a
+// fixed pool of live slots, then reports the free-space shape twice - once
+// with the surviving allocations still live, once after releasing them.
+#define STRESS_SLOTS 64
+#define STRESS_MAX_SIZE (16 * 1024)
+
+void mm_stress_test(uint32_t iterations, uint32_t seed, mm_stats_t* under_load, mm_stats_t* after_release) {
+    void* slots[STRESS_SLOTS];
+    for (size_t i = 0; i < STRESS_SLOTS; i++) {
+        slots[i] = 0;
+    }
+
+    uint32_t state = seed ? seed : 1;
+    for (uint32_t i = 0; i < iterations; i++) {
+        // Numerical Recipes LCG - cheap and good enough for churn
+        state = state * 1664525U + 1013904223U;
+        uint32_t slot = (state >> 8) % STRESS_SLOTS;
+
+        if (slots[slot]) {
+            kfree(slots[slot]);
+            slots[slot] = 0;
+        } else {
+            state = state * 1664525U + 1013904223U;
+            slots[slot] = kmalloc(((state >> 8) % STRESS_MAX_SIZE) + 1);
+        }
+    }
+
+    mm_get_stats(under_load);
+
+    for (size_t i = 0; i < STRESS_SLOTS; i++) {
+        kfree(slots[i]);
+    }
+
+    mm_get_stats(after_release);
+}
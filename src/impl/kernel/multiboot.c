@@ -0,0 +1,33 @@
+#include "../../intf/multiboot.h"
+#include "../../intf/stdint.h"
+
+const multiboot_tag_t* multiboot_find_tag(uint32_t type) {
+    if (!multiboot_info_addr) return 0; // Not booted through Multiboot2
+
+    const multiboot_info_t* info = (const multiboot_info_t*)(uint64_t)multiboot_info_addr;
+    const uint8_t* end = (const uint8_t*)info + info->total_size;
+    const uint8_t* cursor = (const uint8_t*)info + sizeof(multiboot_info_t);
+
+    while (cursor + sizeof(multiboot_tag_t) <= end) {
+        const multiboot_tag_t* tag = (const multiboot_tag_t*)cursor;
+        if (tag->type == MULTIBOOT_TAG_TYPE_END || tag->size < sizeof(multiboot_tag_t)) {
+            break;
+        }
+        if (tag->type == type) {
+            return tag;
+        }
+        // Tags are padded to 8-byte boundaries
+        cursor += (tag->size + MULTIBOOT_TAG_ALIGN - 1) & ~(uint32_t)(MULTIBOOT_TAG_ALIGN - 1);
+    }
+    return 0;
+}
+
+uint64_t multiboot_info_start(void) {
+    return multiboot_info_addr;
+}
+
+uint64_t multiboot_info_end(void) {
+    if (!multiboot_info_addr) return 0;
+    const multiboot_info_t* info = (const multiboot_info_t*)(uint64_t)multiboot_info_addr;
+    return (uint64_t)multiboot_info_addr + info->total_size;
+}
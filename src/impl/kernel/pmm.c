@@ -0,0 +1,292 @@
+#include "../../intf/pmm.h"
+#include "../../intf/multiboot.h"
+#include "../../intf/stdint.h"
+#include "../../intf/string.h"
+
+// Buddy allocator over all usable RAM reported by the Multiboot2 memory map.
+// Free blocks of 2^order frames are kept on per-order doubly linked lists whose
+// nodes live inside the free frames themselves (RAM is identity mapped).
+// One state byte per frame marks the head of each free block and its order,
+// which is all a merge needs to check whether a buddy is free.
+#define FRAME_FREE_HEAD 0x80      // Frame starts a free block; low bits = order
+#define FRAME_ORDER_MASK 0x0F
+#define LOW_MEMORY_LIMIT 0x100000 // Leave the IVT, BIOS data, VGA memory and ROMs alone
+#define MAX_RESERVED_RANGES 3
+
+typedef struct free_block {
+    struct free_block* next;
+    struct free_block* prev;
+} free_block_t;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} phys_range_t;
+
+extern uint8_t kernel_end[]; // End of the kernel image, from linker.ld
+
+static free_block_t* free_lists[PMM_MAX_ORDER + 1];
+static uint8_t* frame_state = 0; // One byte per frame
+static size_t frame_count = 0;
+static size_t total_bytes = 0;
+static size_t free_bytes = 0;
+
+static phys_range_t reserved[MAX_RESERVED_RANGES];
+static uint32_t reserved_count = 0;
+
+static inline uint64_t align_up(uint64_t value, uint64_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static inline uint64_t align_down(uint64_t value, uint64_t align) {
+    return value & ~(align - 1);
+}
+
+static inline size_t block_bytes(uint32_t order) {
+    return (size_t)PAGE_SIZE << order;
+}
+
+static void list_push(uint64_t addr, uint32_t order) {
+    free_block_t* block = (free_block_t*)addr;
+    block->prev = 0;
+    block->next = free_lists[order];
+    if (free_lists[order]) free_lists[order]->prev = block;
+    free_lists[order] = block;
+
+    frame_state[addr >> PAGE_SHIFT] = FRAME_FREE_HEAD | (uint8_t)order;
+    free_bytes += block_bytes(order);
+}
+
+static void list_remove(uint64_t addr, uint32_t order) {
+    free_block_t* block = (free_block_t*)addr;
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        free_lists[order] = block->next;
+    }
+    if (block->next) block->next->prev = block->prev;
+
+    frame_state[addr >> PAGE_SHIFT] = 0;
+    free_bytes -= block_bytes(order);
+}
+
+static inline int is_free_head(uint64_t addr, uint32_t order) {
+    size_t frame = addr >> PAGE_SHIFT;
+    return frame < frame_count && frame_state[frame] == (FRAME_FREE_HEAD | order);
+}
+
+// Return a block to the free lists, merging with its buddy as far as possible
+static void buddy_free(uint64_t addr, uint32_t order) {
+    while (order < PMM_MAX_ORDER) {
+        uint64_t buddy = addr ^ block_bytes(order);
+        if (!is_free_head(buddy, order)) break;
+
+        list_remove(buddy, order);
+        if (buddy < addr) addr = buddy;
+        order++;
+    }
+    list_push(addr, order);
+}
+
+// Free an arbitrary page-aligned range as the largest naturally aligned blocks
+static void free_range(uint64_t start, uint64_t end) {
+    start = align_up(start, PAGE_SIZE);
+    end = align_down(end, PAGE_SIZE);
+
+    while (start < end) {
+        uint32_t order = PMM_MAX_ORDER;
+        while (order > 0 && ((start & (block_bytes(order) - 1)) || start + block_bytes(order) > end)) {
+            order--;
+        }
+        buddy_free(start, order);
+        start += block_bytes(order);
+    }
+}
+
+// Feed usable RAM to the allocator, skipping every reserved range
+static void add_usable_range(uint64_t start, uint64_t end, uint32_t first_reserved) {
+    for (uint32_t i = first_reserved; i < reserved_count; i++) {
+        if (start < reserved[i].end && end > reserved[i].start) {
+            if (start < reserved[i].start) add_usable_range(start, reserved[i].start, i + 1);
+            if (end > reserved[i].end) add_usable_range(reserved[i].end, end, i + 1);
+            return;
+        }
+    }
+    if (start < end) {
+        total_bytes += align_down(end, PAGE_SIZE) - align_up(start, PAGE_SIZE);
+        free_range(start, end);
+    }
+}
+
+static void reserve_range(uint64_t start, uint64_t end) {
+    if (reserved_count < MAX_RESERVED_RANGES && start < end) {
+        reserved[reserved_count].start = align_down(start, PAGE_SIZE);
+        reserved[reserved_count].end = align_up(end, PAGE_SIZE);
+        reserved_count++;
+    }
+}
+
+static inline int range_overlaps(uint64_t start, uint64_t end, uint64_t other_start, uint64_t other_end) {
+    return start < other_end && end > other_start;
+}
+
+int pmm_init(void) {
+    const multiboot_tag_mmap_t* mmap = (const multiboot_tag_mmap_t*)multiboot_find_tag(MULTIBOOT_TAG_TYPE_MMAP);
+    if (!mmap || mmap->entry_size == 0) return 0;
+
+    const uint8_t* entries_end = (const uint8_t*)mmap + mmap->size;
+
+    for (size_t i = 0; i <= PMM_MAX_ORDER; i++) {
+        free_lists[i] = 0;
+    }
+    total_bytes = 0;
+    free_bytes = 0;
+    reserved_count = 0;
+
+    // Size the frame table from the highest usable address
+    uint64_t top = 0;
+    for (const uint8_t* p = (const uint8_t*)mmap->entries; p + mmap->entry_size <= entries_end; p += mmap->entry_size) {
+        const multiboot_mmap_entry_t* entry = (const multiboot_mmap_entry_t*)p;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE) continue;
+        uint64_t end = entry->addr + entry->len;
+        if (end > PMM_MAX_PHYS_ADDR) end = PMM_MAX_PHYS_ADDR;
+        if (end > top) top = end;
+    }
+    frame_count = align_down(top, PAGE_SIZE) >> PAGE_SHIFT;
+    if (frame_count == 0) return 0;
+
+    uint64_t kernel_image_end = (uint64_t)kernel_end;
+    uint64_t info_start = multiboot_info_start();
+    uint64_t info_end = multiboot_info_end();
+    uint64_t table_size = align_up(frame_count, PAGE_SIZE);
+
+    // Place the frame table in the first usable spot above the kernel that
+    // does not collide with the boot information
+    uint64_t table_start = 0;
+    for (const uint8_t* p = (const uint8_t*)mmap->entries; p + mmap->entry_size <= entries_end; p += mmap->entry_size) {
+        const multiboot_mmap_entry_t* entry = (const multiboot_mmap_entry_t*)p;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE) continue;
+
+        uint64_t end = entry->addr + entry->len;
+        if (end > top) end = top;
+        uint64_t candidate = align_up(entry->addr > kernel_image_end ? entry->addr : kernel_image_end, PAGE_SIZE);
+        if (range_overlaps(candidate, candidate + table_size, info_start, info_end)) {
+            candidate = align_up(info_end, PAGE_SIZE);
+        }
+        if (candidate >= entry->addr && candidate + table_size <= end) {
+            table_start = candidate;
+            break;
+        }
+    }
+    if (!table_start) return 0;
+
+    frame_state = (uint8_t*)table_start;
+    memset(frame_state, 0, frame_count);
+
+    reserve_range(0, kernel_image_end); // Low memory and the kernel image
+    reserve_range(info_start, info_end);
+    reserve_range(table_start, table_start + table_size);
+
+    for (const uint8_t* p = (const uint8_t*)mmap->entries; p + mmap->entry_size <= entries_end; p += mmap->entry_size) {
+        const multiboot_mmap_entry_t* entry = (const multiboot_mmap_entry_t*)p;
+        if (entry->type != MULTIBOOT_MEMORY_AVAILABLE) continue;
+
+        uint64_t start = entry->addr < LOW_MEMORY_LIMIT ? LOW_MEMORY_LIMIT : entry->addr;
+        uint64_t end = entry->addr + entry->len;
+        if (end > top) end = top;
+        if (start < end) add_usable_range(start, end, 0);
+    }
+
+    return 1;
+}
+
+uint64_t pmm_alloc_pages(uint32_t order) {
+    if (order > PMM_MAX_ORDER || !frame_state) return 0;
+
+    uint32_t current = order;
+    while (current <= PMM_MAX_ORDER && !free_lists[current]) {
+        current++;
+    }
+    if (current > PMM_MAX_ORDER) return 0; // Out of memory
+
+    uint64_t addr = (uint64_t)free_lists[current];
+    list_remove(addr, current);
+
+    // Split down, returning the upper halves to the free lists
+    while (current > order) {
+        current--;
+        list_push(addr + block_bytes(current), current);
+    }
+    return addr;
+}
+
+void pmm_free_pages(uint64_t addr, uint32_t order) {
+    if (!addr || order > PMM_MAX_ORDER || !frame_state) return;
+    if (addr & (block_bytes(order) - 1)) return; // Not a block we handed out
+    if ((addr >> PAGE_SHIFT) >= frame_count) return;
+    buddy_free(addr, order);
+}
+
+uint32_t pmm_order_for_size(size_t size) {
+    size_t pages = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (pages <= 1) return 0;
+    return (uint32_t)(64 - __builtin_clzl(pages - 1));
+}
+
+// Find a run of adjacent free max-order blocks. Only used for requests
+// above 2MB, which are rare (full-screen render buffers).
+static uint64_t alloc_max_order_run(size_t block_count) {
+    for (free_block_t* head = free_lists[PMM_MAX_ORDER]; head; head = head->next) {
+        uint64_t start = (uint64_t)head;
+        size_t found = 1;
+        while (found < block_count && is_free_head(start + found * PMM_MAX_BLOCK_SIZE, PMM_MAX_ORDER)) {
+            found++;
+        }
+        if (found == block_count) {
+            for (size_t i = 0; i < block_count; i++) {
+                list_remove(start + i * PMM_MAX_BLOCK_SIZE, PMM_MAX_ORDER);
+            }
+            return start;
+        }
+    }
+    return 0;
+}
+
+uint64_t pmm_alloc_contiguous(size_t page_count) {
+    if (page_count == 0 || !frame_state) return 0;
+
+    size_t max_block_pages = (size_t)1 << PMM_MAX_ORDER;
+    uint64_t addr;
+    size_t allocated_pages;
+
+    if (page_count <= max_block_pages) {
+        uint32_t order = pmm_order_for_size(page_count * PAGE_SIZE);
+        addr = pmm_alloc_pages(order);
+        allocated_pages = (size_t)1 << order;
+    } else {
+        size_t block_count = (page_count + max_block_pages - 1) / max_block_pages;
+        addr = alloc_max_order_run(block_count);
+        allocated_pages = block_count * max_block_pages;
+    }
+    if (!addr) return 0;
+
+    // Give back the tail we rounded up to
+    if (allocated_pages > page_count) {
+        free_range(addr + page_count * PAGE_SIZE, addr + allocated_pages * PAGE_SIZE);
+    }
+    return addr;
+}
+
+void pmm_free_contiguous(uint64_t addr, size_t page_count) {
+    if (!addr || page_count == 0 || !frame_state) return;
+    if (addr & (PAGE_SIZE - 1)) return;
+    free_range(addr, addr + page_count * PAGE_SIZE);
+}
+
+size_t pmm_total_bytes(void) {
+    return total_bytes;
+}
+
+size_t pmm_free_bytes(void) {
+    return free_bytes;
+}
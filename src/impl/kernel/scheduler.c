@@ -1,6 +1,8 @@
 #include "../../intf/scheduler.h"
 #include "../../intf/stdint.h"
 #include "../../intf/string.h"
+#include "../../intf/vmm.h"
+#include "../../intf/mm.h"
 
 static pcb_t processes[MAX_PROCESSES];
 static int current_process = -1;
@@ -15,6 +17,7 @@ void scheduler_init() {
         processes[i].state = PROCESS_TERMINATED;
         processes[i].rsp = 0;
         processes[i].rbp = 0;
+        processes[i].stack = 0;
     }
     scheduler_lock = 0; // Initialize lock
 }
@@ -33,6 +36,17 @@ void create_process(void (*entry_point)()) {
     }
 
     pcb_t* new_pcb = &processes[next_pid];
+
+    // Reserve the stack lazily so only the pages it actually uses get frames
+    new_pcb->stack = (uint8_t*)vmm_reserve(STACK_SIZE, VMM_WRITABLE);
+    if (!new_pcb->stack) {
+        new_pcb->stack = (uint8_t*)kmalloc(STACK_SIZE);
+    }
+    if (!new_pcb->stack) {
+        __atomic_clear(&scheduler_lock, __ATOMIC_RELEASE);
+        return; // Out of memory - graceful failure
+    }
+
     new_pcb->pid = next_pid;
     new_pcb->state = PROCESS_READY;
 
@@ -1,27 +1,16 @@
-7wasdw#include "../../intf/string.h"
+#include "../../intf/string.h"
+#include "../../intf/simd.h"
 
+// Both go through the vector kernels picked by simd_init()
 void* memcpy(void* dest, const void* src, size_t count) {
     if (!dest || !src || count == 0) return dest; // NULL and zero checks
-    char* dst8 = (char*)dest;
-    char* src8 = (char*)src;
-    // Use size_t for loop counter to avoid signed/unsigned comparison warnings
-    size_t i = 0;
-    while (i < count) {
-        dst8[i] = src8[i];
-        i++;
-    }
+    fast_copy(dest, src, count);
     return dest;
 }
 
 void* memset(void* dest, int val, size_t count) {
     if (!dest || count == 0) return dest; // NULL and zero checks
-    char* temp = (char*)dest;
-    // Use size_t for loop counter to avoid signed/unsigned comparison warnings
-    size_t i = 0;
-    while (i < count) {
-        temp[i] = (char)val;
-        i++;
-    }
+    fast_fill(dest, (uint8_t)val * 0x01010101U, count);
     return dest;
 }
 
@@ -0,0 +1,290 @@
+#include "../../intf/vmm.h"
+#include "../../intf/pmm.h"
+#include "../../intf/stdint.h"
+#include "../../intf/string.h"
+#include "../../intf/cpu.h"
+
+// 4-level page table management on top of the tables built in boot.asm.
+// Page tables are allocated from the PMM and reached through the 4GB
+// identity map, so a table's physical address is also its virtual address.
+#define PTE_ADDR_MASK   0x000FFFFFFFFFF000UL
+#define PTE_ADDR_MASK_2M 0x000FFFFFFFE00000UL
+#define PTE_ADDR_MASK_1G 0x000FFFFFC0000000UL
+#define PTE_FLAGS_MASK  0xFFFUL
+#define PTE_PAT_4K      (1UL << 7)   // PAT bit position in a 4KB PTE (VMM_PAT elsewhere)
+#define ENTRIES_PER_TABLE 512
+#define TABLE_FLAGS (VMM_PRESENT | VMM_WRITABLE)
+
+#define PML4_INDEX(v) (((v) >> 39) & 0x1FF)
+#define PDPT_INDEX(v) (((v) >> 30) & 0x1FF)
+#define PD_INDEX(v)   (((v) >> 21) & 0x1FF)
+#define PT_INDEX(v)   (((v) >> 12) & 0x1FF)
+
+#define CPUID_EXT_FEATURES 0x80000001
+#define CPUID_EDX_PDPE1GB (1U << 26)
+
+#define LAZY_GUARD_SIZE VMM_PAGE_4K // Unmapped gap between lazy regions
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t flags;
+    uint8_t in_use;
+} lazy_region_t;
+
+static uint64_t* kernel_pml4 = 0;
+static int has_1g_pages = 0;
+
+static lazy_region_t lazy_regions[VMM_MAX_LAZY_REGIONS];
+static uint64_t lazy_next = VMM_LAZY_BASE;
+
+static inline uint64_t read_cr3(void) {
+    uint64_t value;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(value));
+    return value;
+}
+
+void vmm_flush_tlb(void) {
+    __asm__ volatile ("mov %0, %%cr3" : : "r"(read_cr3()) : "memory");
+}
+
+void vmm_init(void) {
+    kernel_pml4 = (uint64_t*)(read_cr3() & PTE_ADDR_MASK);
+
+    uint32_t edx;
+    cpuid(CPUID_EXT_FEATURES, 0, 0, 0, 0, &edx);
+    has_1g_pages = (edx & CPUID_EDX_PDPE1GB) != 0;
+
+    for (size_t i = 0; i < VMM_MAX_LAZY_REGIONS; i++) {
+        lazy_regions[i].in_use = 0;
+    }
+    lazy_next = VMM_LAZY_BASE;
+}
+
+int vmm_supports_1g_pages(void) {
+    return has_1g_pages;
+}
+
+static uint64_t* alloc_table(void) {
+    uint64_t frame = pmm_alloc_pages(0);
+    if (!frame) return 0;
+    memset((void*)frame, 0, PAGE_SIZE);
+    return (uint64_t*)frame;
+}
+
+// Replace a huge leaf with a table of 512 next-size-down leaves covering the
+// same range with the same attributes
+static uint64_t* split_huge_entry(uint64_t* table, uint32_t index, uint64_t child_size) {
+    uint64_t entry = table[index];
+    uint64_t* child = alloc_table();
+    if (!child) return 0;
+
+    uint64_t base_mask = child_size == VMM_PAGE_4K ? PTE_ADDR_MASK_2M : PTE_ADDR_MASK_1G;
+    uint64_t base = entry & base_mask;
+    uint64_t flags = entry & PTE_FLAGS_MASK;
+
+    if (child_size == VMM_PAGE_4K) {
+        // 4KB leaves have no huge bit and keep PAT in bit 7
+        flags &= ~VMM_HUGE;
+        if (entry & VMM_PAT) flags |= PTE_PAT_4K;
+    } else if (entry & VMM_PAT) {
+        flags |= VMM_PAT;
+    }
+
+    for (uint64_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        child[i] = (base + i * child_size) | flags;
+    }
+
+    table[index] = (uint64_t)child | TABLE_FLAGS;
+    vmm_flush_tlb();
+    return child;
+}
+
+// Follow table[index] to the next level, creating or splitting as needed
+static uint64_t* next_level(uint64_t* table, uint32_t index, uint64_t child_size, int create) {
+    uint64_t entry = table[index];
+
+    if (entry & VMM_PRESENT) {
+        if (!(entry & VMM_HUGE)) return (uint64_t*)(entry & PTE_ADDR_MASK);
+        return create ? split_huge_entry(table, index, child_size) : 0;
+    }
+    if (!create) return 0;
+
+    uint64_t* child = alloc_table();
+    if (!child) return 0;
+    table[index] = (uint64_t)child | TABLE_FLAGS;
+    return child;
+}
+
+// Install a huge leaf, refusing to orphan an existing lower-level table
+static int set_huge_leaf(uint64_t* table, uint32_t index, uint64_t virt, uint64_t phys, uint64_t flags) {
+    uint64_t entry = table[index];
+    if ((entry & VMM_PRESENT) && !(entry & VMM_HUGE)) return 0;
+
+    table[index] = phys | (flags & (PTE_FLAGS_MASK | VMM_PAT)) | VMM_PRESENT | VMM_HUGE;
+    vmm_invlpg(virt);
+    return 1;
+}
+
+int vmm_map_page(uint64_t virt, uint64_t phys, uint64_t flags, vmm_page_size_t size) {
+    if (!kernel_pml4) return 0;
+    if ((virt | phys) & ((uint64_t)size - 1)) return 0; // Misaligned
+    if (size == VMM_PAGE_1G && !has_1g_pages) return 0;
+
+    uint64_t* pdpt = next_level(kernel_pml4, PML4_INDEX(virt), VMM_PAGE_1G, 1);
+    if (!pdpt) return 0;
+    if (size == VMM_PAGE_1G) {
+        return set_huge_leaf(pdpt, PDPT_INDEX(virt), virt, phys, flags);
+    }
+
+    uint64_t* pd = next_level(pdpt, PDPT_INDEX(virt), VMM_PAGE_2M, 1);
+    if (!pd) return 0;
+    if (size == VMM_PAGE_2M) {
+        return set_huge_leaf(pd, PD_INDEX(virt), virt, phys, flags);
+    }
+
+    uint64_t* pt = next_level(pd, PD_INDEX(virt), VMM_PAGE_4K, 1);
+    if (!pt) return 0;
+
+    uint64_t leaf = phys | (flags & PTE_FLAGS_MASK & ~VMM_HUGE) | VMM_PRESENT;
+    if (flags & VMM_PAT) leaf |= PTE_PAT_4K;
+    pt[PT_INDEX(virt)] = leaf;
+    vmm_invlpg(virt);
+    return 1;
+}
+
+uint64_t vmm_unmap_page(uint64_t virt) {
+    if (!kernel_pml4) return 0;
+
+    uint64_t* pdpt = next_level(kernel_pml4, PML4_INDEX(virt), VMM_PAGE_1G, 0);
+    if (!pdpt) return 0;
+
+    uint64_t* entry = &pdpt[PDPT_INDEX(virt)];
+    if (!(*entry & VMM_PRESENT)) return 0;
+    if (*entry & VMM_HUGE) {
+        *entry = 0;
+        vmm_invlpg(virt);
+        return VMM_PAGE_1G;
+    }
+
+    uint64_t* pd = (uint64_t*)(*entry & PTE_ADDR_MASK);
+    entry = &pd[PD_INDEX(virt)];
+    if (!(*entry & VMM_PRESENT)) return 0;
+    if (*entry & VMM_HUGE) {
+        *entry = 0;
+        vmm_invlpg(virt);
+        return VMM_PAGE_2M;
+    }
+
+    uint64_t* pt = (uint64_t*)(*entry & PTE_ADDR_MASK);
+    entry = &pt[PT_INDEX(virt)];
+    if (!(*entry & VMM_PRESENT)) return 0;
+    *entry = 0;
+    vmm_invlpg(virt);
+    return VMM_PAGE_4K;
+}
+
+int vmm_map_range(uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags) {
+    uint64_t end = virt + size;
+
+    while (virt < end) {
+        uint64_t remaining = end - virt;
+        vmm_page_size_t page = VMM_PAGE_4K;
+
+        if (has_1g_pages && !((virt | phys) & (VMM_PAGE_1G - 1)) && remaining >= VMM_PAGE_1G) {
+            page = VMM_PAGE_1G;
+        } else if (!((virt | phys) & (VMM_PAGE_2M - 1)) && remaining >= VMM_PAGE_2M) {
+            page = VMM_PAGE_2M;
+        }
+
+        if (!vmm_map_page(virt, phys, flags, page)) return 0;
+        virt += page;
+        phys += page;
+    }
+    return 1;
+}
+
+uint64_t vmm_virt_to_phys(uint64_t virt) {
+    if (!kernel_pml4) return 0;
+
+    uint64_t entry = kernel_pml4[PML4_INDEX(virt)];
+    if (!(entry & VMM_PRESENT)) return 0;
+
+    entry = ((uint64_t*)(entry & PTE_ADDR_MASK))[PDPT_INDEX(virt)];
+    if (!(entry & VMM_PRESENT)) return 0;
+    if (entry & VMM_HUGE) return (entry & PTE_ADDR_MASK_1G) | (virt & (VMM_PAGE_1G - 1));
+
+    entry = ((uint64_t*)(entry & PTE_ADDR_MASK))[PD_INDEX(virt)];
+    if (!(entry & VMM_PRESENT)) return 0;
+    if (entry & VMM_HUGE) return (entry & PTE_ADDR_MASK_2M) | (virt & (VMM_PAGE_2M - 1));
+
+    entry = ((uint64_t*)(entry & PTE_ADDR_MASK))[PT_INDEX(virt)];
+    if (!(entry & VMM_PRESENT)) return 0;
+    return (entry & PTE_ADDR_MASK) | (virt & (VMM_PAGE_4K - 1));
+}
+
+// Demand-paged regions
+
+static lazy_region_t* find_lazy_region(uint64_t addr) {
+    for (size_t i = 0; i < VMM_MAX_LAZY_REGIONS; i++) {
+        lazy_region_t* region = &lazy_regions[i];
+        if (region->in_use && addr >= region->start && addr < region->end) {
+            return region;
+        }
+    }
+    return 0;
+}
+
+void* vmm_reserve(size_t size, uint64_t flags) {
+    if (!kernel_pml4 || size == 0 || pmm_total_bytes() == 0) return 0;
+
+    for (size_t i = 0; i < VMM_MAX_LAZY_REGIONS; i++) {
+        lazy_region_t* region = &lazy_regions[i];
+        if (region->in_use) continue;
+
+        region->start = lazy_next;
+        region->end = lazy_next + ((size + VMM_PAGE_4K - 1) & ~(uint64_t)(VMM_PAGE_4K - 1));
+        region->flags = (flags & (PTE_FLAGS_MASK | VMM_PAT) & ~VMM_HUGE) | VMM_PRESENT;
+        region->in_use = 1;
+
+        // Address space is plentiful - never reuse it, so stale pointers fault
+        lazy_next = region->end + LAZY_GUARD_SIZE;
+        return (void*)region->start;
+    }
+    return 0; // Region table full
+}
+
+void vmm_release(void* addr) {
+    lazy_region_t* region = find_lazy_region((uint64_t)addr);
+    if (!region || region->start != (uint64_t)addr) return;
+
+    // Only pages that were actually touched have frames behind them
+    for (uint64_t page = region->start; page < region->end; page += VMM_PAGE_4K) {
+        uint64_t phys = vmm_virt_to_phys(page);
+        if (phys && vmm_unmap_page(page)) {
+            pmm_free_pages(phys, 0);
+        }
+    }
+    region->in_use = 0;
+}
+
+int vmm_is_reserved(const void* addr) {
+    return find_lazy_region((uint64_t)addr) != 0;
+}
+
+int vmm_handle_page_fault(uint64_t fault_addr, uint64_t error_code) {
+    if (error_code & PF_PRESENT) return 0; // Protection violation, not a missing page
+
+    lazy_region_t* region = find_lazy_region(fault_addr);
+    if (!region) return 0;
+
+    uint64_t frame = pmm_alloc_pages(0);
+    if (!frame) return 0; // Out of physical memory
+
+    memset((void*)frame, 0, PAGE_SIZE);
+    if (!vmm_map_page(fault_addr & ~(uint64_t)(VMM_PAGE_4K - 1), frame, region->flags, VMM_PAGE_4K)) {
+        pmm_free_pages(frame, 0);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,231 @@
+#include "../../intf/hit_test.h"
+#include "../../intf/graphics.h"
+#include "../../intf/mm.h"
+
+typedef struct {
+    void* owner;        // 0 when the slot is free
+    uint32_t kind;
+    int32_t x1, y1;     // Inclusive
+    int32_t x2, y2;     // Exclusive
+    uint32_t z;
+} hit_item_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t overflow;   // Entries were dropped: scan everything for this cell
+    uint8_t items[HIT_CELL_CAPACITY]; // Indices into items[], highest z first
+} hit_cell_t;
+
+static hit_item_t items[HIT_MAX_ITEMS];
+
+// Sized to the current mode; without it every lookup scans items[]
+static hit_cell_t* cells = 0;
+static uint32_t grid_width = 0;
+static uint32_t grid_height = 0;
+static uint32_t columns = 0;
+
+// Cells the item's rectangle touches, inclusive. Returns 0 if it is off
+// the grid.
+static int cell_range(const hit_item_t* item, uint32_t* c1, uint32_t* r1, uint32_t* c2, uint32_t* r2) {
+    int32_t x1 = item->x1 > 0 ? item->x1 : 0;
+    int32_t y1 = item->y1 > 0 ? item->y1 : 0;
+    int32_t x2 = item->x2 < (int32_t)grid_width ? item->x2 : (int32_t)grid_width;
+    int32_t y2 = item->y2 < (int32_t)grid_height ? item->y2 : (int32_t)grid_height;
+    if (x1 >= x2 || y1 >= y2) return 0;
+
+    *c1 = (uint32_t)x1 >> HIT_CELL_SHIFT;
+    *r1 = (uint32_t)y1 >> HIT_CELL_SHIFT;
+    *c2 = (uint32_t)(x2 - 1) >> HIT_CELL_SHIFT;
+    *r2 = (uint32_t)(y2 - 1) >> HIT_CELL_SHIFT;
+    return 1;
+}
+
+static void cell_insert(hit_cell_t* cell, uint8_t index) {
+    if (cell->count == HIT_CELL_CAPACITY) {
+        cell->overflow = 1;
+        return;
+    }
+
+    uint32_t position = cell->count;
+    while (position > 0 && items[cell->items[position - 1]].z < items[index].z) {
+        cell->items[position] = cell->items[position - 1];
+        position--;
+    }
+    cell->items[position] = index;
+    cell->count++;
+}
+
+// Refill an overflowed cell from items[], leaving out one entry. What it
+// dropped may fit now; if not it stays marked.
+static void cell_rebuild(hit_cell_t* cell, uint32_t column, uint32_t row, uint8_t skip) {
+    cell->count = 0;
+    cell->overflow = 0;
+    for (uint32_t i = 0; i < HIT_MAX_ITEMS; i++) {
+        uint32_t c1, r1, c2, r2;
+        if (i == skip || !items[i].owner || !cell_range(&items[i], &c1, &r1, &c2, &r2)) continue;
+        if (column < c1 || column > c2 || row < r1 || row > r2) continue;
+        cell_insert(cell, (uint8_t)i);
+    }
+}
+
+static void cell_remove(hit_cell_t* cell, uint32_t column, uint32_t row, uint8_t index) {
+    if (cell->overflow) {
+        cell_rebuild(cell, column, row, index);
+        return;
+    }
+
+    for (uint32_t i = 0; i < cell->count; i++) {
+        if (cell->items[i] != index) continue;
+        for (; i + 1 < cell->count; i++) {
+            cell->items[i] = cell->items[i + 1];
+        }
+        cell->count--;
+        return;
+    }
+}
+
+static void link_item(uint8_t index) {
+    uint32_t c1, r1, c2, r2;
+    if (!cells || !cell_range(&items[index], &c1, &r1, &c2, &r2)) return;
+
+    for (uint32_t row = r1; row <= r2; row++) {
+        for (uint32_t column = c1; column <= c2; column++) {
+            cell_insert(&cells[row * columns + column], index);
+        }
+    }
+}
+
+static void unlink_item(uint8_t index) {
+    uint32_t c1, r1, c2, r2;
+    if (!cells || !cell_range(&items[index], &c1, &r1, &c2, &r2)) return;
+
+    for (uint32_t row = r1; row <= r2; row++) {
+        for (uint32_t column = c1; column <= c2; column++) {
+            cell_remove(&cells[row * columns + column], column, row, index);
+        }
+    }
+}
+
+static void resize_grid(uint32_t width, uint32_t height) {
+    if (grid_width == width && grid_height == height) return;
+
+    if (cells) kfree(cells);
+    cells = 0;
+    grid_width = width;
+    grid_height = height;
+    columns = (grid_width + (1u << HIT_CELL_SHIFT) - 1) >> HIT_CELL_SHIFT;
+    uint32_t rows = (grid_height + (1u << HIT_CELL_SHIFT) - 1) >> HIT_CELL_SHIFT;
+    if (columns == 0 || rows == 0) return;
+
+    cells = (hit_cell_t*)kmalloc(sizeof(hit_cell_t) * columns * rows);
+    if (!cells) return;
+    for (uint32_t i = 0; i < columns * rows; i++) {
+        cells[i].count = 0;
+        cells[i].overflow = 0;
+    }
+    for (uint32_t i = 0; i < HIT_MAX_ITEMS; i++) {
+        if (items[i].owner) link_item((uint8_t)i);
+    }
+}
+
+void hit_test_init(void) {
+    vga_add_mode_hook(resize_grid);
+}
+
+static int find_item(const void* owner) {
+    for (uint32_t i = 0; i < HIT_MAX_ITEMS; i++) {
+        if (items[i].owner == owner) return (int)i;
+    }
+    return -1;
+}
+
+int hit_test_set(void* owner, uint32_t kind, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t z) {
+    if (!owner) return 0;
+
+    int index = find_item(owner);
+    if (index < 0) {
+        index = find_item(0);
+        if (index < 0) return 0;
+    } else {
+        unlink_item((uint8_t)index);
+    }
+
+    hit_item_t* item = &items[index];
+    item->owner = owner;
+    item->kind = kind;
+    item->x1 = x;
+    item->y1 = y;
+    item->x2 = x + (int32_t)width;
+    item->y2 = y + (int32_t)height;
+    item->z = z;
+    link_item((uint8_t)index);
+    return 1;
+}
+
+void hit_test_move(void* owner, int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    if (!owner) return;
+    int index = find_item(owner);
+    if (index < 0) return;
+
+    hit_test_set(owner, items[index].kind, x, y, width, height, items[index].z);
+}
+
+void hit_test_remove(void* owner) {
+    if (!owner) return;
+
+    int index = find_item(owner);
+    if (index < 0) return;
+    unlink_item((uint8_t)index);
+    items[index].owner = 0;
+}
+
+static int contains(const hit_item_t* item, int32_t x, int32_t y) {
+    return x >= item->x1 && x < item->x2 && y >= item->y1 && y < item->y2;
+}
+
+// The slow path: every entry, keeping the highest z of each kind
+static void scan_items(int32_t x, int32_t y, hit_test_result_t* result) {
+    uint32_t window_z = 0, widget_z = 0;
+    for (uint32_t i = 0; i < HIT_MAX_ITEMS; i++) {
+        const hit_item_t* item = &items[i];
+        if (!item->owner || !contains(item, x, y)) continue;
+
+        if (item->kind == HIT_WINDOW && (!result->window || item->z > window_z)) {
+            result->window = (window_t*)item->owner;
+            window_z = item->z;
+        } else if (item->kind == HIT_WIDGET && (!result->widget || item->z > widget_z)) {
+            result->widget = (widget_t*)item->owner;
+            widget_z = item->z;
+        }
+    }
+}
+
+void hit_test_point(int32_t x, int32_t y, hit_test_result_t* result) {
+    if (!result) return;
+    result->window = 0;
+    result->widget = 0;
+
+    if (x < 0 || y < 0 || (uint32_t)x >= grid_width || (uint32_t)y >= grid_height) return;
+    if (!cells) {
+        scan_items(x, y, result);
+        return;
+    }
+
+    const hit_cell_t* cell = &cells[((uint32_t)y >> HIT_CELL_SHIFT) * columns + ((uint32_t)x >> HIT_CELL_SHIFT)];
+    if (cell->overflow) {
+        scan_items(x, y, result);
+        return;
+    }
+
+    // Highest z first, so the first hit of each kind is the topmost
+    for (uint32_t i = 0; i < cell->count && !(result->window && result->widget); i++) {
+        const hit_item_t* item = &items[cell->items[i]];
+        if (!contains(item, x, y)) continue;
+
+        if (item->kind == HIT_WINDOW) {
+            if (!result->window) result->window = (window_t*)item->owner;
+        } else if (!result->widget) {
+            result->widget = (widget_t*)item->owner;
+        }
+    }
+}
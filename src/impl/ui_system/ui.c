@@ -1,109 +1,43 @@
 #include "../../intf/ui.h"
 #include "../../intf/graphics.h"
 #include "../../intf/window.h"
-#include "../../intf/rtc.h"
-
-#define MAX_TABS 5
-
-static tab_t tabs[MAX_TABS];
-static uint8_t tab_count = 0;
-
-// Simple 8x8 pixel font drawing
-static void draw_char(uint32_t x, uint32_t y, char c, uint8_t color) {
-    if (c == ' ') return; // Skip spaces
-    
-    // Very basic character rendering using rectangles
-    // This is a minimal implementation - for production, use a proper bitmap font
-    uint8_t char_width = 6;
-    uint8_t char_height = 8;
-    
-    // Draw characters as simple patterns
-    switch (c) {
-        case 'H': case 'h':
-            vga_fill_rect(x + 1, y, 1, char_height, color);
-            vga_fill_rect(x + 4, y, 1, char_height, color);
-            vga_fill_rect(x + 1, y + 3, 4, 1, color);
-            break;
-        case 'O': case 'o':
-            vga_draw_rect(x, y + 1, char_width, char_height - 2, color);
-            break;
-        case 'M': case 'm':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x + 5, y, 1, char_height, color);
-            vga_fill_rect(x + 2, y + 1, 1, 2, color);
-            break;
-        case 'E': case 'e':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x, y, char_width, 1, color);
-            vga_fill_rect(x, y + 3, char_width - 1, 1, color);
-            vga_fill_rect(x, y + char_height - 1, char_width, 1, color);
-            break;
-        case 'F': case 'f':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x, y, char_width, 1, color);
-            vga_fill_rect(x, y + 3, char_width - 1, 1, color);
-            break;
-        case 'I': case 'i':
-            vga_fill_rect(x + 2, y, 1, char_height, color);
-            break;
-        case 'L': case 'l':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x, y + char_height - 1, char_width, 1, color);
-            break;
-        case 'S': case 's':
-            vga_fill_rect(x, y, char_width, 1, color);
-            vga_fill_rect(x, y + 3, char_width, 1, color);
-            vga_fill_rect(x, y + char_height - 1, char_width, 1, color);
-            vga_fill_rect(x, y, 1, 4, color);
-            vga_fill_rect(x + char_width - 1, y + 4, 1, 4, color);
-            break;
-        case 'T': case 't':
-            vga_fill_rect(x, y, char_width, 1, color);
-            vga_fill_rect(x + 2, y, 1, char_height, color);
-            break;
-        case 'N': case 'n':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x + 5, y, 1, char_height, color);
-            for (uint8_t i = 1; i < 5; i++) {
-                vga_fill_rect(x + i, y + i, 1, 1, color);
-            }
-            break;
-        case 'G': case 'g':
-            vga_draw_rect(x, y + 1, char_width, char_height - 2, color);
-            vga_fill_rect(x + 4, y + 3, 2, 2, color);
-            break;
-        case 'A': case 'a':
-            vga_fill_rect(x, y + char_height - 1, 1, 1, color);
-            vga_fill_rect(x + 5, y + char_height - 1, 1, 1, color);
-            vga_fill_rect(x + 1, y, 1, char_height, color);
-            vga_fill_rect(x + 4, y, 1, char_height, color);
-            vga_fill_rect(x + 1, y + 3, 4, 1, color);
-            break;
-        case 'R': case 'r':
-            vga_fill_rect(x, y, 1, char_height, color);
-            vga_fill_rect(x, y, char_width, 1, color);
-            vga_fill_rect(x, y + 3, char_width - 1, 1, color);
-            vga_fill_rect(x + 4, y + 1, 1, 2, color);
-            vga_fill_rect(x + 3, y + 4, 1, 4, color);
-            break;
-        default:
-            // Draw a simple rectangle for unknown characters
-            vga_fill_rect(x + 1, y + 2, 4, 4, color);
-            break;
+#include "../../intf/widget.h"
+#include "../../intf/glyph_cache.h"
+#include "../../intf/hit_test.h"
+#include "../../intf/mouse.h"
+
+// Display list being recorded by ui_record_frame, 0 when drawing directly
+static display_list_t* ui_list = 0;
+static display_list_t* frame_list = 0;
+
+// UI text goes through the batched glyph renderer: the string is clipped
+// once against the screen and written a glyph row at a time
+void draw_string(uint32_t x, uint32_t y, const char* str, uint32_t color) {
+    if (!str) return; // NULL check
+    color = argb_to_color(color);
+    if (ui_list) {
+        display_list_draw_text(ui_list, (int32_t)x, (int32_t)y, str, color);
+        return;
     }
+    vga_draw_string(x, y, str, color);
 }
 
-void draw_string(uint32_t x, uint32_t y, const char* str, uint8_t color) {
-    if (!str) return; // NULL check
-    uint32_t offset = 0;
-    uint32_t max_chars = 19; // Maximum characters to draw
-    uint32_t char_width = 8; // Character width
-    while (str[offset] != '\0' && offset < max_chars) {
-        if (x + offset * char_width < 320 - char_width) {
-            draw_char(x + offset * char_width, y, str[offset], color);
-        }
-        offset++;
+void ui_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    color = argb_to_color(color);
+    if (ui_list) {
+        display_list_fill_rect(ui_list, (int32_t)x, (int32_t)y, width, height, color);
+        return;
+    }
+    vga_fill_rect(x, y, width, height, color);
+}
+
+void ui_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    color = argb_to_color(color);
+    if (ui_list) {
+        display_list_draw_rect(ui_list, (int32_t)x, (int32_t)y, width, height, color);
+        return;
     }
+    vga_draw_rect(x, y, width, height, color);
 }
 
 // Define constants for magic numbers
@@ -116,59 +50,95 @@ void draw_string(uint32_t x, uint32_t y, const char* str, uint8_t color) {
 #define START_MENU_WIDTH_CONSTANT 200
 #define START_MENU_HEIGHT_CONSTANT 150
 #define TASKBAR_HEIGHT_CONSTANT 25
-#define COLOR_HEADER_BG_CONSTANT 0x1F
-#define COLOR_TAB_ACTIVE_CONSTANT 0x2F
-#define COLOR_TAB_INACTIVE_CONSTANT 0x17
-#define COLOR_TAB_TEXT_CONSTANT 0x3F
-#define COLOR_BORDER_CONSTANT 0x0F
-#define COLOR_LIGHT_GREEN_CONSTANT 0x2A
-#define COLOR_LIGHT_BLUE_CONSTANT 0x39
-#define COLOR_SETUP_BG_CONSTANT 0x10
-#define COLOR_WHITE_CONSTANT 0x3F
-#define COLOR_BLACK_CONSTANT 0x00
-#define COLOR_DARK_GREY_CONSTANT 0x07
-#define COLOR_BLUE_CONSTANT 0x01
-#define COLOR_TASKBAR_BG_CONSTANT 0x07
-#define COLOR_START_MENU_BG_CONSTANT 0x1F
+// Palette entries from ui.h; white text sits on blue, as in text mode
+#define COLOR_HEADER_BG_CONSTANT COLOR_BLUE
+#define COLOR_TAB_ACTIVE_CONSTANT COLOR_GREEN
+#define COLOR_TAB_INACTIVE_CONSTANT COLOR_DARK_GREY
+#define COLOR_TAB_TEXT_CONSTANT COLOR_WHITE
+#define COLOR_BORDER_CONSTANT COLOR_WHITE
+#define COLOR_LIGHT_GREEN_CONSTANT COLOR_LIGHT_GREEN
+#define COLOR_LIGHT_BLUE_CONSTANT COLOR_LIGHT_BLUE
+#define COLOR_SETUP_BG_CONSTANT COLOR_BLUE
+#define COLOR_WHITE_CONSTANT COLOR_WHITE
+#define COLOR_BLACK_CONSTANT COLOR_BLACK
+#define COLOR_DARK_GREY_CONSTANT COLOR_DARK_GREY
+#define COLOR_BLUE_CONSTANT COLOR_BLUE
+#define COLOR_TASKBAR_BG_CONSTANT COLOR_DARK_GREY
+#define COLOR_START_MENU_BG_CONSTANT COLOR_BLUE
+
+#define TASKBAR_WINDOW_X_CONSTANT 60
+#define TASKBAR_WINDOW_SPACING_CONSTANT 80
+// Window titles that fit between the Start area and the clock
+#define TASKBAR_WINDOW_SLOTS 2
+
+static widget_t* header = 0;
+static widget_t* header_tabs = 0;
+static widget_t* start_button = 0;
+static widget_t* start_menu = 0;
+static widget_t* taskbar = 0;
+static widget_t* taskbar_clock = 0;
+static widget_t* window_titles[TASKBAR_WINDOW_SLOTS];
+
+// Create a node with its colours set; borders are always white
+static widget_t* add_widget(uint32_t type, widget_t* parent, int32_t x, int32_t y, uint32_t width, uint32_t height,
+                            const char* text, uint32_t background, uint32_t foreground, int border) {
+    widget_t* node = widget_create(type, parent, x, y, width, height, text);
+    if (!node) return 0;
+
+    node->background = background;
+    node->foreground = foreground;
+    node->border = COLOR_BORDER_CONSTANT;
+    if (border) node->flags |= WIDGET_BORDER;
+    return node;
+}
 
 void ui_init(void) {
-    // Initialize tabs
-    tab_count = 4;
-
-    tabs[0].x = 60;
-    tabs[0].y = 3;
-    tabs[0].width = TAB_WIDTH_CONSTANT;
-    tabs[0].is_active = 1;
-    tabs[0].text[0] = 'H'; tabs[0].text[1] = 'o'; tabs[0].text[2] = 'm'; tabs[0].text[3] = 'e'; tabs[0].text[4] = '\0';
-
-    tabs[1].x = 60 + TAB_WIDTH_CONSTANT + TAB_SPACING_CONSTANT;
-    tabs[1].y = 3;
-    tabs[1].width = TAB_WIDTH_CONSTANT;
-    tabs[1].is_active = 0;
-    tabs[1].text[0] = 'F'; tabs[1].text[1] = 'i'; tabs[1].text[2] = 'l'; tabs[1].text[3] = 'e'; tabs[1].text[4] = 's'; tabs[1].text[5] = '\0';
-
-    tabs[2].x = 60 + (TAB_WIDTH_CONSTANT + TAB_SPACING_CONSTANT) * 2;
-    tabs[2].y = 3;
-    tabs[2].width = TAB_WIDTH_CONSTANT;
-    tabs[2].is_active = 0;
-    tabs[2].text[0] = 'S'; tabs[2].text[1] = 'e'; tabs[2].text[2] = 't'; tabs[2].text[3] = 't'; tabs[2].text[4] = 'i'; tabs[2].text[5] = 'n'; tabs[2].text[6] = 'g'; tabs[2].text[7] = 's'; tabs[2].text[8] = '\0';
-
-    tabs[3].x = 60 + (TAB_WIDTH_CONSTANT + TAB_SPACING_CONSTANT) * 3;
-    tabs[3].y = 3;
-    tabs[3].width = TAB_WIDTH_CONSTANT;
-    tabs[3].is_active = 0;
-    tabs[3].text[0] = 'H'; tabs[3].text[1] = 'e'; tabs[3].text[2] = 'l'; tabs[3].text[3] = 'p'; tabs[3].text[4] = '\0';
+    // Widgets are never freed, so the shell is built once
+    if (header) return;
+
+    init_windowing();
+    hit_test_init();
+    widget_init();
+
+    // Roots paint in creation order: header, start menu, taskbar
+    header = add_widget(WIDGET_PANEL, 0, 0, 0, VGA_WIDTH_CONSTANT, HEADER_HEIGHT_CONSTANT, 0,
+                        COLOR_HEADER_BG_CONSTANT, 0, 1);
+    start_button = add_widget(WIDGET_BUTTON, header, 5, 5, 50, 20, "Start", COLOR_LIGHT_GREEN_CONSTANT, COLOR_BLACK_CONSTANT, 0);
+
+    static const char* const tab_names[] = { "Home", "Files", "Settings", "Help" };
+    header_tabs = add_widget(WIDGET_TAB_STRIP, header, 60, 3, 0, 0, 0, 0, 0, 0);
+    for (size_t i = 0; i < sizeof(tab_names) / sizeof(tab_names[0]); i++) {
+        widget_t* tab = add_widget(WIDGET_TAB, header_tabs, 0, 0, TAB_WIDTH_CONSTANT, TAB_HEIGHT_CONSTANT, tab_names[i],
+                                   COLOR_TAB_INACTIVE_CONSTANT, COLOR_TAB_TEXT_CONSTANT, 1);
+        if (tab) tab->active_background = COLOR_TAB_ACTIVE_CONSTANT;
+    }
+    widget_select(header_tabs, 0);
+
+    add_widget(WIDGET_LABEL, header, VGA_WIDTH_CONSTANT - 80, 10, 0, 0, "GamerOS", 0, COLOR_WHITE_CONSTANT, 0);
+
+    start_menu = add_widget(WIDGET_MENU, 0, 0, HEADER_HEIGHT_CONSTANT, START_MENU_WIDTH_CONSTANT, START_MENU_HEIGHT_CONSTANT, 0,
+                            COLOR_START_MENU_BG_CONSTANT, 0, 1);
+    add_widget(WIDGET_LABEL, start_menu, 10, 10, 0, 0, "Start Menu", 0, COLOR_WHITE_CONSTANT, 0);
+
+    taskbar = add_widget(WIDGET_PANEL, 0, 0, VGA_HEIGHT_CONSTANT - TASKBAR_HEIGHT_CONSTANT, VGA_WIDTH_CONSTANT, TASKBAR_HEIGHT_CONSTANT, 0,
+                         COLOR_TASKBAR_BG_CONSTANT, 0, 1);
+    for (size_t i = 0; i < TASKBAR_WINDOW_SLOTS; i++) {
+        window_titles[i] = add_widget(WIDGET_LABEL, taskbar, TASKBAR_WINDOW_X_CONSTANT + TASKBAR_WINDOW_SPACING_CONSTANT * (int32_t)i, 5,
+                                      TASKBAR_WINDOW_SPACING_CONSTANT - GLYPH_WIDTH, GLYPH_HEIGHT, 0, 0, COLOR_WHITE_CONSTANT, 0);
+    }
+    // Sized for "HH:MM:SS", so a tick can only ever damage these 64x8 pixels
+    taskbar_clock = add_widget(WIDGET_CLOCK, taskbar, VGA_WIDTH_CONSTANT - 80, 5, 0, 0, "00:00:00", 0, COLOR_WHITE_CONSTANT, 0);
 }
 
 void ui_draw_tab(uint32_t x, uint32_t y, const char* text, uint8_t is_active) {
-    uint8_t bg_color = is_active ? COLOR_TAB_ACTIVE_CONSTANT : COLOR_TAB_INACTIVE_CONSTANT;
-    uint8_t text_color = COLOR_TAB_TEXT_CONSTANT;
+    uint32_t bg_color = is_active ? COLOR_TAB_ACTIVE_CONSTANT : COLOR_TAB_INACTIVE_CONSTANT;
+    uint32_t text_color = COLOR_TAB_TEXT_CONSTANT;
 
     // Draw tab background
-    vga_fill_rect(x, y, TAB_WIDTH_CONSTANT, TAB_HEIGHT_CONSTANT, bg_color);
+    ui_fill_rect(x, y, TAB_WIDTH_CONSTANT, TAB_HEIGHT_CONSTANT, bg_color);
 
     // Draw tab border
-    vga_draw_rect(x, y, TAB_WIDTH_CONSTANT, TAB_HEIGHT_CONSTANT, COLOR_BORDER_CONSTANT);
+    ui_draw_rect(x, y, TAB_WIDTH_CONSTANT, TAB_HEIGHT_CONSTANT, COLOR_BORDER_CONSTANT);
 
     // Draw tab text (centered)
     uint32_t text_x = x + (TAB_WIDTH_CONSTANT / 2) - 16; // Approximate center
@@ -177,41 +147,23 @@ void ui_draw_tab(uint32_t x, uint32_t y, const char* text, uint8_t is_active) {
 }
 
 void ui_draw_header(void) {
-    // Draw header background
-    vga_fill_rect(0, 0, VGA_WIDTH_CONSTANT, HEADER_HEIGHT_CONSTANT, COLOR_HEADER_BG_CONSTANT);
-
-    // Draw header border
-    vga_draw_rect(0, 0, VGA_WIDTH_CONSTANT, HEADER_HEIGHT_CONSTANT, COLOR_BORDER_CONSTANT);
-
-    // Draw bottom border of header (separator)
-    for (size_t x = 0; x < VGA_WIDTH_CONSTANT; x++) {
-        vga_set_pixel((uint32_t)x, HEADER_HEIGHT_CONSTANT - 1, COLOR_BORDER_CONSTANT);
-    }
-
-    // Draw Start button
-    vga_fill_rect(5, 5, 50, 20, COLOR_LIGHT_GREEN_CONSTANT);
-    draw_string(10, 10, "Start", COLOR_BLACK_CONSTANT);
-
-    // Draw all tabs
-    for (size_t i = 0; i < tab_count; i++) {
-        ui_draw_tab(tabs[i].x, tabs[i].y, tabs[i].text, tabs[i].is_active);
-    }
+    widget_record(header, ui_list);
+}
 
-    // Draw title on the right side
-    uint32_t title_x = VGA_WIDTH_CONSTANT - 80;
-    draw_string(title_x, 10, "GamerOS", COLOR_WHITE_CONSTANT);
+void ui_select_tab(uint32_t index) {
+    widget_select(header_tabs, index);
 }
 
 void ui_draw_setup_screen(void) {
     // Clear screen with a setup background color
-    vga_clear(COLOR_SETUP_BG_CONSTANT);
+    vga_clear(argb_to_color(COLOR_SETUP_BG_CONSTANT));
 
     // Draw a title
     draw_string(100, 50, "Welcome to GamerOS", COLOR_WHITE_CONSTANT);
 
     // Draw a button
-    vga_fill_rect(110, 100, 100, 30, COLOR_LIGHT_BLUE_CONSTANT);
-    vga_draw_rect(110, 100, 100, 30, COLOR_WHITE_CONSTANT);
+    ui_fill_rect(110, 100, 100, 30, COLOR_LIGHT_BLUE_CONSTANT);
+    ui_draw_rect(110, 100, 100, 30, COLOR_WHITE_CONSTANT);
     draw_string(120, 110, "Start Setup", COLOR_BLACK_CONSTANT);
 }
 
@@ -230,59 +182,131 @@ void ui_handle_setup(void) {
     // Return to allow OS to continue booting
 }
 
-static int is_start_menu_open = 0;
-
 void ui_draw_start_menu(void) {
-    if (is_start_menu_open) {
-        vga_fill_rect(0, HEADER_HEIGHT_CONSTANT, START_MENU_WIDTH_CONSTANT, START_MENU_HEIGHT_CONSTANT, COLOR_START_MENU_BG_CONSTANT);
-        vga_draw_rect(0, HEADER_HEIGHT_CONSTANT, START_MENU_WIDTH_CONSTANT, START_MENU_HEIGHT_CONSTANT, COLOR_WHITE_CONSTANT);
-        draw_string(10, HEADER_HEIGHT_CONSTANT + 10, "Start Menu", COLOR_WHITE_CONSTANT);
-    }
+    widget_record(start_menu, ui_list);
 }
 
 void ui_toggle_start_menu(void) {
-    is_start_menu_open = !is_start_menu_open;
+    if (!start_menu) return;
+    widget_set_visible(start_menu, !(start_menu->flags & WIDGET_VISIBLE));
 }
 
 void ui_draw_clock(void) {
-    uint8_t hour, minute, second;
-    get_time(&hour, &minute, &second);
-
-    // Handle 12/24 hour format - assume 24-hour for now
-    // In a real OS, this would be configurable
-    char time_str[9];
-    time_str[0] = (hour / 10) + '0';
-    time_str[1] = (hour % 10) + '0';
-    time_str[2] = ':';
-    time_str[3] = (minute / 10) + '0';
-    time_str[4] = (minute % 10) + '0';
-    time_str[5] = ':';
-    time_str[6] = (second / 10) + '0';
-    time_str[7] = (second % 10) + '0';
-    time_str[8] = '\0';
-
-    uint32_t clock_x = VGA_WIDTH_CONSTANT - 80; // Clock X position
-    uint32_t clock_y = VGA_HEIGHT_CONSTANT - 20; // Clock Y position
-    draw_string(clock_x, clock_y, time_str, COLOR_WHITE_CONSTANT);
+    widget_tick();
+    widget_record(taskbar_clock, ui_list);
 }
 
-void ui_draw_window_list() {
-    int start_x = 60; // Starting X position for window list
-    int window_spacing = 80; // Spacing between window titles
-    int taskbar_y = VGA_HEIGHT_CONSTANT - 20; // Taskbar text Y position
-    int current_x = start_x;
-    for (size_t i = 0; i < window_count; i++) {
+// Titles of the first windows, in the order they were created
+static void update_window_list(void) {
+    size_t slot = 0;
+    for (size_t i = 0; i < MAX_WINDOWS && slot < TASKBAR_WINDOW_SLOTS; i++) {
         if (windows[i] && windows[i]->title) {
-            draw_string((uint32_t)current_x, (uint32_t)taskbar_y, windows[i]->title, COLOR_WHITE_CONSTANT);
-            current_x += window_spacing;
+            widget_set_text(window_titles[slot++], windows[i]->title);
         }
     }
+    for (; slot < TASKBAR_WINDOW_SLOTS; slot++) {
+        widget_set_text(window_titles[slot], "");
+    }
 }
 
 void ui_draw_taskbar(void) {
-    vga_fill_rect(0, VGA_HEIGHT_CONSTANT - TASKBAR_HEIGHT_CONSTANT, VGA_WIDTH_CONSTANT, TASKBAR_HEIGHT_CONSTANT, COLOR_TASKBAR_BG_CONSTANT);
-    vga_draw_rect(0, VGA_HEIGHT_CONSTANT - TASKBAR_HEIGHT_CONSTANT, VGA_WIDTH_CONSTANT, TASKBAR_HEIGHT_CONSTANT, COLOR_WHITE_CONSTANT);
-    ui_draw_clock();
-    ui_draw_window_list();
+    update_window_list();
+    widget_tick();
+    widget_record(taskbar, ui_list);
+}
+
+// What the pointer is over, as of the last mouse packet
+static widget_t* hover_widget = 0;
+static window_t* hover_window = 0;
+static ui_cursor_t cursor = UI_CURSOR_ARROW;
+static uint8_t last_buttons = 0;
+
+// Position of node in the header tab strip, -1 if it is not a tab there
+static int tab_index(const widget_t* node) {
+    if (!node || node->parent != header_tabs) return -1;
+
+    int index = 0;
+    for (const widget_t* tab = header_tabs->first_child; tab && tab != node; tab = tab->next_sibling) {
+        index++;
+    }
+    return index;
+}
+
+void ui_mouse_event(int32_t x, int32_t y, uint8_t buttons) {
+    hit_test_result_t hit;
+    hit_test_point(x, y, &hit);
+
+    // The shell is drawn over the windows, so a widget hides any window
+    hover_widget = hit.widget;
+    hover_window = hit.widget ? 0 : hit.window;
+
+    if (hover_widget && (hover_widget->type == WIDGET_BUTTON || hover_widget->type == WIDGET_TAB)) {
+        cursor = UI_CURSOR_HAND;
+    } else if (hover_window && y < hover_window->y + WINDOW_TITLE_BAR_HEIGHT) {
+        cursor = UI_CURSOR_MOVE;
+    } else {
+        cursor = UI_CURSOR_ARROW;
+    }
+
+    // Left button going down
+    if ((buttons & MOUSE_LEFT_BUTTON) && !(last_buttons & MOUSE_LEFT_BUTTON)) {
+        int tab = tab_index(hover_widget);
+        if (tab >= 0) {
+            ui_select_tab((uint32_t)tab);
+        } else if (hover_widget && hover_widget == start_button) {
+            ui_toggle_start_menu();
+        } else if (hover_window) {
+            raise_window(hover_window);
+        }
+    }
+    last_buttons = buttons;
 }
 
+ui_cursor_t ui_cursor(void) {
+    return cursor;
+}
+
+void ui_handle_event(const input_event_t* event) {
+    if (!event) return;
+
+    switch (event->type) {
+        case INPUT_MOUSE_MOVE:
+        case INPUT_MOUSE_BUTTON:
+            ui_mouse_event(event->x, event->y, event->buttons);
+            break;
+        default:
+            // The shell has no keyboard focus yet
+            break;
+    }
+}
+
+void ui_record_frame(display_list_t* list) {
+    ui_list = list;
+    window_paint_all(ui_list);
+    ui_draw_header();
+    ui_draw_start_menu();
+    ui_draw_taskbar();
+    ui_list = 0;
+}
+
+void ui_draw_frame(display_list_stats_t* stats) {
+    if (!frame_list) frame_list = display_list_create(DISPLAY_DEFAULT_ARENA);
+    if (!frame_list) {
+        // No arena: draw immediately, with nothing to report
+        if (stats) *stats = (display_list_stats_t){ 0 };
+        ui_record_frame(0);
+        widget_clear_damage();
+        return;
+    }
+    ui_record_frame(frame_list);
+    vga_flush_display_list(frame_list, stats);
+    widget_clear_damage();
+}
+
+uint64_t ui_update(void) {
+    update_window_list();
+    widget_tick();
+
+    if (!frame_list) frame_list = display_list_create(DISPLAY_DEFAULT_ARENA);
+    return widget_render(frame_list);
+}
@@ -0,0 +1,448 @@
+#include "../../intf/widget.h"
+#include "../../intf/graphics.h"
+#include "../../intf/glyph_cache.h"
+#include "../../intf/damage.h"
+#include "../../intf/window.h"
+#include "../../intf/rtc.h"
+#include "../../intf/hit_test.h"
+
+// The shell is small and lives as long as the kernel: nodes come from a
+// fixed pool and are never freed
+static widget_t pool[WIDGET_MAX];
+static uint32_t pool_used = 0;
+
+// Screen areas to repaint, sized to the current mode
+static damage_region_t damage;
+
+static void damage_screen(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    damage_add(&damage, x, y, width, height);
+}
+
+static void resize_damage(uint32_t width, uint32_t height) {
+    damage_init(&damage, width, height);
+    damage_add_full(&damage);
+}
+
+void widget_init(void) {
+    vga_add_mode_hook(resize_damage);
+}
+
+// Zero-filled past the terminator, so two texts compare cell by cell
+static void copy_text(char* dest, const char* src) {
+    uint32_t i = 0;
+    if (src) {
+        for (; src[i] && i < WIDGET_TEXT_MAX - 1; i++) {
+            dest[i] = src[i];
+        }
+    }
+    for (; i < WIDGET_TEXT_MAX; i++) {
+        dest[i] = '\0';
+    }
+}
+
+// A node is on screen only if it and all its ancestors are visible
+static int shown(const widget_t* node) {
+    for (; node; node = node->parent) {
+        if (!(node->flags & WIDGET_VISIBLE)) return 0;
+    }
+    return 1;
+}
+
+static int opaque(const widget_t* node) {
+    return node->type == WIDGET_PANEL || node->type == WIDGET_BUTTON ||
+           node->type == WIDGET_TAB || node->type == WIDGET_MENU;
+}
+
+static int has_text(const widget_t* node) {
+    return node->type == WIDGET_BUTTON || node->type == WIDGET_TAB ||
+           node->type == WIDGET_LABEL || node->type == WIDGET_CLOCK;
+}
+
+static void layout_text(widget_t* node) {
+    node->text_x = node->screen_x;
+    node->text_y = node->screen_y;
+    if (node->type == WIDGET_BUTTON || node->type == WIDGET_TAB) {
+        uint32_t width, height;
+        glyph_text_extent(node->text, &width, &height);
+        if (width < node->width) node->text_x += (int32_t)(node->width - width) / 2;
+        if (height < node->height) node->text_y += (int32_t)(node->height - height) / 2;
+    }
+}
+
+static void layout(widget_t* node) {
+    node->screen_x = node->x;
+    node->screen_y = node->y;
+    if (node->parent) {
+        node->screen_x += node->parent->screen_x;
+        node->screen_y += node->parent->screen_y;
+    }
+    layout_text(node);
+    for (widget_t* child = node->first_child; child; child = child->next_sibling) {
+        layout(child);
+    }
+}
+
+static void damage_text(const widget_t* node) {
+    if (!has_text(node) || !node->text[0]) return;
+    uint32_t width, height;
+    glyph_text_extent(node->text, &width, &height);
+    damage_screen(node->text_x, node->text_y, width, height);
+}
+
+static void damage_node(const widget_t* node) {
+    damage_screen(node->screen_x, node->screen_y, node->width, node->height);
+    damage_text(node);
+}
+
+static void damage_subtree(const widget_t* node) {
+    damage_node(node);
+    for (const widget_t* child = node->first_child; child; child = child->next_sibling) {
+        damage_subtree(child);
+    }
+}
+
+// Hit-test entries follow the paint order: pool order puts children above
+// their parents and later roots above earlier ones
+static void index_node(widget_t* node) {
+    if (shown(node)) {
+        hit_test_set(node, HIT_WIDGET, node->screen_x, node->screen_y, node->width, node->height,
+                     (uint32_t)(node - pool));
+    } else {
+        hit_test_remove(node);
+    }
+}
+
+static void index_subtree(widget_t* node) {
+    index_node(node);
+    for (widget_t* child = node->first_child; child; child = child->next_sibling) {
+        index_subtree(child);
+    }
+}
+
+widget_t* widget_create(uint32_t type, widget_t* parent, int32_t x, int32_t y,
+                        uint32_t width, uint32_t height, const char* text) {
+    if (pool_used >= WIDGET_MAX) return 0;
+
+    widget_t* node = &pool[pool_used++];
+    *node = (widget_t){ 0 };
+    node->type = type;
+    node->flags = type == WIDGET_MENU ? 0 : WIDGET_VISIBLE;
+    node->width = width;
+    node->height = height;
+    node->parent = parent;
+    copy_text(node->text, text);
+
+    if ((type == WIDGET_LABEL || type == WIDGET_CLOCK) && (width == 0 || height == 0)) {
+        glyph_text_extent(node->text, &node->width, &node->height);
+    }
+
+    if (parent) {
+        widget_t** link = &parent->first_child;
+        int32_t next_x = 0;
+        for (; *link; link = &(*link)->next_sibling) {
+            next_x = (*link)->x + (int32_t)(*link)->width + WIDGET_TAB_SPACING;
+        }
+        *link = node;
+
+        // Tabs line up after the previous one and the strip grows to fit
+        if (parent->type == WIDGET_TAB_STRIP) {
+            x = next_x;
+            y = 0;
+            if ((uint32_t)x + width > parent->width) parent->width = (uint32_t)x + width;
+            if (height > parent->height) parent->height = height;
+            index_node(parent);
+        }
+    }
+    node->x = x;
+    node->y = y;
+    layout(node);
+    index_node(node);
+
+    if (shown(node)) damage_node(node);
+    return node;
+}
+
+void widget_set_text(widget_t* node, const char* text) {
+    if (!node) return;
+
+    char next[WIDGET_TEXT_MAX];
+    copy_text(next, text);
+
+    // Only the character cells that differ need repainting
+    uint32_t first = WIDGET_TEXT_MAX, last = 0;
+    int multiline = 0;
+    for (uint32_t i = 0; i < WIDGET_TEXT_MAX; i++) {
+        if (node->text[i] == '\n' || next[i] == '\n') multiline = 1;
+        if (node->text[i] != next[i]) {
+            if (first == WIDGET_TEXT_MAX) first = i;
+            last = i;
+        }
+    }
+    if (first == WIDGET_TEXT_MAX) return;
+
+    int visible = shown(node);
+    int32_t old_x = node->text_x;
+    int32_t old_y = node->text_y;
+    uint32_t old_width, old_height;
+    glyph_text_extent(node->text, &old_width, &old_height);
+
+    for (uint32_t i = 0; i < WIDGET_TEXT_MAX; i++) {
+        node->text[i] = next[i];
+    }
+    layout_text(node);
+    if (!visible || !has_text(node)) return;
+
+    if (!multiline && node->text_x == old_x && node->text_y == old_y) {
+        damage_screen(old_x + (int32_t)(first * GLYPH_WIDTH), old_y, (last - first + 1) * GLYPH_WIDTH, GLYPH_HEIGHT);
+        return;
+    }
+
+    // Centred text of another length moved: where it was and where it is
+    damage_screen(old_x, old_y, old_width, old_height);
+    damage_text(node);
+}
+
+void widget_set_active(widget_t* node, int active) {
+    if (!node) return;
+    uint32_t flags = active ? node->flags | WIDGET_ACTIVE : node->flags & ~WIDGET_ACTIVE;
+    if (flags == node->flags) return;
+
+    node->flags = flags;
+    if (shown(node)) damage_node(node);
+}
+
+void widget_set_visible(widget_t* node, int visible) {
+    if (!node) return;
+    uint32_t flags = visible ? node->flags | WIDGET_VISIBLE : node->flags & ~WIDGET_VISIBLE;
+    if (flags == node->flags) return;
+
+    // Either it appears or what it covered does
+    node->flags = flags;
+    index_subtree(node);
+    if (shown(node->parent)) damage_subtree(node);
+}
+
+void widget_move(widget_t* node, int32_t x, int32_t y) {
+    if (!node || (node->x == x && node->y == y)) return;
+
+    int visible = shown(node);
+    if (visible) damage_subtree(node);
+    node->x = x;
+    node->y = y;
+    layout(node);
+    index_subtree(node);
+    if (visible) damage_subtree(node);
+}
+
+void widget_select(widget_t* strip, uint32_t index) {
+    if (!strip) return;
+
+    uint32_t i = 0;
+    for (widget_t* child = strip->first_child; child; child = child->next_sibling, i++) {
+        widget_set_active(child, i == index);
+    }
+}
+
+void widget_invalidate(widget_t* node) {
+    if (node && shown(node)) damage_subtree(node);
+}
+
+// Part of an area inside a visible root. Returns 0 if they do not meet.
+static int clip_to_root(const widget_t* root, int32_t x, int32_t y, uint32_t width, uint32_t height, damage_rect_t* clip) {
+    if (root->parent || !(root->flags & WIDGET_VISIBLE)) return 0;
+
+    int32_t x1 = x > root->screen_x ? x : root->screen_x;
+    int32_t y1 = y > root->screen_y ? y : root->screen_y;
+    int32_t x2 = root->screen_x + (int32_t)root->width;
+    int32_t y2 = root->screen_y + (int32_t)root->height;
+    if (x + (int32_t)width < x2) x2 = x + (int32_t)width;
+    if (y + (int32_t)height < y2) y2 = y + (int32_t)height;
+    if (x1 >= x2 || y1 >= y2) return 0;
+
+    *clip = (damage_rect_t){ (uint32_t)x1, (uint32_t)y1, (uint32_t)x2, (uint32_t)y2 };
+    return 1;
+}
+
+void widget_damage(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    // Clipped to each root: areas no widget covers need nothing
+    damage_rect_t clip;
+    for (uint32_t i = 0; i < pool_used; i++) {
+        if (clip_to_root(&pool[i], x, y, width, height, &clip)) {
+            damage_screen((int32_t)clip.x1, (int32_t)clip.y1, clip.x2 - clip.x1, clip.y2 - clip.y1);
+        }
+    }
+}
+
+int widget_overlaps(int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    damage_rect_t clip;
+    for (uint32_t i = 0; i < pool_used; i++) {
+        if (clip_to_root(&pool[i], x, y, width, height, &clip)) return 1;
+    }
+    return 0;
+}
+
+void widget_tick(void) {
+    int read = 0;
+    char time_str[9];
+
+    for (uint32_t i = 0; i < pool_used; i++) {
+        if (pool[i].type != WIDGET_CLOCK) continue;
+
+        if (!read) {
+            uint8_t hour, minute, second;
+            get_time(&hour, &minute, &second);
+            time_str[0] = (hour / 10) + '0';
+            time_str[1] = (hour % 10) + '0';
+            time_str[2] = ':';
+            time_str[3] = (minute / 10) + '0';
+            time_str[4] = (minute % 10) + '0';
+            time_str[5] = ':';
+            time_str[6] = (second / 10) + '0';
+            time_str[7] = (second % 10) + '0';
+            time_str[8] = '\0';
+            read = 1;
+        }
+        widget_set_text(&pool[i], time_str);
+    }
+}
+
+// Widget colours are ARGB; the list is flushed to the screen, so both paths
+// take pixel values in its depth
+static void fill(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    color = argb_to_color(color);
+    if (list) {
+        display_list_fill_rect(list, x, y, width, height, color);
+        return;
+    }
+    vga_fill_rect((uint32_t)x, (uint32_t)y, width, height, color);
+}
+
+static void outline(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color) {
+    color = argb_to_color(color);
+    if (list) {
+        display_list_draw_rect(list, x, y, width, height, color);
+        return;
+    }
+    vga_draw_rect((uint32_t)x, (uint32_t)y, width, height, color);
+}
+
+static void text(display_list_t* list, int32_t x, int32_t y, const char* str, uint32_t color) {
+    if (!str[0]) return;
+    color = argb_to_color(color);
+    if (list) {
+        display_list_draw_text(list, x, y, str, color);
+        return;
+    }
+    vga_draw_string((uint32_t)x, (uint32_t)y, str, color);
+}
+
+static void paint_node(const widget_t* node, display_list_t* list) {
+    if (opaque(node)) {
+        uint32_t background = node->background;
+        if (node->type == WIDGET_TAB && (node->flags & WIDGET_ACTIVE)) background = node->active_background;
+        fill(list, node->screen_x, node->screen_y, node->width, node->height, background);
+        if (node->flags & WIDGET_BORDER) {
+            outline(list, node->screen_x, node->screen_y, node->width, node->height, node->border);
+        }
+    }
+    if (has_text(node)) {
+        text(list, node->text_x, node->text_y, node->text, node->foreground);
+    }
+}
+
+void widget_record(const widget_t* node, display_list_t* list) {
+    if (!node || !(node->flags & WIDGET_VISIBLE)) return;
+
+    paint_node(node, list);
+    for (const widget_t* child = node->first_child; child; child = child->next_sibling) {
+        widget_record(child, list);
+    }
+}
+
+static int overlaps(const widget_t* node, const damage_rect_t* rect) {
+    int32_t x1 = node->screen_x, y1 = node->screen_y;
+    int32_t x2 = x1 + (int32_t)node->width, y2 = y1 + (int32_t)node->height;
+    if (has_text(node)) {
+        uint32_t width, height;
+        glyph_text_extent(node->text, &width, &height);
+        if (node->text_x < x1) x1 = node->text_x;
+        if (node->text_y < y1) y1 = node->text_y;
+        if (node->text_x + (int32_t)width > x2) x2 = node->text_x + (int32_t)width;
+        if (node->text_y + (int32_t)height > y2) y2 = node->text_y + (int32_t)height;
+    }
+    return x1 < (int32_t)rect->x2 && (int32_t)rect->x1 < x2 &&
+           y1 < (int32_t)rect->y2 && (int32_t)rect->y1 < y2;
+}
+
+// Only nodes overlapping the rectangle; the flush clips them to it
+static void record_overlapping(const widget_t* node, display_list_t* list, const damage_rect_t* rect) {
+    if (!(node->flags & WIDGET_VISIBLE)) return;
+
+    if (overlaps(node, rect)) paint_node(node, list);
+    for (const widget_t* child = node->first_child; child; child = child->next_sibling) {
+        record_overlapping(child, list, rect);
+    }
+}
+
+// 1 if an opaque widget on screen hides everything beneath the rectangle
+static int covered(const damage_rect_t* rect) {
+    for (uint32_t i = 0; i < pool_used; i++) {
+        const widget_t* node = &pool[i];
+        if (!opaque(node) || !shown(node)) continue;
+        if (node->screen_x <= (int32_t)rect->x1 && node->screen_y <= (int32_t)rect->y1 &&
+            node->screen_x + (int32_t)node->width >= (int32_t)rect->x2 &&
+            node->screen_y + (int32_t)node->height >= (int32_t)rect->y2) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The damage as rectangles, the whole screen when it is full
+static uint32_t damage_rects(damage_rect_t* rects) {
+    if (damage.full) {
+        rects[0] = (damage_rect_t){ 0, 0, damage.width, damage.height };
+        return 1;
+    }
+    for (uint32_t i = 0; i < damage.count; i++) {
+        rects[i] = damage.rects[i];
+    }
+    return damage.count;
+}
+
+uint64_t widget_render(display_list_t* list) {
+    if (!list || !graphics_initialized) return 0;
+
+    damage_rect_t rects[DAMAGE_MAX_RECTS];
+    uint32_t count = damage_rects(rects);
+
+    // Bring what is beneath up to date first, including windows that
+    // changed on their own. Compositing damages the widgets over what it
+    // wrote, which are repainted below.
+    for (uint32_t i = 0; i < count; i++) {
+        if (covered(&rects[i])) continue;
+        window_damage_screen((int)rects[i].x1, (int)rects[i].y1,
+                             (int)(rects[i].x2 - rects[i].x1), (int)(rects[i].y2 - rects[i].y1));
+    }
+    uint64_t written = window_composite();
+    count = damage_rects(rects);
+    damage_clear(&damage);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const damage_rect_t* rect = &rects[i];
+        for (uint32_t n = 0; n < pool_used; n++) {
+            if (!pool[n].parent) record_overlapping(&pool[n], list, rect);
+        }
+
+        display_list_stats_t stats;
+        vga_set_clip_rect((int32_t)rect->x1, (int32_t)rect->y1, rect->x2 - rect->x1, rect->y2 - rect->y1);
+        vga_flush_display_list(list, &stats);
+        written += stats.pixels_written;
+    }
+    vga_reset_clip_rect();
+    return written;
+}
+
+void widget_clear_damage(void) {
+    damage_clear(&damage);
+}
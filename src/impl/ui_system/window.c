@@ -1,18 +1,60 @@
 #include "../../intf/window.h"
 #include "../../intf/graphics.h"
+#include "../../intf/damage.h"
 #include "../../intf/ui.h"
+#include "../../intf/widget.h"
+#include "../../intf/hit_test.h"
+#include "../../intf/mm.h"
 
 window_t* windows[MAX_WINDOWS];
 int window_count = 0;
 
+// Bottom to top
+static window_t* z_order[MAX_WINDOWS];
+static int z_count = 0;
+
+// Screen areas to recomposite, sized to the current mode
+static damage_region_t screen_damage;
+
+// Hit-test z of each window: raising one gives it the next stamp
+static uint32_t z_stamp = 0;
+
+static void resize_screen(uint32_t width, uint32_t height) {
+    damage_init(&screen_damage, width, height);
+    damage_add_full(&screen_damage);
+}
+
 void init_windowing() {
     for (size_t i = 0; i < MAX_WINDOWS; i++) {
         windows[i] = 0;
+        z_order[i] = 0;
+    }
+    window_count = 0;
+    z_count = 0;
+    vga_add_mode_hook(resize_screen);
+}
+
+static void damage_screen(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) return;
+    damage_add(&screen_damage, x, y, (uint32_t)width, (uint32_t)height);
+}
+
+void window_damage_screen(int x, int y, int width, int height) {
+    damage_screen(x, y, width, height);
+}
+
+// Border and title bar; the body is only filled when the window is created
+static void paint_frame(window_t* win) {
+    render_buffer_t* surface = win->surface;
+    draw_rect_software(surface, 0, 0, (uint32_t)win->width, (uint32_t)win->height, WINDOW_BORDER_COLOR);
+    fill_rect_software(surface, 0, 0, (uint32_t)win->width, WINDOW_TITLE_BAR_HEIGHT, WINDOW_TITLE_COLOR);
+    if (win->title) {
+        draw_string_software(surface, 5, 5, win->title, WINDOW_TEXT_COLOR);
     }
 }
 
 window_t* create_window(int x, int y, int width, int height, char* title) {
-    if (window_count >= MAX_WINDOWS || !title) {
+    if (window_count >= MAX_WINDOWS || !title || width <= 0 || height <= 0) {
         return 0; // Max windows reached or invalid title
     }
 
@@ -27,11 +69,16 @@ window_t* create_window(int x, int y, int width, int height, char* title) {
 
     if (window_slot == -1) return 0; // Should not happen if window_count is correct
 
-    // Allocate memory for the window
+    // Allocate memory for the window and its surface
     window_t* new_window = (window_t*)kmalloc(sizeof(window_t));
     if (!new_window) {
         return 0; // Memory allocation failed
     }
+    new_window->surface = create_render_buffer((uint32_t)width, (uint32_t)height);
+    if (!new_window->surface) {
+        kfree(new_window);
+        return 0;
+    }
 
     new_window->x = x;
     new_window->y = y;
@@ -40,48 +87,295 @@ window_t* create_window(int x, int y, int width, int height, char* title) {
     new_window->title = title;
     new_window->is_active = 1;
 
+    damage_init(&new_window->damage, (uint32_t)width, (uint32_t)height);
+    new_window->surface->damage = &new_window->damage;
+    clear_render_buffer(new_window->surface, WINDOW_FRAME_COLOR);
+    paint_frame(new_window);
+    damage_add_full(&new_window->damage);
+
     windows[window_slot] = new_window;
     window_count++;
+    z_order[z_count++] = new_window;
+    hit_test_set(new_window, HIT_WINDOW, x, y, (uint32_t)width, (uint32_t)height, ++z_stamp);
 
     return new_window;
 }
 
-void draw_window(window_t* win) {
-    if (!win) return;
+static int z_index(window_t* win) {
+    for (int i = 0; i < z_count; i++) {
+        if (z_order[i] == win) return i;
+    }
+    return -1;
+}
+
+static uint64_t composite_rect(const damage_rect_t* rect);
 
-    // Define color constants
-    #define COLOR_DARK_GREY 7
-    #define COLOR_WHITE 15
-    #define COLOR_BLUE 1
-    #define TITLE_BAR_HEIGHT 20
+// 1 if a window above win overlaps it when placed at (x, y)
+static int covered(window_t* win, int x, int y) {
+    for (int z = z_index(win) + 1; z < z_count; z++) {
+        window_t* above = z_order[z];
+        if (above->x < x + win->width && x < above->x + above->width &&
+            above->y < y + win->height && y < above->y + above->height) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    // Draw window frame
-    vga_fill_rect(win->x, win->y, win->width, win->height, COLOR_DARK_GREY);
-    vga_draw_rect(win->x, win->y, win->width, win->height, COLOR_WHITE);
+// Recomposite the old area minus the window's new one: a strip above and
+// below, and beside it on the rows both share
+static uint64_t composite_exposed(int old_x, int old_y, const window_t* win) {
+    int32_t x1 = old_x, y1 = old_y, x2 = old_x + win->width, y2 = old_y + win->height;
+    int32_t nx1 = win->x, ny1 = win->y, nx2 = win->x + win->width, ny2 = win->y + win->height;
+    int32_t mid_y1 = ny1 > y1 ? ny1 : y1;
+    int32_t mid_y2 = ny2 < y2 ? ny2 : y2;
+    damage_rect_t strips[4];
+    uint32_t count = 0;
 
-    // Draw title bar
-    vga_fill_rect(win->x, win->y, win->width, TITLE_BAR_HEIGHT, COLOR_BLUE);
+    if (mid_y1 >= mid_y2) {
+        strips[count++] = (damage_rect_t){ (uint32_t)x1, (uint32_t)y1, (uint32_t)x2, (uint32_t)y2 };
+    } else {
+        if (y1 < mid_y1) strips[count++] = (damage_rect_t){ (uint32_t)x1, (uint32_t)y1, (uint32_t)x2, (uint32_t)mid_y1 };
+        if (mid_y2 < y2) strips[count++] = (damage_rect_t){ (uint32_t)x1, (uint32_t)mid_y2, (uint32_t)x2, (uint32_t)y2 };
+        int32_t left = nx1 < x2 ? nx1 : x2;
+        int32_t right = nx2 > x1 ? nx2 : x1;
+        if (x1 < left) strips[count++] = (damage_rect_t){ (uint32_t)x1, (uint32_t)mid_y1, (uint32_t)left, (uint32_t)mid_y2 };
+        if (right < x2) strips[count++] = (damage_rect_t){ (uint32_t)right, (uint32_t)mid_y1, (uint32_t)x2, (uint32_t)mid_y2 };
+    }
 
-    // Draw window title using draw_string from ui.c
-    if (win->title) {
-        draw_string((uint32_t)(win->x + 5), (uint32_t)(win->y + 5), win->title, COLOR_WHITE);
+    uint64_t written = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        written += composite_rect(&strips[i]);
     }
+    return written;
+}
+
+void draw_window(window_t* win) {
+    if (!win || !win->surface) return;
+
+    paint_frame(win);
+    damage_add_full(&win->damage);
+    window_composite();
 }
 
 void move_window(window_t* win, int new_x, int new_y) {
     if (!win) return;
 
     // Define constants for magic numbers
-    #define VGA_WIDTH_CONSTANT  320
-    #define VGA_HEIGHT_CONSTANT 200
     #define MIN_WINDOW_DIMENSION 50
 
-    // Validate coordinates are within reasonable bounds
+    // Keep at least MIN_WINDOW_DIMENSION pixels of the window on screen
+    int max_x = (int)current_vga_width - MIN_WINDOW_DIMENSION;
+    int max_y = (int)current_vga_height - MIN_WINDOW_DIMENSION;
+    if (new_x > max_x) new_x = max_x;
+    if (new_y > max_y) new_y = max_y;
     if (new_x < 0) new_x = 0;
     if (new_y < 0) new_y = 0;
-    if (new_x > VGA_WIDTH_CONSTANT - MIN_WINDOW_DIMENSION) new_x = VGA_WIDTH_CONSTANT - MIN_WINDOW_DIMENSION;
-    if (new_y > VGA_HEIGHT_CONSTANT - MIN_WINDOW_DIMENSION) new_y = VGA_HEIGHT_CONSTANT - MIN_WINDOW_DIMENSION;
+    if (new_x == win->x && new_y == win->y) return;
+
+    // Settle pending damage so the pixels on screen are current
+    window_composite();
 
+    int old_x = win->x;
+    int old_y = win->y;
     win->x = new_x;
     win->y = new_y;
-}
\ No newline at end of file
+    hit_test_move(win, win->x, win->y, (uint32_t)win->width, (uint32_t)win->height);
+
+    // An uncovered window's pixels are already right: move them as a block
+    // and recomposite only the strips it leaves behind, about its perimeter
+    // times the distance moved. Anything above it in either place (a window
+    // or a shell widget, whose pixels would be dragged along), or either
+    // place leaving the screen, means compositing both areas instead.
+    if (!covered(win, old_x, old_y) && !covered(win, new_x, new_y) &&
+        !widget_overlaps(old_x, old_y, (uint32_t)win->width, (uint32_t)win->height) &&
+        !widget_overlaps(new_x, new_y, (uint32_t)win->width, (uint32_t)win->height) &&
+        vga_move_rect((uint32_t)old_x, (uint32_t)old_y, (uint32_t)new_x, (uint32_t)new_y,
+                      (uint32_t)win->width, (uint32_t)win->height)) {
+        composite_exposed(old_x, old_y, win);
+        return;
+    }
+
+    damage_screen(old_x, old_y, win->width, win->height);
+    damage_screen(win->x, win->y, win->width, win->height);
+    window_composite();
+}
+
+void raise_window(window_t* win) {
+    int index = z_index(win);
+    if (index < 0 || index == z_count - 1) return;
+
+    for (int i = index; i < z_count - 1; i++) {
+        z_order[i] = z_order[i + 1];
+    }
+    z_order[z_count - 1] = win;
+    hit_test_set(win, HIT_WINDOW, win->x, win->y, (uint32_t)win->width, (uint32_t)win->height, ++z_stamp);
+    damage_screen(win->x, win->y, win->width, win->height);
+}
+
+void destroy_window(window_t* win) {
+    if (!win) return;
+
+    for (size_t i = 0; i < MAX_WINDOWS; i++) {
+        if (windows[i] == win) {
+            windows[i] = 0;
+            window_count--;
+        }
+    }
+    int index = z_index(win);
+    if (index >= 0) {
+        for (int i = index; i < z_count - 1; i++) {
+            z_order[i] = z_order[i + 1];
+        }
+        z_order[--z_count] = 0;
+    }
+    hit_test_remove(win);
+
+    damage_screen(win->x, win->y, win->width, win->height);
+    destroy_render_buffer(win->surface);
+    kfree(win);
+}
+
+void window_invalidate(window_t* win, int x, int y, int width, int height) {
+    if (!win || width <= 0 || height <= 0) return;
+    damage_add(&win->damage, x, y, (uint32_t)width, (uint32_t)height);
+}
+
+// Compositing
+
+typedef struct {
+    int32_t x1, x2;
+} span_t;
+
+// Fill one band [y1, y2) of a damaged rectangle. Spans still to be filled
+// are disjoint, and taking one window's interval out of them adds at most
+// one span, so MAX_WINDOWS + 1 entries always suffice.
+static uint64_t composite_band(int32_t x1, int32_t x2, int32_t y1, int32_t y2) {
+    span_t spans[MAX_WINDOWS + 1];
+    uint32_t span_count = 1;
+    uint64_t written = 0;
+    uint32_t rows = (uint32_t)(y2 - y1);
+    spans[0].x1 = x1;
+    spans[0].x2 = x2;
+
+    for (int z = z_count - 1; z >= 0 && span_count > 0; z--) {
+        window_t* win = z_order[z];
+        if (win->y > y1 || win->y + win->height < y2) continue; // Not covering this band
+
+        int32_t left = win->x;
+        int32_t right = win->x + win->width;
+        uint32_t kept = 0;
+        span_t split[MAX_WINDOWS + 1];
+        for (uint32_t i = 0; i < span_count; i++) {
+            span_t span = spans[i];
+            int32_t a = span.x1 > left ? span.x1 : left;
+            int32_t b = span.x2 < right ? span.x2 : right;
+            if (a >= b) {
+                split[kept++] = span;
+                continue;
+            }
+
+            const uint32_t* src = win->surface->pixels + (size_t)(y1 - win->y) * win->surface->width + (uint32_t)(a - win->x);
+            vga_blit_buffer((uint32_t*)src, win->surface->width, (uint32_t)(win->y + win->height - y1),
+                            (uint32_t)a, (uint32_t)y1, (uint32_t)(b - a), rows);
+            written += (uint64_t)(b - a) * rows;
+
+            if (span.x1 < a) split[kept++] = (span_t){ span.x1, a };
+            if (b < span.x2) split[kept++] = (span_t){ b, span.x2 };
+        }
+        for (uint32_t i = 0; i < kept; i++) {
+            spans[i] = split[i];
+        }
+        span_count = kept;
+    }
+
+    // No window left above what remains
+    for (uint32_t i = 0; i < span_count; i++) {
+        vga_draw_desktop_background((uint32_t)spans[i].x1, (uint32_t)y1, (uint32_t)(spans[i].x2 - spans[i].x1), rows);
+        written += (uint64_t)(spans[i].x2 - spans[i].x1) * rows;
+    }
+    return written;
+}
+
+// Bands break wherever a window's top or bottom edge crosses the rectangle,
+// so the set of windows covering a band's full height is fixed
+static uint64_t composite_rect(const damage_rect_t* rect) {
+    int32_t edges[2 * MAX_WINDOWS + 2];
+    uint32_t edge_count = 0;
+
+    // The shell sits on top and has to be repainted over whatever we write
+    widget_damage((int32_t)rect->x1, (int32_t)rect->y1, rect->x2 - rect->x1, rect->y2 - rect->y1);
+
+    edges[edge_count++] = (int32_t)rect->y1;
+    edges[edge_count++] = (int32_t)rect->y2;
+    for (int z = 0; z < z_count; z++) {
+        int32_t top = z_order[z]->y;
+        int32_t bottom = z_order[z]->y + z_order[z]->height;
+        if (top > (int32_t)rect->y1 && top < (int32_t)rect->y2) edges[edge_count++] = top;
+        if (bottom > (int32_t)rect->y1 && bottom < (int32_t)rect->y2) edges[edge_count++] = bottom;
+    }
+
+    for (uint32_t i = 1; i < edge_count; i++) {
+        int32_t edge = edges[i];
+        uint32_t j = i;
+        while (j > 0 && edges[j - 1] > edge) {
+            edges[j] = edges[j - 1];
+            j--;
+        }
+        edges[j] = edge;
+    }
+
+    uint64_t written = 0;
+    for (uint32_t i = 0; i + 1 < edge_count; i++) {
+        if (edges[i] == edges[i + 1]) continue;
+        written += composite_band((int32_t)rect->x1, (int32_t)rect->x2, edges[i], edges[i + 1]);
+    }
+    return written;
+}
+
+uint64_t window_composite(void) {
+    if (!graphics_initialized) return 0;
+
+    // Surface damage becomes screen damage at the window's position
+    for (int z = 0; z < z_count; z++) {
+        window_t* win = z_order[z];
+        if (win->damage.full) {
+            damage_screen(win->x, win->y, win->width, win->height);
+        } else {
+            for (uint32_t i = 0; i < win->damage.count; i++) {
+                const damage_rect_t* rect = &win->damage.rects[i];
+                damage_screen(win->x + (int)rect->x1, win->y + (int)rect->y1,
+                              (int)(rect->x2 - rect->x1), (int)(rect->y2 - rect->y1));
+            }
+        }
+        damage_clear(&win->damage);
+    }
+
+    uint64_t written = 0;
+    if (screen_damage.full) {
+        damage_rect_t all = { 0, 0, screen_damage.width, screen_damage.height };
+        written = composite_rect(&all);
+    } else {
+        for (uint32_t i = 0; i < screen_damage.count; i++) {
+            written += composite_rect(&screen_damage.rects[i]);
+        }
+    }
+    damage_clear(&screen_damage);
+    return written;
+}
+
+void window_paint_all(display_list_t* list) {
+    if (!list) {
+        for (int z = 0; z < z_count; z++) {
+            damage_add_full(&z_order[z]->damage);
+        }
+        window_composite();
+        return;
+    }
+
+    for (int z = 0; z < z_count; z++) {
+        window_t* win = z_order[z];
+        display_list_blit(list, win->surface->pixels, win->surface->width, win->x, win->y,
+                          win->surface->width, win->surface->height);
+    }
+}
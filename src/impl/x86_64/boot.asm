@@ -9,7 +9,18 @@ header_start:
     dd header_end - header_start ; Header length
     dd 0x100000000 - (0xE85250D6 + 0 + (header_end - header_start)) ; Checksum
     
+    ; Framebuffer tag: ask GRUB for a 1024x768x32 linear framebuffer.
+    ; Optional, so we still boot (in text mode) if it can't be provided
+    align 8
+    dw 5    ; Type
+    dw 1    ; Flags (optional)
+    dd 20   ; Size
+    dd 1024 ; Width
+    dd 768  ; Height
+    dd 32   ; Depth
+    
     ; End tag
+    align 8
     dw 0    ; Type
     dw 0    ; Flags
     dd 8    ; Size
@@ -22,11 +33,15 @@ bits 32
 
 ; Define constants for assembly
 VGA_GRAPHICS_BUFFER equ 0xA0000
+P2_TABLE_COUNT equ 4 ; 4 x 1GB of identity-mapped 2MB pages
 
 global _start
 _start:
     ; Set up stack
     mov esp, stack_top
+
+    ; Save the Multiboot2 information pointer before CPUID clobbers EBX
+    mov [multiboot_info_addr], ebx
     
     ; Check if multiboot is supported (magic number in EAX)
     cmp eax, 0x36D76289  ; Multiboot 1/2 magic number
@@ -90,42 +105,34 @@ error:
     hlt
 
 setup_page_tables:
-    ; Identity map first 4MB (2 pages) to ensure kernel has enough mapped memory
+    ; Identity map the first 4GB with 2MB pages so the kernel, the Multiboot2
+    ; information and every frame handed out by the PMM are directly addressable
     mov eax, p3_table
     or eax, 0b11 ; Present + Writable
     mov [p4_table], eax
 
-    mov eax, p2_table
-    or eax, 0b11
-    mov [p3_table], eax
-
-    ; Map first P2 entry (0-2MB)
-    mov eax, 0x0
-    or eax, 0b10000011 ; Present + Writable + Huge
-    mov [p2_table + 0 * 8], eax
-
-    ; Map second P2 entry (2-4MB)
-    mov eax, 0x200000
-    or eax, 0b10000011 ; Present + Writable + Huge
-    mov [p2_table + 1 * 8], eax
-
-    ; Map VGA memory region (0xA0000 - 0xBFFFF) for graphics
-    ; VGA memory is at physical address 0xA0000, we want to map it to virtual address 0xA0000
-    ; This requires setting up the page tables correctly for the VGA region
-
-    ; For identity mapping of VGA memory, we need to map virtual 0xA0000 to physical 0xA0000
-    ; Since we're using 2MB huge pages, we need to find which P2 entry corresponds to 0xA0000
-
-    ; Virtual address 0xA0000 breaks down as:
-    ; P4 index = 0 (bits 39-47)
-    ; P3 index = 0 (bits 30-38)
-    ; P2 index = 5 (bits 21-29: 0xA0000 >> 21 = 5)
-    ; Page offset = 0 (bits 0-20)
-
-    ; So we need to set p2_table[5] to point to physical 0xA0000 with huge page flags
-    mov eax, VGA_GRAPHICS_BUFFER
+    ; Point the first four P3 entries at four consecutive P2 tables
+    mov ecx, 0
+.map_p3:
+    mov eax, ecx
+    shl eax, 12 ; ecx * 4096
+    add eax, p2_table
+    or eax, 0b11 ; Present + Writable
+    mov [p3_table + ecx * 8], eax
+    inc ecx
+    cmp ecx, P2_TABLE_COUNT
+    jne .map_p3
+
+    ; Fill all P2 entries: entry n maps n * 2MB (this also covers VGA memory at 0xA0000)
+    mov ecx, 0
+.map_p2:
+    mov eax, ecx
+    shl eax, 21 ; ecx * 2MB
     or eax, 0b10000011 ; Present + Writable + Huge
-    mov [p2_table + 5 * 8], eax
+    mov [p2_table + ecx * 8], eax
+    inc ecx
+    cmp ecx, P2_TABLE_COUNT * 512
+    jne .map_p2
 
     ret
 
@@ -211,7 +218,7 @@ p4_table:
 p3_table:
     resb 4096
 p2_table:
-    resb 4096
+    resb 4096 * P2_TABLE_COUNT ; One P2 table per identity-mapped GB
 
 ; VESA information storage
 global vesa_info
@@ -225,6 +232,12 @@ vesa_mode_info:
 vesa_success:
     db 0
 
+; Physical address of the Multiboot2 information structure (from EBX)
+global multiboot_info_addr
+align 4
+multiboot_info_addr:
+    resd 1
+
 stack_bottom:
     resb 16384
 stack_top:
@@ -316,10 +329,12 @@ custom_font_message:
 vesa_status_message:
     db "Graphics mode initialized", 0
 
+global gdt_64
 gdt_64:
     dq 0 ; Null descriptor
     dq (1 << 43) | (1 << 44) | (1 << 47) | (1 << 53) ; Code segment
     dq (1 << 44) | (1 << 47) ; Data segment
+    dq 0, 0 ; TSS descriptor (selector 0x18), filled in by tss_init()
 
 gdt_descriptor:
     dw $ - gdt_64 - 1
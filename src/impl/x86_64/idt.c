@@ -22,11 +22,24 @@
 #define PIC_ICW4_SFNM 0x10
 #define KERNEL_CODE_SEGMENT 0x08
 #define INTERRUPT_GATE_64BIT 0x8E
+#define TSS_SELECTOR 0x18
+#define TSS_GDT_INDEX 3 // Entries 3-4 of gdt_64 in boot.asm
+#define TSS_TYPE_AVAILABLE_64BIT 0x89
+#define DOUBLE_FAULT_VECTOR 8
+#define PAGE_FAULT_VECTOR 14
+#define IST_PAGE_FAULT 1
+#define IST_DOUBLE_FAULT 2
+#define IST_STACK_SIZE 8192
 
 idt_entry_t idt[IDT_ENTRIES];
 idt_ptr_t idt_ptr;
 
+static tss_t tss;
+static uint8_t page_fault_stack[IST_STACK_SIZE] __attribute__((aligned(16)));
+static uint8_t double_fault_stack[IST_STACK_SIZE] __attribute__((aligned(16)));
+
 extern void idt_load(uint64_t);
+extern uint64_t gdt_64[]; // boot.asm
 
 // Interrupt service routines (ISRs) - defined in assembly
 extern void isr0();
@@ -87,13 +100,39 @@ void set_idt_entry(int n, uint64_t handler) {
     if (n < 0 || n >= IDT_ENTRIES) return; // Bounds check
     idt[n].isr_low = handler & 0xFFFF;
     idt[n].kernel_cs = KERNEL_CODE_SEGMENT;
-    idt[n].reserved = 0;
+    idt[n].ist = 0;
     idt[n].attributes = INTERRUPT_GATE_64BIT;
     idt[n].isr_high = (handler >> 16) & 0xFFFF;
     idt[n].isr_higher = (handler >> 32) & 0xFFFFFFFF;
     idt[n].reserved2 = 0;
 }
 
+void set_idt_entry_ist(int n, uint8_t ist) {
+    if (n < 0 || n >= IDT_ENTRIES || ist > 7) return; // Bounds check
+    idt[n].ist = ist;
+}
+
+void tss_init() {
+    tss.ist[IST_PAGE_FAULT - 1] = (uint64_t)(page_fault_stack + IST_STACK_SIZE);
+    tss.ist[IST_DOUBLE_FAULT - 1] = (uint64_t)(double_fault_stack + IST_STACK_SIZE);
+    tss.iomap_base = sizeof(tss_t); // No I/O permission bitmap
+
+    // 16-byte system descriptor spanning two GDT slots
+    uint64_t base = (uint64_t)&tss;
+    uint64_t limit = sizeof(tss_t) - 1;
+    gdt_64[TSS_GDT_INDEX] = (limit & 0xFFFF)
+                          | ((base & 0xFFFFFF) << 16)
+                          | ((uint64_t)TSS_TYPE_AVAILABLE_64BIT << 40)
+                          | (((limit >> 16) & 0xF) << 48)
+                          | (((base >> 24) & 0xFF) << 56);
+    gdt_64[TSS_GDT_INDEX + 1] = base >> 32;
+
+    __asm__ volatile ("ltr %0" : : "r"((uint16_t)TSS_SELECTOR));
+
+    set_idt_entry_ist(PAGE_FAULT_VECTOR, IST_PAGE_FAULT);
+    set_idt_entry_ist(DOUBLE_FAULT_VECTOR, IST_DOUBLE_FAULT);
+}
+
 void idt_init() {
     idt_ptr.limit = (sizeof(idt_entry_t) * IDT_ENTRIES) - 1;
     idt_ptr.base = (uint64_t)&idt;
@@ -150,8 +189,8 @@ void idt_init() {
     outb(PIC_MASTER_DATA, 0xFF); // Mask all interrupts on master PIC initially
     outb(PIC_SLAVE_DATA, 0xFF); // Mask all interrupts on slave PIC initially
 
-    // Don't enable interrupts yet - let the kernel enable them when ready
-    // __asm__("sti"); // Commented out to prevent premature interrupt enabling
+    // Interrupts stay off; the kernel unmasks the lines it has drivers for
+    // and enables them once those drivers are initialised
 
     set_idt_entry(32, (uint64_t)irq0);  // IRQ0: Timer
     set_idt_entry(33, (uint64_t)irq1);  // IRQ1: Keyboard
@@ -173,5 +212,7 @@ void idt_init() {
     // Set up system call interrupt (int 0x80)
     set_idt_entry(0x80, (uint64_t)syscall_stub);
 
+    tss_init();
+
     idt_load((uint64_t)&idt_ptr);
 }
\ No newline at end of file
@@ -2,9 +2,12 @@
 #include "../../intf/stdint.h"
 #include "../../intf/ports.h"
 #include "../../intf/pic.h"
+#include "../../intf/vmm.h"
+#include "../../intf/simd.h"
 
 #define VGA_TEXT_BUFFER 0xB8000
 #define EXCEPTION_COUNT 32
+#define PAGE_FAULT_VECTOR 14
 #define TIMER_IRQ 32
 #define KEYBOARD_IRQ 33
 #define MOUSE_IRQ 44
@@ -135,17 +138,33 @@ static const char* exception_messages[] = {
     "Reserved"
 };
 
-// Registers structure for interrupt context
+// Registers structure for interrupt context, laid out exactly as the stubs
+// in isr.asm push it (lowest address first); the stubs pass a pointer to it
 typedef struct {
-    uint64_t ds;
     uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
-    uint64_t rbp, rsi, rdi, rdx, rcx, rbx, rax;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
     uint64_t int_no, err_code;
     uint64_t rip, cs, rflags, rsp, ss;
 } registers_t;
 
 // Common ISR handler (declared as extern in isr.asm)
-void common_isr_handler(registers_t regs) {
+void common_isr_handler(registers_t* regs) {
+    // Demand paging: resolve faults on lazily backed regions silently.
+    // The fault may hit in the middle of a vector copy, and zeroing the new
+    // frame uses the same kernels, so keep the faulting code's state intact.
+    if (regs->int_no == PAGE_FAULT_VECTOR) {
+        uint64_t fault_addr;
+        __asm__ volatile ("mov %%cr2, %0" : "=r"(fault_addr));
+
+        simd_state_t simd_state;
+        simd_save(&simd_state);
+        int handled = vmm_handle_page_fault(fault_addr, regs->err_code);
+        simd_restore(&simd_state);
+        if (handled) {
+            return; // Retry the faulting instruction
+        }
+    }
+
     // Print exception message to screen
     char* video_memory = (char*)VGA_TEXT_BUFFER;
     const char* msg = "Exception: ";
@@ -155,8 +174,8 @@ void common_isr_handler(registers_t regs) {
         video_memory[i * 2 + 1] = 0x4F; // White on red
     }
 
-    if (regs.int_no < EXCEPTION_COUNT) {
-        const char* exc_msg = exception_messages[regs.int_no];
+    if (regs->int_no < EXCEPTION_COUNT) {
+        const char* exc_msg = exception_messages[regs->int_no];
         if (exc_msg) { // NULL check
             size_t j = 0;
             for (; exc_msg[j] != '\0'; j++) {
@@ -166,31 +185,25 @@ void common_isr_handler(registers_t regs) {
         }
     }
 
-    // Handle page faults specifically - try to continue instead of halting
-    if (regs.int_no == 14) { // Page fault
-        // For now, just print and continue - in a real OS we'd handle this properly
-        const char* pf_msg = " Page Fault Handled";
-        size_t k = 0;
-        for (; pf_msg[k] != '\0'; k++) {
-            video_memory[(i + 20 + k) * 2] = pf_msg[k];
-            video_memory[(i + 20 + k) * 2 + 1] = 0x4E; // Yellow on red
-        }
-        return; // Continue execution instead of halting
-    }
-
-    // For other exceptions, halt the system
+    // Halt the system - an unresolved page fault would only fault again
+    // if we returned
     for (;;) {
         __asm__("hlt");
     }
 }
 
 // Common IRQ handler (declared as extern in isr.asm)
-void common_irq_handler(registers_t regs) {
+void common_irq_handler(registers_t* regs) {
+    // IRQs can interrupt vector code; the state stays on this stack across
+    // a context switch and is restored when this process resumes
+    simd_state_t simd_state;
+    simd_save(&simd_state);
+
     // Send EOI to PIC using proper function
-    pic_eoi(regs.int_no - 32); // Convert interrupt number to IRQ number
+    pic_eoi(regs->int_no - 32); // Convert interrupt number to IRQ number
 
     // Handle specific IRQs
-    switch (regs.int_no) {
+    switch (regs->int_no) {
         case TIMER_IRQ: // Timer interrupt - proper timer handling
             // Increment system tick counter
             extern volatile uint64_t system_ticks;
@@ -213,4 +226,6 @@ void common_irq_handler(registers_t regs) {
             // No action needed for unhandled IRQs
             break;
     }
+
+    simd_restore(&simd_state);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "../../intf/pat.h"
+#include "../../intf/vmm.h"
+#include "../../intf/cpu.h"
+#include "../../intf/stdint.h"
+
+// PAT layout: PA0-PA3 match the power-on value (WB, WT, UC-, UC) so the boot
+// page tables keep their meaning; PA4 = WC, PA5 = WP, PA6/PA7 as at reset.
+#define PAT_ENTRY(index, type) ((uint64_t)(type) << ((index) * 8))
+#define PAT_VALUE (PAT_ENTRY(0, PAT_TYPE_WB) | PAT_ENTRY(1, PAT_TYPE_WT) | \
+                   PAT_ENTRY(2, PAT_TYPE_UC_MINUS) | PAT_ENTRY(3, PAT_TYPE_UC) | \
+                   PAT_ENTRY(4, PAT_TYPE_WC) | PAT_ENTRY(5, PAT_TYPE_WP) | \
+                   PAT_ENTRY(6, PAT_TYPE_UC_MINUS) | PAT_ENTRY(7, PAT_TYPE_UC))
+
+static int pat_enabled = 0;
+
+int pat_init(void) {
+    uint32_t edx;
+    cpuid(1, 0, 0, 0, 0, &edx);
+    if (!(edx & CPUID_EDX_PAT)) return 0;
+
+    // Caches may hold lines under the old attributes
+    wbinvd();
+    wrmsr(MSR_IA32_PAT, PAT_VALUE);
+    vmm_flush_tlb();
+    wbinvd();
+
+    pat_enabled = 1;
+    return 1;
+}
+
+int pat_supported(void) {
+    return pat_enabled;
+}
+
+// The PAT index is PAT:PCD:PWT, so entry n needs those three bits set to n
+uint64_t pat_page_flags(pat_type_t type) {
+    switch (type) {
+        case PAT_TYPE_WB:       return 0;
+        case PAT_TYPE_WT:       return VMM_WRITE_THROUGH;
+        case PAT_TYPE_UC_MINUS: return VMM_CACHE_DISABLE;
+        case PAT_TYPE_UC:       return VMM_CACHE_DISABLE | VMM_WRITE_THROUGH;
+        case PAT_TYPE_WC:       return pat_enabled ? VMM_PAT : VMM_CACHE_DISABLE;
+        case PAT_TYPE_WP:       return pat_enabled ? VMM_PAT | VMM_WRITE_THROUGH : VMM_CACHE_DISABLE;
+        default:                return VMM_CACHE_DISABLE | VMM_WRITE_THROUGH;
+    }
+}
+
+const char* pat_type_name(pat_type_t type) {
+    switch (type) {
+        case PAT_TYPE_UC:       return "UC";
+        case PAT_TYPE_WC:       return "WC";
+        case PAT_TYPE_WT:       return "WT";
+        case PAT_TYPE_WP:       return "WP";
+        case PAT_TYPE_WB:       return "WB";
+        case PAT_TYPE_UC_MINUS: return "UC-";
+        default:                return "??";
+    }
+}
+
+int pat_map_range(uint64_t virt, uint64_t phys, uint64_t size, pat_type_t type) {
+    wbinvd();
+    int result = vmm_map_range(virt, phys, size, VMM_WRITABLE | pat_page_flags(type));
+    vmm_flush_tlb();
+    wbinvd();
+    return result;
+}
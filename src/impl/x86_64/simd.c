@@ -0,0 +1,466 @@
+#include "../../intf/simd.h"
+#include "../../intf/cpu.h"
+#include "../../intf/stdint.h"
+
+// Vectorised fill/copy kernels with one-time CPUID dispatch.
+// Each vector kernel aligns the destination, runs whole blocks in a single
+// asm loop (unaligned loads, aligned stores) and finishes the tail with
+// 8-byte scalar stores. Targets of SIMD_STREAMING_THRESHOLD bytes or more use
+// non-temporal stores so a framebuffer-sized clear doesn't flush the caches.
+#define CR0_MP (1UL << 1)
+#define CR0_EM (1UL << 2)
+#define CR4_OSFXSR (1UL << 9)
+#define CR4_OSXMMEXCPT (1UL << 10)
+#define CR4_OSXSAVE (1UL << 18)
+
+#define XCR0_X87 (1UL << 0)
+#define XCR0_SSE (1UL << 1)
+#define XCR0_AVX (1UL << 2)
+
+#define CPUID_LEAF_EXTENDED_FEATURES 7
+#define CPUID_LEAF_XSAVE 0xD
+#define CPUID_ECX_XSAVE (1U << 26)
+#define CPUID_ECX_AVX (1U << 28)
+#define CPUID_EBX7_AVX2 (1U << 5)
+#define CPUID_EBX7_ERMS (1U << 9)
+
+#define XSAVE_HEADER_OFFSET 512
+#define XSAVE_HEADER_SIZE 64
+
+#define SSE2_ALIGN 16
+#define SSE2_BLOCK 64
+#define AVX2_ALIGN 32
+#define AVX2_BLOCK 128
+#define ERMS_THRESHOLD 2048 // rep movsb/stosb start-up cost pays off above this
+
+typedef void (*fill_fn)(uint8_t* dest, uint32_t pattern, size_t bytes);
+typedef void (*copy_fn)(uint8_t* dest, const uint8_t* src, size_t bytes);
+typedef void (*fill_blocks_fn)(uint8_t* dest, uint32_t pattern, size_t blocks);
+typedef void (*copy_blocks_fn)(uint8_t* dest, const uint8_t* src, size_t blocks);
+
+static uint32_t features = 0;
+static int simd_enabled = 0; // Vector state is live and must be preserved
+static int use_xsave = 0;
+
+// Scalar helpers
+
+static inline uint32_t rotate_pattern(uint32_t pattern, size_t offset) {
+    uint32_t shift = (offset & 3) * 8;
+    return shift ? (pattern >> shift) | (pattern << (32 - shift)) : pattern;
+}
+
+static void fill_scalar(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    uint64_t pattern64 = pattern | ((uint64_t)pattern << 32);
+    while (bytes >= 8) {
+        *(uint64_t*)dest = pattern64;
+        dest += 8;
+        bytes -= 8;
+    }
+    for (size_t i = 0; i < bytes; i++) {
+        dest[i] = (uint8_t)(pattern >> (8 * (i & 3)));
+    }
+}
+
+static void copy_scalar(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    while (bytes >= 8) {
+        *(uint64_t*)dest = *(const uint64_t*)src;
+        dest += 8;
+        src += 8;
+        bytes -= 8;
+    }
+    for (size_t i = 0; i < bytes; i++) {
+        dest[i] = src[i];
+    }
+}
+
+// Run a block kernel over the aligned middle of the destination
+static void fill_with(uint8_t* dest, uint32_t pattern, size_t bytes, size_t align, size_t block, fill_blocks_fn kernel) {
+    size_t head = (align - ((uint64_t)dest & (align - 1))) & (align - 1);
+    if (bytes < head + block) {
+        fill_scalar(dest, pattern, bytes);
+        return;
+    }
+
+    fill_scalar(dest, pattern, head);
+    dest += head;
+    bytes -= head;
+    pattern = rotate_pattern(pattern, head);
+
+    size_t blocks = bytes / block;
+    kernel(dest, pattern, blocks);
+    fill_scalar(dest + blocks * block, pattern, bytes - blocks * block);
+}
+
+static void copy_with(uint8_t* dest, const uint8_t* src, size_t bytes, size_t align, size_t block, copy_blocks_fn kernel) {
+    size_t head = (align - ((uint64_t)dest & (align - 1))) & (align - 1);
+    if (bytes < head + block) {
+        copy_scalar(dest, src, bytes);
+        return;
+    }
+
+    copy_scalar(dest, src, head);
+    dest += head;
+    src += head;
+    bytes -= head;
+
+    size_t blocks = bytes / block;
+    kernel(dest, src, blocks);
+    copy_scalar(dest + blocks * block, src + blocks * block, bytes - blocks * block);
+}
+
+// rep stosq / rep movsq: usable before SSE is enabled
+
+static void fill_stosq(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    size_t head = (8 - ((uint64_t)dest & 7)) & 7;
+    if (bytes < head + 8) {
+        fill_scalar(dest, pattern, bytes);
+        return;
+    }
+
+    fill_scalar(dest, pattern, head);
+    dest += head;
+    bytes -= head;
+    pattern = rotate_pattern(pattern, head);
+
+    uint64_t value = pattern | ((uint64_t)pattern << 32);
+    size_t qwords = bytes / 8;
+    __asm__ volatile ("rep stosq" : "+D"(dest), "+c"(qwords) : "a"(value) : "memory");
+    fill_scalar(dest, pattern, bytes & 7);
+}
+
+static void copy_movsq(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    size_t qwords = bytes / 8;
+    size_t tail = bytes & 7;
+    __asm__ volatile ("rep movsq" : "+D"(dest), "+S"(src), "+c"(qwords) : : "memory");
+    __asm__ volatile ("rep movsb" : "+D"(dest), "+S"(src), "+c"(tail) : : "memory");
+}
+
+// SSE2 block kernels (64 bytes per iteration)
+
+static void sse2_fill_blocks(uint8_t* dest, uint32_t pattern, size_t blocks) {
+    __asm__ volatile (
+        "movd %k[pattern], %%xmm0\n\t"
+        "pshufd $0, %%xmm0, %%xmm0\n\t"
+        "1:\n\t"
+        "movdqa %%xmm0, (%[dest])\n\t"
+        "movdqa %%xmm0, 16(%[dest])\n\t"
+        "movdqa %%xmm0, 32(%[dest])\n\t"
+        "movdqa %%xmm0, 48(%[dest])\n\t"
+        "add $64, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b"
+        : [dest] "+r"(dest), [blocks] "+r"(blocks)
+        : [pattern] "r"(pattern)
+        : "xmm0", "memory", "cc");
+}
+
+static void sse2_fill_blocks_nt(uint8_t* dest, uint32_t pattern, size_t blocks) {
+    __asm__ volatile (
+        "movd %k[pattern], %%xmm0\n\t"
+        "pshufd $0, %%xmm0, %%xmm0\n\t"
+        "1:\n\t"
+        "movntdq %%xmm0, (%[dest])\n\t"
+        "movntdq %%xmm0, 16(%[dest])\n\t"
+        "movntdq %%xmm0, 32(%[dest])\n\t"
+        "movntdq %%xmm0, 48(%[dest])\n\t"
+        "add $64, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "sfence"
+        : [dest] "+r"(dest), [blocks] "+r"(blocks)
+        : [pattern] "r"(pattern)
+        : "xmm0", "memory", "cc");
+}
+
+static void sse2_copy_blocks(uint8_t* dest, const uint8_t* src, size_t blocks) {
+    __asm__ volatile (
+        "1:\n\t"
+        "movdqu (%[src]), %%xmm0\n\t"
+        "movdqu 16(%[src]), %%xmm1\n\t"
+        "movdqu 32(%[src]), %%xmm2\n\t"
+        "movdqu 48(%[src]), %%xmm3\n\t"
+        "movdqa %%xmm0, (%[dest])\n\t"
+        "movdqa %%xmm1, 16(%[dest])\n\t"
+        "movdqa %%xmm2, 32(%[dest])\n\t"
+        "movdqa %%xmm3, 48(%[dest])\n\t"
+        "add $64, %[src]\n\t"
+        "add $64, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b"
+        : [dest] "+r"(dest), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+}
+
+static void sse2_copy_blocks_nt(uint8_t* dest, const uint8_t* src, size_t blocks) {
+    __asm__ volatile (
+        "1:\n\t"
+        "movdqu (%[src]), %%xmm0\n\t"
+        "movdqu 16(%[src]), %%xmm1\n\t"
+        "movdqu 32(%[src]), %%xmm2\n\t"
+        "movdqu 48(%[src]), %%xmm3\n\t"
+        "movntdq %%xmm0, (%[dest])\n\t"
+        "movntdq %%xmm1, 16(%[dest])\n\t"
+        "movntdq %%xmm2, 32(%[dest])\n\t"
+        "movntdq %%xmm3, 48(%[dest])\n\t"
+        "add $64, %[src]\n\t"
+        "add $64, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "sfence"
+        : [dest] "+r"(dest), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+}
+
+// AVX2 block kernels (128 bytes per iteration)
+
+static void avx2_fill_blocks(uint8_t* dest, uint32_t pattern, size_t blocks) {
+    __asm__ volatile (
+        "vmovd %k[pattern], %%xmm0\n\t"
+        "vpbroadcastd %%xmm0, %%ymm0\n\t"
+        "1:\n\t"
+        "vmovdqa %%ymm0, (%[dest])\n\t"
+        "vmovdqa %%ymm0, 32(%[dest])\n\t"
+        "vmovdqa %%ymm0, 64(%[dest])\n\t"
+        "vmovdqa %%ymm0, 96(%[dest])\n\t"
+        "add $128, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : [dest] "+r"(dest), [blocks] "+r"(blocks)
+        : [pattern] "r"(pattern)
+        : "xmm0", "memory", "cc");
+}
+
+static void avx2_fill_blocks_nt(uint8_t* dest, uint32_t pattern, size_t blocks) {
+    __asm__ volatile (
+        "vmovd %k[pattern], %%xmm0\n\t"
+        "vpbroadcastd %%xmm0, %%ymm0\n\t"
+        "1:\n\t"
+        "vmovntdq %%ymm0, (%[dest])\n\t"
+        "vmovntdq %%ymm0, 32(%[dest])\n\t"
+        "vmovntdq %%ymm0, 64(%[dest])\n\t"
+        "vmovntdq %%ymm0, 96(%[dest])\n\t"
+        "add $128, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "sfence\n\t"
+        "vzeroupper"
+        : [dest] "+r"(dest), [blocks] "+r"(blocks)
+        : [pattern] "r"(pattern)
+        : "xmm0", "memory", "cc");
+}
+
+static void avx2_copy_blocks(uint8_t* dest, const uint8_t* src, size_t blocks) {
+    __asm__ volatile (
+        "1:\n\t"
+        "vmovdqu (%[src]), %%ymm0\n\t"
+        "vmovdqu 32(%[src]), %%ymm1\n\t"
+        "vmovdqu 64(%[src]), %%ymm2\n\t"
+        "vmovdqu 96(%[src]), %%ymm3\n\t"
+        "vmovdqa %%ymm0, (%[dest])\n\t"
+        "vmovdqa %%ymm1, 32(%[dest])\n\t"
+        "vmovdqa %%ymm2, 64(%[dest])\n\t"
+        "vmovdqa %%ymm3, 96(%[dest])\n\t"
+        "add $128, %[src]\n\t"
+        "add $128, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : [dest] "+r"(dest), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+}
+
+static void avx2_copy_blocks_nt(uint8_t* dest, const uint8_t* src, size_t blocks) {
+    __asm__ volatile (
+        "1:\n\t"
+        "vmovdqu (%[src]), %%ymm0\n\t"
+        "vmovdqu 32(%[src]), %%ymm1\n\t"
+        "vmovdqu 64(%[src]), %%ymm2\n\t"
+        "vmovdqu 96(%[src]), %%ymm3\n\t"
+        "vmovntdq %%ymm0, (%[dest])\n\t"
+        "vmovntdq %%ymm1, 32(%[dest])\n\t"
+        "vmovntdq %%ymm2, 64(%[dest])\n\t"
+        "vmovntdq %%ymm3, 96(%[dest])\n\t"
+        "add $128, %[src]\n\t"
+        "add $128, %[dest]\n\t"
+        "dec %[blocks]\n\t"
+        "jnz 1b\n\t"
+        "sfence\n\t"
+        "vzeroupper"
+        : [dest] "+r"(dest), [src] "+r"(src), [blocks] "+r"(blocks)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+}
+
+static void fill_sse2(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    fill_with(dest, pattern, bytes, SSE2_ALIGN, SSE2_BLOCK, sse2_fill_blocks);
+}
+
+static void fill_sse2_nt(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    fill_with(dest, pattern, bytes, SSE2_ALIGN, SSE2_BLOCK, sse2_fill_blocks_nt);
+}
+
+static void copy_sse2(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    copy_with(dest, src, bytes, SSE2_ALIGN, SSE2_BLOCK, sse2_copy_blocks);
+}
+
+static void copy_sse2_nt(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    copy_with(dest, src, bytes, SSE2_ALIGN, SSE2_BLOCK, sse2_copy_blocks_nt);
+}
+
+static void fill_avx2(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    fill_with(dest, pattern, bytes, AVX2_ALIGN, AVX2_BLOCK, avx2_fill_blocks);
+}
+
+static void fill_avx2_nt(uint8_t* dest, uint32_t pattern, size_t bytes) {
+    fill_with(dest, pattern, bytes, AVX2_ALIGN, AVX2_BLOCK, avx2_fill_blocks_nt);
+}
+
+static void copy_avx2(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    copy_with(dest, src, bytes, AVX2_ALIGN, AVX2_BLOCK, avx2_copy_blocks);
+}
+
+static void copy_avx2_nt(uint8_t* dest, const uint8_t* src, size_t bytes) {
+    copy_with(dest, src, bytes, AVX2_ALIGN, AVX2_BLOCK, avx2_copy_blocks_nt);
+}
+
+// Dispatch
+
+static fill_fn fill_temporal = fill_stosq;
+static fill_fn fill_streaming = fill_stosq;
+static copy_fn copy_temporal = copy_movsq;
+static copy_fn copy_streaming = copy_movsq;
+static const char* impl_name = "rep";
+
+void fast_fill(void* dest, uint32_t pattern, size_t bytes) {
+    if (bytes >= SIMD_STREAMING_THRESHOLD) {
+        fill_streaming((uint8_t*)dest, pattern, bytes);
+    } else if (bytes >= ERMS_THRESHOLD && (features & CPU_FEATURE_ERMS) &&
+               pattern == (pattern & 0xFF) * 0x01010101U) {
+        // rep stosb stores a single byte value
+        __asm__ volatile ("rep stosb" : "+D"(dest), "+c"(bytes) : "a"(pattern & 0xFF) : "memory");
+    } else {
+        fill_temporal((uint8_t*)dest, pattern, bytes);
+    }
+}
+
+void fast_copy(void* dest, const void* src, size_t bytes) {
+    if (bytes >= SIMD_STREAMING_THRESHOLD) {
+        copy_streaming((uint8_t*)dest, (const uint8_t*)src, bytes);
+    } else if (bytes >= ERMS_THRESHOLD && (features & CPU_FEATURE_ERMS)) {
+        __asm__ volatile ("rep movsb" : "+D"(dest), "+S"(src), "+c"(bytes) : : "memory");
+    } else {
+        copy_temporal((uint8_t*)dest, (const uint8_t*)src, bytes);
+    }
+}
+
+static inline uint64_t read_cr0(void) {
+    uint64_t value;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint64_t value) {
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(value));
+}
+
+static inline uint64_t read_cr4(void) {
+    uint64_t value;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr4(uint64_t value) {
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(value));
+}
+
+static inline void xsetbv(uint32_t index, uint64_t value) {
+    __asm__ volatile ("xsetbv" : : "c"(index), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+void simd_init(void) {
+    uint32_t max_leaf, ecx, ebx7 = 0;
+    cpuid(0, 0, &max_leaf, 0, 0, 0);
+    cpuid(1, 0, 0, 0, &ecx, 0);
+    if (max_leaf >= CPUID_LEAF_EXTENDED_FEATURES) {
+        cpuid(CPUID_LEAF_EXTENDED_FEATURES, 0, 0, &ebx7, 0, 0);
+    }
+
+    // SSE2 is architectural on x86_64; the OS only has to opt in
+    write_cr0((read_cr0() & ~CR0_EM) | CR0_MP);
+    write_cr4(read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    features = CPU_FEATURE_SSE2;
+
+    if (ecx & CPUID_ECX_XSAVE) {
+        write_cr4(read_cr4() | CR4_OSXSAVE);
+        uint64_t xcr0 = XCR0_X87 | XCR0_SSE;
+        if (ecx & CPUID_ECX_AVX) xcr0 |= XCR0_AVX;
+        xsetbv(0, xcr0);
+
+        // Keep AVX only if its save area fits in simd_state_t
+        uint32_t area_size;
+        cpuid(CPUID_LEAF_XSAVE, 0, 0, &area_size, 0, 0);
+        if (area_size > SIMD_STATE_SIZE) {
+            xcr0 = XCR0_X87 | XCR0_SSE;
+            xsetbv(0, xcr0);
+        }
+
+        features |= CPU_FEATURE_XSAVE;
+        use_xsave = 1;
+        if (xcr0 & XCR0_AVX) {
+            features |= CPU_FEATURE_AVX;
+            if (ebx7 & CPUID_EBX7_AVX2) features |= CPU_FEATURE_AVX2;
+        }
+    }
+    if (ebx7 & CPUID_EBX7_ERMS) features |= CPU_FEATURE_ERMS;
+    simd_enabled = 1;
+
+    if (features & CPU_FEATURE_AVX2) {
+        fill_temporal = fill_avx2;
+        fill_streaming = fill_avx2_nt;
+        copy_temporal = copy_avx2;
+        copy_streaming = copy_avx2_nt;
+        impl_name = (features & CPU_FEATURE_ERMS) ? "avx2+erms" : "avx2";
+    } else {
+        fill_temporal = fill_sse2;
+        fill_streaming = fill_sse2_nt;
+        copy_temporal = copy_sse2;
+        copy_streaming = copy_sse2_nt;
+        impl_name = (features & CPU_FEATURE_ERMS) ? "sse2+erms" : "sse2";
+    }
+}
+
+uint32_t simd_features(void) {
+    return features;
+}
+
+const char* simd_impl_name(void) {
+    return impl_name;
+}
+
+void simd_save(simd_state_t* state) {
+    if (!simd_enabled) return;
+    if (use_xsave) {
+        // XRSTOR faults on a non-zero XCOMP_BV/reserved header, and XSAVE
+        // leaves those bytes alone, so clear the header first
+        uint64_t* header = (uint64_t*)(state->data + XSAVE_HEADER_OFFSET);
+        for (size_t i = 0; i < XSAVE_HEADER_SIZE / sizeof(uint64_t); i++) {
+            header[i] = 0;
+        }
+        __asm__ volatile ("xsave64 %0" : "+m"(*state) : "a"(0xFFFFFFFFU), "d"(0xFFFFFFFFU) : "memory");
+    } else {
+        __asm__ volatile ("fxsave64 %0" : "+m"(*state) : : "memory");
+    }
+}
+
+void simd_restore(simd_state_t* state) {
+    if (!simd_enabled) return;
+    if (use_xsave) {
+        __asm__ volatile ("xrstor64 %0" : : "m"(*state), "a"(0xFFFFFFFFU), "d"(0xFFFFFFFFU) : "memory");
+    } else {
+        __asm__ volatile ("fxrstor64 %0" : : "m"(*state) : "memory");
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "stdint.h"
+#include "graphics.h"
+
+// Scaffolding shared by the boot-time drawing benchmarks
+
+// Small LCG, so every run draws the same scene
+static inline uint32_t bench_random(uint32_t* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+static inline uint64_t bench_pixels_per_second(uint64_t pixels, uint64_t cycles, uint64_t hz) {
+    if (cycles == 0) return 0;
+    // Split the product to stay inside 64 bits for long runs
+    return pixels * (hz / 1000) / cycles * 1000;
+}
+
+// Render buffer to time against, with a whole-buffer target. It is cleared
+// first so every page is faulted in before timing. Returns NULL when out of
+// memory; release it with destroy_render_buffer.
+static inline render_buffer_t* bench_create_buffer(uint32_t width, uint32_t height, raster_target_t* target) {
+    render_buffer_t* buffer = create_render_buffer(width, height);
+    if (!buffer) return 0;
+    clear_render_buffer(buffer, 0);
+    render_buffer_raster_target(buffer, target);
+    return buffer;
+}
+
+#endif
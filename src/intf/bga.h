@@ -0,0 +1,31 @@
+#ifndef BGA_H
+#define BGA_H
+
+#include "stdint.h"
+
+// Bochs Graphics Adapter (QEMU -vga std, Bochs, VirtualBox VBoxVGA)
+#define BGA_PAGE_COUNT 2 // Virtual height is twice the screen for flipping
+
+// Detect the adapter and locate its linear framebuffer. Returns 1 if present.
+int bga_init(void);
+int bga_available(void);
+
+// Program resolution and depth. The virtual screen is BGA_PAGE_COUNT screens
+// tall; page 0 is shown. bpp is 8, 16, 24 or 32, the depths with a pixel
+// format. Returns 1 on success, 0 if unsupported.
+int bga_set_mode(uint32_t width, uint32_t height, uint32_t bpp);
+void bga_disable(void);
+
+// Linear framebuffer covering every page
+uint64_t bga_framebuffer_phys(void);
+uint64_t bga_framebuffer_size(void);
+uint32_t bga_pitch(void);
+
+// Start of the given page in the framebuffer
+uint8_t* bga_page_address(uint32_t page);
+
+// Show a page by moving the Y offset - no pixels are copied
+void bga_show_page(uint32_t page);
+uint32_t bga_visible_page(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include "stdint.h"
+#include "graphics.h"
+
+// Premultiplied-alpha compositing on 32-bit 0xAARRGGBB pixels. In a
+// premultiplied pixel every colour channel is already scaled by alpha, so
+// "source over destination" is a single multiply-add per channel:
+//   dst = src + dst * (255 - src.a) / 255
+// The divide by 255 is done as (t + 128 + ((t + 128) >> 8)) >> 8, which is
+// exact for all 8-bit inputs. Spans run 8 pixels at a time with AVX2 or 4
+// with SSE2 once simd_init() has enabled them.
+
+uint32_t premultiply_pixel(uint32_t argb);
+// Back to straight alpha, through a reciprocal table rather than a divide
+uint32_t unpremultiply_pixel(uint32_t argb);
+// Premultiplied src over dst for a single pixel
+uint32_t blend_premultiplied(uint32_t src, uint32_t dst);
+// Convert straight-alpha pixels to premultiplied in place
+void premultiply_span(uint32_t* pixels, size_t count);
+void premultiply_render_buffer(render_buffer_t* buffer);
+
+// Composite premultiplied src over dst
+void blend_span(uint32_t* dst, const uint32_t* src, size_t count);
+// Composite one premultiplied colour over dst (shadows, tints)
+void blend_fill_span(uint32_t* dst, uint32_t color, size_t count);
+
+// Composite a width x height block of src (from src_x, src_y) over dst at
+// (dst_x, dst_y), clipped against both buffers. Marks dst damage.
+void blend_rect(render_buffer_t* dst, int32_t dst_x, int32_t dst_y, const render_buffer_t* src,
+                int32_t src_x, int32_t src_y, uint32_t width, uint32_t height);
+// Composite a premultiplied colour over a rectangle of dst
+void blend_fill_rect(render_buffer_t* dst, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include "stdint.h"
+
+// Model-specific registers
+#define MSR_IA32_PAT 0x277
+
+// CPUID leaf 1 EDX feature bits
+#define CPUID_EDX_TSC (1U << 4)
+#define CPUID_EDX_PAT (1U << 16)
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    uint32_t a, b, c, d;
+    __asm__ volatile ( "cpuid"
+                   : "=a"(a), "=b"(b), "=c"(c), "=d"(d)
+                   : "a"(leaf), "c"(subleaf) );
+    if (eax) *eax = a;
+    if (ebx) *ebx = b;
+    if (ecx) *ecx = c;
+    if (edx) *edx = d;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    __asm__ volatile ( "rdmsr" : "=a"(low), "=d"(high) : "c"(msr) );
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile ( "wrmsr"
+                   : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)) );
+}
+
+// Serialized enough for benchmarking: earlier stores are not reordered past it
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile ( "mfence; rdtsc" : "=a"(low), "=d"(high) : : "memory" );
+    return ((uint64_t)high << 32) | low;
+}
+
+// Spin-wait hint: eases the pipeline and a sibling hyperthread while polling
+static inline void cpu_relax(void) {
+    __asm__ volatile ( "pause" : : : "memory" );
+}
+
+static inline void wbinvd(void) {
+    __asm__ volatile ( "wbinvd" : : : "memory" );
+}
+
+#endif
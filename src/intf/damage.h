@@ -0,0 +1,37 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include "stdint.h"
+
+// Damage region: a bounded list of dirty rectangles. Rectangles that overlap
+// or touch are merged on insert; once the list is full a new rectangle is
+// merged into whichever existing one grows the least.
+#define DAMAGE_MAX_RECTS 16
+
+// Past this share of the surface a single full copy beats many small ones
+#define DAMAGE_FULL_PERCENT 50
+
+typedef struct {
+    uint32_t x1, y1;  // Inclusive
+    uint32_t x2, y2;  // Exclusive
+} damage_rect_t;
+
+typedef struct {
+    uint32_t width;   // Surface bounds, damage is clipped to them
+    uint32_t height;
+    damage_rect_t rects[DAMAGE_MAX_RECTS];
+    uint32_t count;
+    uint8_t full;     // Whole surface is dirty, rects are ignored
+} damage_region_t;
+
+void damage_init(damage_region_t* region, uint32_t width, uint32_t height);
+void damage_clear(damage_region_t* region);
+void damage_add(damage_region_t* region, int32_t x, int32_t y, uint32_t width, uint32_t height);
+void damage_add_full(damage_region_t* region);
+
+// Sum of the rectangle areas (the whole surface when full)
+uint64_t damage_area(const damage_region_t* region);
+// 1 if presenting the whole surface is cheaper than the individual rects
+int damage_prefers_full(const damage_region_t* region);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef DISPLAY_LIST_H
+#define DISPLAY_LIST_H
+
+#include "stdint.h"
+#include "raster.h"
+#include "damage.h"
+
+// Recorded drawing. Ops are appended to an arena instead of touching the
+// screen; flushing bins them by DISPLAY_TILE_SIZE tile, drops every op a
+// later opaque rectangle hides within a tile, and then runs each tile's
+// surviving ops in order, clipped to the tile. Consecutive fills of one
+// colour that line up into a single rectangle are merged as they are
+// recorded.
+#define DISPLAY_TILE_SIZE 64
+#define DISPLAY_MAX_OCCLUDERS 8       // Opaque rects tracked per tile while culling
+#define DISPLAY_MAX_OPS 65535         // Tile bins hold 16-bit op numbers
+#define DISPLAY_DEFAULT_ARENA (32 * 1024)
+
+typedef enum {
+    DISPLAY_OP_FILL = 0,  // Solid rectangle, colour in the target format
+    DISPLAY_OP_LINE,      // One-pixel line, both endpoints drawn
+    DISPLAY_OP_TEXT,      // 8x8 font string, copied into the arena
+    DISPLAY_OP_BLIT,      // 32-bit ARGB image, alpha ignored
+    DISPLAY_OP_BLEND,     // Premultiplied 32-bit ARGB image composited over the target
+    DISPLAY_OP_CIRCLE,    // Filled circle
+    DISPLAY_OP_TRIANGLE   // Filled triangle, vertices on pixel corners
+} display_op_type_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t color;
+    int32_t x1, y1, x2, y2;  // Bounding box, x2/y2 exclusive
+    union {
+        struct { int32_t x1, y1, x2, y2; } line;
+        const char* text;
+        // Not copied: the pixels must stay valid until the flush
+        struct { const uint32_t* pixels; uint32_t stride; } image;
+        struct { int32_t x, y; uint32_t radius; } circle;
+        struct { int32_t x[3], y[3]; } triangle;
+    } data;
+} display_op_t;
+
+// Ops grow up from the start of the arena and text grows down from the end.
+// At flush time the gap between them holds the tile bins.
+typedef struct {
+    uint8_t* arena;
+    size_t arena_size;
+    uint32_t op_count;
+    size_t text_bytes;
+    uint32_t merged_fills;  // Fills folded into the previous op since the last flush
+} display_list_t;
+
+typedef struct {
+    uint32_t ops;              // Ops recorded (after fill merging)
+    uint32_t merged_fills;
+    uint32_t culled;           // Op/tile pairs skipped as hidden
+    uint32_t tiles;            // Tiles that ran at least one op
+    uint64_t pixels_immediate; // Pixels the ops would write drawn one by one
+    uint64_t pixels_written;   // Pixels the flush actually wrote
+} display_list_stats_t;
+
+// Returns 0 if the arena cannot be allocated
+display_list_t* display_list_create(size_t arena_size);
+void display_list_destroy(display_list_t* list);
+void display_list_reset(display_list_t* list);
+
+// Each returns 0 when the arena is full (the op is dropped), else 1
+int display_list_fill_rect(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color);
+// Outline as four fills, so the edges take part in merging and culling
+int display_list_draw_rect(display_list_t* list, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color);
+int display_list_draw_line(display_list_t* list, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+int display_list_draw_text(display_list_t* list, int32_t x, int32_t y, const char* str, uint32_t color);
+int display_list_fill_circle(display_list_t* list, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color);
+int display_list_fill_triangle(display_list_t* list, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                               int32_t x3, int32_t y3, uint32_t color);
+int display_list_blit(display_list_t* list, const uint32_t* pixels, uint32_t stride,
+                      int32_t x, int32_t y, uint32_t width, uint32_t height);
+int display_list_blend(display_list_t* list, const uint32_t* pixels, uint32_t stride,
+                       int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+// Run every recorded op against the target (within its clip rectangle),
+// then empty the list. Each op's visible area is added to damage; damage
+// and stats may be null.
+void display_list_flush(display_list_t* list, const raster_target_t* target, damage_region_t* damage,
+                        display_list_stats_t* stats);
+
+// Built-in scene: DISPLAY_BENCH_PRIMITIVES random rects, circles, triangles
+// and lines on a DISPLAY_BENCH_WIDTH x DISPLAY_BENCH_HEIGHT 32-bit buffer.
+// The same frame is drawn op by op over the whole buffer, then flushed
+// through the tiles. Both are rated on the immediate pixel count, so the
+// rates compare time for the same frame. Only the boot CPU is running, so
+// the tiled rate is a single-CPU one.
+#define DISPLAY_BENCH_WIDTH 1024
+#define DISPLAY_BENCH_HEIGHT 768
+#define DISPLAY_BENCH_PRIMITIVES 2000
+
+typedef struct {
+    uint32_t tiles;                       // Tiles that ran at least one op
+    uint64_t pixels_immediate;            // Per frame
+    uint64_t pixels_written;              // Per frame, after culling
+    uint64_t immediate_pixels_per_second; // Whole buffer, recording order
+    uint64_t tiled_pixels_per_second;     // Tile by tile
+} display_list_benchmark_t;
+
+// Returns 0 if no buffer, arena or TSC rate was available
+int display_list_benchmark(display_list_benchmark_t* result);
+
+#endif
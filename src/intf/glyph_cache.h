@@ -0,0 +1,66 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include "stdint.h"
+#include "pixel_format.h"
+
+// Pre-expanded glyphs for the 8x8 font. The first use of a (character,
+// colour, pixel format) triple decodes each font row into runs of set
+// pixels and expands the colour into a span in the target format, so
+// drawing is a few short stores per row instead of a bit test and a call
+// per pixel. Entries live in a small set-associative cache with LRU
+// replacement inside each set.
+#define GLYPH_WIDTH 8
+#define GLYPH_HEIGHT 8
+#define GLYPH_LINE_HEIGHT 10  // Baseline spacing for multi-line text
+#define GLYPH_MAX_RUNS 4      // An 8-pixel row has at most 4 separate runs
+#define GLYPH_CACHE_SETS 32
+#define GLYPH_CACHE_WAYS 4    // 128 glyphs in total
+
+typedef struct {
+    uint8_t start;
+    uint8_t length;
+} glyph_run_t;
+
+typedef struct {
+    uint32_t color;
+    const pixel_format_t* format;
+    uint8_t c;
+    uint8_t valid;
+    uint32_t last_used;
+    uint8_t run_count[GLYPH_HEIGHT];
+    glyph_run_t runs[GLYPH_HEIGHT][GLYPH_MAX_RUNS];
+    uint8_t span[GLYPH_WIDTH * 4];  // GLYPH_WIDTH pixels of colour, target format
+} glyph_t;
+
+// Target surface for glyph_draw: a pixel array in any format plus the clip
+// rectangle [clip_x1, clip_x2) x [clip_y1, clip_y2)
+typedef struct {
+    uint8_t* pixels;
+    uint32_t pitch;
+    const pixel_format_t* format;
+    int32_t clip_x1, clip_y1;
+    int32_t clip_x2, clip_y2;
+} glyph_target_t;
+
+// Returns 0 for characters the font does not cover
+const glyph_t* glyph_cache_lookup(char c, uint32_t color, const pixel_format_t* format);
+void glyph_draw(const glyph_t* glyph, const glyph_target_t* target, int32_t x, int32_t y);
+
+// Draw a run of glyphs side by side, GLYPH_WIDTH apart. The line is clipped
+// once and written row by row across all glyphs, so each scanline is
+// touched in one left-to-right pass. Null entries are skipped (blanks).
+void glyph_draw_line(const glyph_t* const* glyphs, uint32_t count, const glyph_target_t* target, int32_t x, int32_t y);
+
+// Lay out a string ('\n' starts a new line) as batched glyph lines and
+// report the extent it covers
+void glyph_draw_text(const glyph_target_t* target, int32_t x, int32_t y, const char* str, uint32_t color,
+                     uint32_t* width, uint32_t* height);
+// The extent glyph_draw_text would cover, without drawing
+void glyph_text_extent(const char* str, uint32_t* width, uint32_t* height);
+
+// Drop every entry (e.g. after a mode change)
+void glyph_cache_flush(void);
+void glyph_cache_stats(uint32_t* hits, uint32_t* misses);
+
+#endif
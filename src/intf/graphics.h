@@ -2,6 +2,12 @@
 #define GRAPHICS_H
 
 #include "stdint.h"
+#include "pat.h"
+#include "damage.h"
+#include "raster.h"
+#include "scale.h"
+#include "display_list.h"
+#include "sprite.h"
 
 // Supported video modes
 #define VGA_MODE_13H_WIDTH 320
@@ -25,6 +31,7 @@
 #define VGA_WIDTH VGA_MODE_13H_WIDTH
 #define VGA_HEIGHT VGA_MODE_13H_HEIGHT
 #define VGA_MODE13_SEGMENT 0xA000
+#define VGA_LEGACY_WINDOW_SIZE 0x20000 // 0xA0000-0xBFFFF
 
 // Video mode enumeration
 typedef enum {
@@ -32,7 +39,9 @@ typedef enum {
     VGA_MODE_12H = 0x12,    // 640x480x16
     VGA_MODE_101H = 0x101,  // 640x480x256
     VGA_MODE_103H = 0x103,  // 800x600x256
-    VGA_MODE_118H = 0x118   // 1024x768x24 (VESA)
+    VGA_MODE_118H = 0x118,  // 1024x768x24 (VESA)
+    VGA_MODE_LFB = 0x4000,  // Linear framebuffer set up by the bootloader
+    VGA_MODE_BGA = 0x4001   // Bochs Graphics Adapter, 1024x768x32 with page flipping
 } vga_mode_t;
 
 // Color structures for different depths
@@ -53,6 +62,7 @@ typedef uint8_t color_8bit_t;    // 256 color palette
 extern uint32_t current_vga_width;
 extern uint32_t current_vga_height;
 extern uint32_t current_color_depth;
+extern uint32_t current_vga_pitch; // Bytes per scanline
 extern vga_mode_t current_vga_mode;
 extern int graphics_initialized;
 
@@ -62,8 +72,19 @@ void vga_init_mode12h(void);
 int vga_init_mode101h(void);
 int vga_init_mode103h(void);
 int vga_init_mode118h(void);
+int vga_init_linear_framebuffer(void);
+// Program the Bochs Graphics Adapter at runtime (any resolution it accepts)
+int vga_set_bga_mode(uint32_t width, uint32_t height, uint32_t bpp);
 int vga_set_mode(vga_mode_t mode);
 
+// Code that keeps state sized to the screen registers a hook here instead
+// of polling current_vga_width/height. Each hook is called once when added
+// and again after every mode set, with the screen size it left.
+// Adding a hook twice is harmless; returns 0 when the table is full.
+#define VGA_MAX_MODE_HOOKS 8
+typedef void (*vga_mode_hook_fn)(uint32_t width, uint32_t height);
+int vga_add_mode_hook(vga_mode_hook_fn hook);
+
 // Set a pixel at (x, y) with color (supports different color depths)
 void vga_set_pixel(uint32_t x, uint32_t y, uint32_t color);
 
@@ -72,38 +93,76 @@ uint32_t vga_get_pixel(uint32_t x, uint32_t y);
 
 // Color conversion utilities
 uint32_t rgb_to_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+// 0xAARRGGBB to a pixel value in the current depth
+uint32_t argb_to_color(uint32_t argb);
 void color_to_rgb(uint32_t color, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a);
 
+// Colors passed to the vga_* drawing functions are pixel values in the
+// current depth (see rgb_to_color)
+
 // Fill a rectangle with color
-void vga_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color);
-void vga_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color);
+void vga_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color);
+void vga_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color);
 void vga_set_desktop_background(void);
-void vga_clear(uint8_t color);
+// Just the part of the desktop gradient inside a rectangle
+void vga_draw_desktop_background(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+void vga_clear(uint32_t color);
 
 // Advanced drawing primitives
-void vga_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint8_t color);
-void vga_draw_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint8_t color);
-void vga_fill_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint8_t color);
-void vga_draw_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint8_t color);
-void vga_fill_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint8_t color);
+void vga_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t color);
+void vga_draw_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint32_t color);
+void vga_fill_circle(uint32_t center_x, uint32_t center_y, uint32_t radius, uint32_t color);
+void vga_draw_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint32_t color);
+void vga_fill_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint32_t color);
+// Extra clip rectangle for lines and filled shapes, on top of the screen
+void vga_set_clip_rect(int32_t x, int32_t y, uint32_t width, uint32_t height);
+void vga_reset_clip_rect(void);
+// Run a recorded display list on the screen (honours the clip rectangle)
+void vga_flush_display_list(display_list_t* list, display_list_stats_t* stats);
+// Run-length encoded sprites (honour the clip rectangle); a batch draws in
+// order, later instances on top
+void vga_draw_sprite(const sprite_t* sprite, int32_t x, int32_t y, uint32_t flags);
+void vga_draw_sprites(const sprite_instance_t* instances, uint32_t count);
+// Non-zero winding fill of any polygon, vertices at pixel corners
+void vga_fill_polygon(const raster_point_t* points, uint32_t count, uint32_t color);
+void vga_fill_rounded_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t radius, uint32_t color);
 
 // Graphics utilities
-void vga_draw_horizontal_line(uint32_t x, uint32_t y, uint32_t length, uint8_t color);
-void vga_draw_vertical_line(uint32_t x, uint32_t y, uint32_t length, uint8_t color);
+void vga_draw_horizontal_line(uint32_t x, uint32_t y, uint32_t length, uint32_t color);
+void vga_draw_vertical_line(uint32_t x, uint32_t y, uint32_t length, uint32_t color);
 
 // Performance optimizations
-void vga_fast_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t color);
-void vga_fast_clear(uint8_t color);
+// Colors are pixel values in the current depth
+void vga_fast_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color);
+void vga_fast_clear(uint32_t color);
+// Move a block of the screen, overlap-safe. Both rectangles must lie on the
+// screen; returns 0 (and moves nothing) otherwise.
+int vga_move_rect(uint32_t src_x, uint32_t src_y, uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height);
+
+// Framebuffer memory type (write-combining unless benchmarking)
+int vga_map_framebuffer(pat_type_t type);
+
+typedef struct {
+    pat_type_t type;
+    uint64_t cycles_per_clear;
+} vga_clear_timing_t;
+
+#define VGA_BENCH_MAX_TYPES 4
 
-// Text rendering (basic bitmap font)
-void vga_draw_char(uint32_t x, uint32_t y, char c, uint8_t color);
-void vga_draw_string(uint32_t x, uint32_t y, const char* str, uint8_t color);
+// Time vga_fast_clear with the framebuffer mapped as each memory type, then
+// leave it write-combining. Returns the number of results written.
+uint32_t vga_benchmark_memory_types(vga_clear_timing_t* results, uint32_t max_results);
+
+// Text rendering (8x8 bitmap font through the glyph cache)
+void vga_draw_char(uint32_t x, uint32_t y, char c, uint32_t color);
+void vga_draw_string(uint32_t x, uint32_t y, const char* str, uint32_t color);
 
 // Software rendering pipeline
 typedef struct {
     uint32_t width;
     uint32_t height;
     uint32_t* pixels;  // 32-bit RGBA buffer
+    damage_region_t* damage;  // Optional: software drawing records what it touches
 } render_buffer_t;
 
 // Rendering pipeline functions
@@ -111,6 +170,8 @@ render_buffer_t* create_render_buffer(uint32_t width, uint32_t height);
 void destroy_render_buffer(render_buffer_t* buffer);
 void clear_render_buffer(render_buffer_t* buffer, uint32_t color);
 void render_buffer_to_screen(render_buffer_t* buffer, uint32_t screen_x, uint32_t screen_y);
+// Whole-buffer raster target (32-bit colours) for the span rasterizer
+void render_buffer_raster_target(render_buffer_t* buffer, raster_target_t* target);
 
 // 2D rendering functions (software)
 void draw_pixel_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t color);
@@ -119,15 +180,35 @@ void draw_rect_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t
 void fill_rect_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t color);
 void draw_circle_software(render_buffer_t* buffer, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color);
 void fill_circle_software(render_buffer_t* buffer, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color);
-
-// Alpha blending
+void fill_triangle_software(render_buffer_t* buffer, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                            int32_t x3, int32_t y3, uint32_t color);
+void fill_polygon_software(render_buffer_t* buffer, const raster_point_t* points, uint32_t count, uint32_t color);
+void fill_rounded_rect_software(render_buffer_t* buffer, int32_t x, int32_t y, uint32_t width, uint32_t height,
+                                uint32_t radius, uint32_t color);
+void draw_char_software(render_buffer_t* buffer, int32_t x, int32_t y, char c, uint32_t color);
+void draw_string_software(render_buffer_t* buffer, int32_t x, int32_t y, const char* str, uint32_t color);
+// Run a recorded display list into the buffer (32-bit colours), marking damage
+void render_buffer_flush_display_list(render_buffer_t* buffer, display_list_t* list, display_list_stats_t* stats);
+void draw_sprites_software(render_buffer_t* buffer, const sprite_instance_t* instances, uint32_t count);
+
+// Alpha blending of one straight-alpha pixel; spans are premultiplied (blend.h)
 uint32_t blend_colors(uint32_t src, uint32_t dst);
 
 // Graphics acceleration optimizations
 void vga_blit_buffer(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
                      uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height);
+// Alpha-composite a premultiplied 32-bit ARGB buffer onto the screen
+// (premultiply_span converts straight alpha)
+void vga_blend_buffer(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
+                      uint32_t dest_x, uint32_t dest_y, uint32_t width, uint32_t height);
+// Stretch a buffer onto the screen (nearest neighbour)
 void vga_blit_buffer_scaled(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
                            uint32_t dest_x, uint32_t dest_y, uint32_t dest_width, uint32_t dest_height);
+// Same with a choice of filter, e.g. a 320x200 game frame smoothed onto a
+// larger linear framebuffer
+void vga_blit_buffer_filtered(uint32_t* src_buffer, uint32_t src_width, uint32_t src_height,
+                              uint32_t dest_x, uint32_t dest_y, uint32_t dest_width, uint32_t dest_height,
+                              scale_filter_t filter);
 
 // Fast memory operations
 void vga_memcpy_fast(void* dest, const void* src, uint32_t count);
@@ -140,13 +221,31 @@ typedef struct {
     uint32_t* front_buffer;
     uint32_t* back_buffer;
     uint8_t current_buffer;
+    uint8_t hardware;  // Buffers are BGA pages; presenting flips instead of copying
+    uint32_t* shadow;  // System-RAM image drawn into when the buffers are BGA pages;
+                       // immediate-mode vga_* drawing goes there too while it lives
+    damage_region_t damage;  // Dirty since the last present
+    damage_region_t stale[2];  // Per buffer (per BGA page when flipping), where it
+                               // lags the newest image
+    render_buffer_t target;  // Current buffer wrapped for the software renderer
 } double_buffer_t;
 
 double_buffer_t* create_double_buffer(uint32_t width, uint32_t height);
 void destroy_double_buffer(double_buffer_t* db);
+// Draw into the other buffer from now on. It is first brought up to date
+// with what it missed, so incremental drawing and present_damage stay
+// valid; with BGA pages there is only the shadow and this does nothing.
 void swap_buffers(double_buffer_t* db);
 uint32_t* get_current_buffer(double_buffer_t* db);
+// The current buffer as a render target whose drawing marks db->damage
+render_buffer_t* get_render_target(double_buffer_t* db);
+// Show the current buffer. On BGA pages only the accumulated damage is
+// written into the hidden page before it is flipped to.
 void present_buffer(double_buffer_t* db);
+// Present only the damaged rectangles (or everything once damage passes
+// DAMAGE_FULL_PERCENT). Drawing continues incrementally in the same buffer;
+// on BGA pages that is the shadow, and only damage is written to VRAM.
+void present_damage(double_buffer_t* db);
 
 #endif
 
@@ -0,0 +1,42 @@
+#ifndef HIT_TEST_H
+#define HIT_TEST_H
+
+#include "stdint.h"
+#include "window.h"
+#include "widget.h"
+
+// Uniform grid over the screen for finding what is under the cursor. Each
+// 16x16 cell lists the windows and widgets overlapping it, highest z
+// first, so a lookup reads one short list instead of walking windows[] and
+// the widget tree. Window and widget code keep their entries current as
+// things are created, moved, raised, hidden or destroyed. A cell that runs
+// out of room is marked and answered by scanning every entry instead.
+#define HIT_CELL_SHIFT    4   // 16x16 pixel cells
+#define HIT_CELL_CAPACITY 12
+#define HIT_MAX_ITEMS     64  // MAX_WINDOWS plus the shell's widgets
+
+typedef enum {
+    HIT_WINDOW = 0,
+    HIT_WIDGET
+} hit_kind_t;
+
+typedef struct {
+    window_t* window;  // Topmost window under the point, 0 if none
+    widget_t* widget;  // Topmost widget under the point, 0 if none
+} hit_test_result_t;
+
+// Size the grid to the screen and follow mode changes. Call once before
+// adding entries.
+void hit_test_init(void);
+
+// Add owner, or update its rectangle and z if it is already in. Higher z
+// is on top; windows and widgets are ordered among their own kind.
+// Returns 0 when the table is full.
+int hit_test_set(void* owner, uint32_t kind, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t z);
+// New rectangle, same z
+void hit_test_move(void* owner, int32_t x, int32_t y, uint32_t width, uint32_t height);
+void hit_test_remove(void* owner);
+
+void hit_test_point(int32_t x, int32_t y, hit_test_result_t* result);
+
+#endif
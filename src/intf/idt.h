@@ -7,7 +7,7 @@
 typedef struct {
     uint16_t isr_low;
     uint16_t kernel_cs;
-    uint8_t  reserved;
+    uint8_t  ist;        // Interrupt Stack Table index (0 = current stack)
     uint8_t  attributes;
     uint16_t isr_high;
     uint32_t isr_higher;
@@ -17,12 +17,31 @@ typedef struct {
 // Structure for the IDT register
 typedef struct {
     uint16_t limit;
-    uint32_t base;
+    uint64_t base;
 } __attribute__((packed)) idt_ptr_t;
 
+// 64-bit Task State Segment - only used for its Interrupt Stack Table, so
+// faults that happen with a bad stack (e.g. touching a not-yet-backed page
+// of a lazily allocated stack) still get a good stack to run on
+typedef struct {
+    uint32_t reserved0;
+    uint64_t rsp[3];
+    uint64_t reserved1;
+    uint64_t ist[7];
+    uint64_t reserved2;
+    uint16_t reserved3;
+    uint16_t iomap_base;
+} __attribute__((packed)) tss_t;
+
 // Function to set an IDT entry
 void set_idt_entry(int n, uint64_t handler);
 
+// Run interrupt vector n on IST stack `ist` (1-7, 0 = current stack)
+void set_idt_entry_ist(int n, uint8_t ist);
+
+// Install the TSS and route page/double faults to dedicated stacks
+void tss_init();
+
 // Function to initialize the IDT
 void idt_init();
 
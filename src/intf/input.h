@@ -0,0 +1,57 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "stdint.h"
+
+// One queue for keyboard and mouse events, single producer and single
+// consumer, without locks. The producer is interrupt context: the keyboard
+// and mouse handlers run on the boot CPU with interrupts off, so they never
+// push at the same time. The consumer is whoever runs the frame loop and
+// drains the queue once per frame.
+//
+// A mouse move pushed while the newest queued event is a move the consumer
+// has not taken yet is folded into it: relative motion adds up, position,
+// buttons and timestamp are the latest. Button and key events are never
+// folded, so clicks survive however far behind the consumer is. The two
+// sides meet on the newest slot only, through its state word: the producer
+// may rewrite a slot it wins from READY, the consumer takes one the same
+// way, and a slot the consumer holds is never folded into.
+#define INPUT_QUEUE_SIZE 256 // Power of two
+
+typedef enum {
+    INPUT_NONE = 0,
+    INPUT_KEY_DOWN,
+    INPUT_KEY_UP,
+    INPUT_MOUSE_MOVE,
+    INPUT_MOUSE_BUTTON  // Button state changed; buttons holds the new state
+} input_event_type_t;
+
+// Modifier bits, as held when the event happened
+#define INPUT_MOD_SHIFT 0x01
+#define INPUT_MOD_CTRL  0x02
+#define INPUT_MOD_ALT   0x04
+#define INPUT_MOD_CAPS  0x08 // Caps Lock is on
+
+typedef struct {
+    uint8_t type;
+    uint8_t keycode;     // Set 1 scancode without the release bit
+    uint8_t modifiers;
+    char ascii;          // Character for the key with modifiers applied, 0 if none
+    uint8_t buttons;     // MOUSE_*_BUTTON bits held after the event
+    int32_t dx, dy;      // Relative motion, y up as the mouse reports it
+    int32_t x, y;        // Pointer position on screen after the event
+    uint64_t timestamp;  // TSC when the event was queued (last fold for moves)
+} input_event_t;
+
+void input_init(void);
+
+// Producer side. Returns 0 if the queue was full and the event dropped.
+int input_push(const input_event_t* event);
+
+// Consumer side. Returns 1 and fills event if one was waiting.
+int input_poll(input_event_t* event);
+uint32_t input_pending(void);
+// Events dropped on a full queue since input_init
+uint32_t input_dropped(void);
+
+#endif
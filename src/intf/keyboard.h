@@ -3,7 +3,8 @@
 
 #include "stdint.h"
 
+// Key presses and releases are queued as input events (see input.h)
 void keyboard_init();
-char get_char();
+void keyboard_handler();
 
 #endif
\ No newline at end of file
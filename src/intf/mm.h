@@ -5,8 +5,21 @@
 
 #define HEAP_SIZE 1024 * 1024 // 1MB heap
 
+// Snapshot of the large-object heap's free space
+typedef struct {
+    size_t free_bytes;          // Total usable bytes on the free lists
+    size_t largest_free_block;  // Biggest single allocation that would succeed
+    uint32_t free_block_count;  // Number of free blocks (fragmentation indicator)
+} mm_stats_t;
+
 void mm_init();
 void* kmalloc(size_t size);
 void kfree(void* ptr);
 
-#endif
\ No newline at end of file
+void mm_get_stats(mm_stats_t* stats);
+
+// Churn random alloc/free sizes, then report free space while the survivors
+// are still live and again after they have been released
+void mm_stress_test(uint32_t iterations, uint32_t seed, mm_stats_t* under_load, mm_stats_t* after_release);
+
+#endif
@@ -3,6 +3,11 @@
 
 #include "stdint.h"
 
+// Button bits of the first packet byte
+#define MOUSE_LEFT_BUTTON 0x01
+#define MOUSE_RIGHT_BUTTON 0x02
+#define MOUSE_MIDDLE_BUTTON 0x04
+
 void mouse_init();
 void mouse_handler();
 
@@ -0,0 +1,78 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "stdint.h"
+
+// Multiboot2 boot information (see the Multiboot2 specification, section 3.6)
+#define MULTIBOOT_TAG_ALIGN 8
+#define MULTIBOOT_TAG_TYPE_END 0
+#define MULTIBOOT_TAG_TYPE_MMAP 6
+#define MULTIBOOT_TAG_TYPE_FRAMEBUFFER 8
+
+// Memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+#define MULTIBOOT_MEMORY_RESERVED 2
+#define MULTIBOOT_MEMORY_ACPI_RECLAIMABLE 3
+#define MULTIBOOT_MEMORY_NVS 4
+#define MULTIBOOT_MEMORY_BADRAM 5
+
+typedef struct {
+    uint32_t total_size;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_info_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+} __attribute__((packed)) multiboot_tag_t;
+
+typedef struct {
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+    uint32_t entry_size;
+    uint32_t entry_version;
+    multiboot_mmap_entry_t entries[];
+} __attribute__((packed)) multiboot_tag_mmap_t;
+
+// Framebuffer types
+#define MULTIBOOT_FRAMEBUFFER_TYPE_INDEXED 0
+#define MULTIBOOT_FRAMEBUFFER_TYPE_RGB 1
+#define MULTIBOOT_FRAMEBUFFER_TYPE_EGA_TEXT 2
+
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+    uint64_t addr;
+    uint32_t pitch;  // Bytes per scanline
+    uint32_t width;
+    uint32_t height;
+    uint8_t bpp;
+    uint8_t framebuffer_type;
+    uint16_t reserved;
+    // Colour layout, valid for MULTIBOOT_FRAMEBUFFER_TYPE_RGB
+    uint8_t red_field_position;
+    uint8_t red_mask_size;
+    uint8_t green_field_position;
+    uint8_t green_mask_size;
+    uint8_t blue_field_position;
+    uint8_t blue_mask_size;
+} __attribute__((packed)) multiboot_tag_framebuffer_t;
+
+// Physical address of the boot information, saved by boot.asm from EBX
+extern uint32_t multiboot_info_addr;
+
+// Find the first tag of the given type (0 if absent or no boot info)
+const multiboot_tag_t* multiboot_find_tag(uint32_t type);
+
+// Physical range occupied by the boot information structure
+uint64_t multiboot_info_start(void);
+uint64_t multiboot_info_end(void);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include "stdint.h"
+
+// Fixed 8bpp palette: a 6x7x6 RGB cube (green gets the extra level, the eye
+// is most sensitive to it) in entries 0-251 and a grey ramp in 252-255.
+// Cube entry = r * 42 + g * 6 + b for levels r, b in 0-5 and g in 0-6.
+#define PALETTE_R_LEVELS 6
+#define PALETTE_G_LEVELS 7
+#define PALETTE_B_LEVELS 6
+#define PALETTE_CUBE_SIZE (PALETTE_R_LEVELS * PALETTE_G_LEVELS * PALETTE_B_LEVELS)
+#define PALETTE_GREY_BASE PALETTE_CUBE_SIZE
+#define PALETTE_GREY_LEVELS 4 // 51, 102, 153, 204 - black and white are in the cube
+#define PALETTE_SIZE 256
+
+// RGB to index lookup, indexed by 5:5:5 RGB
+#define PALETTE_LUT_SIZE 32768
+
+// Nearest cube entry for constant 8-bit RGB, usable in case labels and
+// static initialisers
+#define PALETTE_LEVEL(v, levels) (((v) * ((levels) - 1) + 127) / 255)
+#define PALETTE_RGB(r, g, b) (PALETTE_LEVEL(r, PALETTE_R_LEVELS) * (PALETTE_G_LEVELS * PALETTE_B_LEVELS) + \
+                              PALETTE_LEVEL(g, PALETTE_G_LEVELS) * PALETTE_B_LEVELS +                      \
+                              PALETTE_LEVEL(b, PALETTE_B_LEVELS))
+// Nearest neutral entry for a constant grey
+#define PALETTE_GREY(v) (PALETTE_LEVEL(v, PALETTE_GREY_LEVELS + 2) == 0 ? PALETTE_RGB(0, 0, 0) :          \
+                         PALETTE_LEVEL(v, PALETTE_GREY_LEVELS + 2) > PALETTE_GREY_LEVELS ? PALETTE_RGB(255, 255, 255) : \
+                         PALETTE_GREY_BASE + PALETTE_LEVEL(v, PALETTE_GREY_LEVELS + 2) - 1)
+
+extern uint8_t palette_lut[PALETTE_LUT_SIZE];
+extern uint32_t palette_colors[PALETTE_SIZE]; // 0x00RRGGBB for each entry
+
+// Build the lookup table (once) and load the palette into the VGA DAC.
+// Called whenever an 8bpp mode is selected.
+void palette_init(void);
+
+// Nearest palette entry for a 0x??RRGGBB colour
+static inline uint8_t palette_index(uint32_t color) {
+    return palette_lut[((color >> 9) & 0x7C00) | ((color >> 6) & 0x03E0) | ((color >> 3) & 0x001F)];
+}
+
+// Ordered (4x4 Bayer) dithering for palette_convert_span; on by default
+void palette_set_dither(int enabled);
+int palette_dither_enabled(void);
+
+// Convert 32-bit 0xAARRGGBB pixels to palette indices. x, y is the screen
+// position of dst[0], which keeps the dither pattern fixed to the screen.
+void palette_convert_span(uint8_t* dst, const uint32_t* src, uint32_t count, uint32_t x, uint32_t y);
+
+#endif
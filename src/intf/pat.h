@@ -0,0 +1,30 @@
+#ifndef PAT_H
+#define PAT_H
+
+#include "stdint.h"
+
+// Memory types as encoded in the IA32_PAT MSR
+typedef enum {
+    PAT_TYPE_UC = 0,       // Uncacheable
+    PAT_TYPE_WC = 1,       // Write-combining
+    PAT_TYPE_WT = 4,       // Write-through
+    PAT_TYPE_WP = 5,       // Write-protected
+    PAT_TYPE_WB = 6,       // Write-back
+    PAT_TYPE_UC_MINUS = 7  // Uncacheable, overridable by MTRR WC
+} pat_type_t;
+
+// Program IA32_PAT. Entries 0-3 keep their power-on meaning so existing
+// mappings are unaffected; entry 4 becomes write-combining.
+// Returns 1 on success, 0 if the CPU has no PAT.
+int pat_init(void);
+int pat_supported(void);
+
+// Page table flags (VMM encoding) selecting the given memory type
+uint64_t pat_page_flags(pat_type_t type);
+const char* pat_type_name(pat_type_t type);
+
+// Remap [virt, virt + size) onto phys with the given memory type, following
+// the SDM procedure for changing the type of a live mapping
+int pat_map_range(uint64_t virt, uint64_t phys, uint64_t size, pat_type_t type);
+
+#endif
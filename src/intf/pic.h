@@ -3,6 +3,8 @@
 
 #include "stdint.h"
 
+// Let an IRQ through; lines behind the slave also open the cascade
+void pic_unmask(uint8_t irq);
 void pic_eoi(uint8_t irq);
 
 #endif
\ No newline at end of file
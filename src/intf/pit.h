@@ -0,0 +1,12 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include "stdint.h"
+
+#define PIT_FREQUENCY 1193182 // Input clock in Hz
+
+// Measure the TSC rate against PIT channel 2 (the speaker gate, so IRQ 0
+// is left alone). The result is cached; returns 0 without a TSC.
+uint64_t pit_tsc_hz(void);
+
+#endif
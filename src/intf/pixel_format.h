@@ -0,0 +1,25 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include "stdint.h"
+
+// Span kernels for one framebuffer pixel format. Spans are already clipped;
+// dst points at the first pixel and count is in pixels.
+//   fill_span    - store a colour already in this format
+//   copy_span    - copy pixels of this format (non-overlapping)
+//   convert_span - store 32-bit 0xAARRGGBB source pixels, alpha ignored
+//   blend_span   - composite premultiplied 32-bit 0xAARRGGBB source pixels
+//                  over dst (see blend.h)
+typedef struct {
+    uint32_t bpp;
+    uint32_t bytes_per_pixel;
+    void (*fill_span)(uint8_t* dst, uint32_t count, uint32_t color);
+    void (*copy_span)(uint8_t* dst, const uint8_t* src, uint32_t count);
+    void (*convert_span)(uint8_t* dst, const uint32_t* src, uint32_t count);
+    void (*blend_span)(uint8_t* dst, const uint32_t* src, uint32_t count);
+} pixel_format_t;
+
+// Backend for a colour depth (8, 16, 24 or 32); falls back to 8bpp
+const pixel_format_t* pixel_format_for_depth(uint32_t bpp);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PMM_H
+#define PMM_H
+
+#include "stdint.h"
+
+// Physical page-frame allocator (buddy system)
+#define PAGE_SIZE 4096
+#define PAGE_SHIFT 12
+#define PMM_MAX_ORDER 9                           // 2^9 pages = 2MB
+#define PMM_MAX_BLOCK_SIZE (PAGE_SIZE << PMM_MAX_ORDER)
+
+// Only RAM covered by the boot identity map (first 4GB) is managed
+#define PMM_MAX_PHYS_ADDR 0x100000000UL
+
+// Build the free lists from the Multiboot2 memory map.
+// Returns 1 on success, 0 if no usable memory map was found.
+int pmm_init(void);
+
+// Allocate 2^order contiguous, naturally aligned frames. Returns the
+// physical (= identity-mapped virtual) address, or 0 when out of memory.
+uint64_t pmm_alloc_pages(uint32_t order);
+void pmm_free_pages(uint64_t addr, uint32_t order);
+
+// Allocate a physically contiguous run of any length. Runs larger than
+// PMM_MAX_BLOCK_SIZE are assembled from adjacent 2MB blocks.
+uint64_t pmm_alloc_contiguous(size_t page_count);
+void pmm_free_contiguous(uint64_t addr, size_t page_count);
+
+// Smallest order whose block holds the given number of bytes
+uint32_t pmm_order_for_size(size_t size);
+
+size_t pmm_total_bytes(void);
+size_t pmm_free_bytes(void);
+
+#endif
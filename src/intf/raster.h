@@ -0,0 +1,67 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "stdint.h"
+#include "pixel_format.h"
+
+// Scanline span rasterizer. Every shape becomes one horizontal span per
+// covered scanline, each clipped once and filled with the target's span
+// kernel. Polygon edges are stepped in 16.16 fixed point and sampled at
+// pixel centres with the top-left rule: a pixel is filled when its centre
+// is inside the shape or on a top or left edge, so shapes that share an
+// edge neither overlap nor leave a gap.
+#define RASTER_MAX_VERTICES 64
+#define RASTER_FIXED_SHIFT 16
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+} raster_point_t;
+
+// Surface to fill: pixels in any format plus the clip rectangle
+// [clip_x1, clip_x2) x [clip_y1, clip_y2)
+typedef struct {
+    uint8_t* pixels;
+    uint32_t pitch;
+    const pixel_format_t* format;
+    int32_t clip_x1, clip_y1;
+    int32_t clip_x2, clip_y2;
+} raster_target_t;
+
+// Colours are already in the target's format. Each call returns the number
+// of pixels written after clipping.
+
+// Any simple or self-intersecting polygon (non-zero winding), up to
+// RASTER_MAX_VERTICES vertices; vertices are pixel corners
+uint64_t raster_fill_polygon(const raster_target_t* target, const raster_point_t* points, uint32_t count, uint32_t color);
+uint64_t raster_fill_triangle(const raster_target_t* target, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                              int32_t x3, int32_t y3, uint32_t color);
+// Covers centre +/- radius inclusive, like the midpoint circle outline
+uint64_t raster_fill_circle(const raster_target_t* target, int32_t center_x, int32_t center_y, uint32_t radius, uint32_t color);
+// [x, x + width) x [y, y + height) with quarter-circle corners; the radius is
+// clamped to half the shorter side
+uint64_t raster_fill_rounded_rect(const raster_target_t* target, int32_t x, int32_t y, uint32_t width, uint32_t height,
+                                  uint32_t radius, uint32_t color);
+
+// Narrow the target's clip rectangle to its intersection with another
+void raster_clip_to(raster_target_t* target, int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+// One-pixel line including both endpoints, the same pixels Bresenham would
+// visit unclipped. The line is clipped parametrically before stepping, so
+// only visible pixels cost anything; horizontal and vertical lines become
+// span fills.
+uint64_t raster_draw_line(const raster_target_t* target, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+
+typedef struct {
+    const char* shape;
+    uint64_t legacy_pixels_per_second;  // Per-pixel Bresenham spans (the old path)
+    uint64_t span_pixels_per_second;    // This rasterizer
+} raster_benchmark_t;
+
+#define RASTER_BENCH_SHAPES 3
+
+// Fill the same shapes into an off-screen buffer with both paths. Returns
+// the number of results written, 0 if no buffer or TSC rate was available.
+uint32_t raster_benchmark(raster_benchmark_t* results, uint32_t max_results);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include "stdint.h"
+#include "pixel_format.h"
+
+// Scaled blits of 32-bit 0xAARRGGBB images. Source coordinates are stepped
+// in 16.16 fixed point and sampled at pixel centres, so the only divisions
+// are the two step sizes per blit. Each source row is resampled once and
+// reused for every destination row that maps to it.
+#define SCALE_FIXED_SHIFT 16
+#define SCALE_CHUNK_PIXELS 384 // Destination columns per pass; divisible by 2 and 3
+
+typedef enum {
+    SCALE_NEAREST = 0,
+    SCALE_BILINEAR
+} scale_filter_t;
+
+// Visible part of the destination rectangle. pixels is the destination's
+// top-left pixel and x, y its screen position (anchors the 8bpp dither);
+// width and height may be smaller than the scaled size when clipped on the
+// right or bottom.
+typedef struct {
+    uint8_t* pixels;
+    uint32_t pitch;
+    const pixel_format_t* format;
+    uint32_t x, y;
+    uint32_t width, height;
+} scale_target_t;
+
+// Stretch src_width x src_height onto dest_width x dest_height. Nearest
+// upscales by exactly 2x or 3x take a pixel-replication fast path; the
+// bilinear vertical pass runs four pixels at a time with SSE2 where the
+// CPU has it.
+void scale_blit(const scale_target_t* target, const uint32_t* src, uint32_t src_width, uint32_t src_height,
+                uint32_t dest_width, uint32_t dest_height, scale_filter_t filter);
+
+#endif
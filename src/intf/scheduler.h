@@ -4,7 +4,7 @@
 #include "stdint.h"
 
 #define MAX_PROCESSES 16
-#define STACK_SIZE 4096
+#define STACK_SIZE (64 * 1024) // Reserved per process; backed on first touch
 
 enum process_state {
     PROCESS_RUNNING,
@@ -18,7 +18,7 @@ typedef struct {
     uint64_t rsp; // Stack pointer
     uint64_t rbp; // Base pointer
     enum process_state state;
-    uint8_t stack[STACK_SIZE];
+    uint8_t* stack; // Lazily backed STACK_SIZE region (kmalloc fallback)
 } pcb_t;
 
 void scheduler_init();
@@ -0,0 +1,40 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "stdint.h"
+
+// CPU features relevant to the memory kernels
+#define CPU_FEATURE_SSE2  (1U << 0)
+#define CPU_FEATURE_AVX   (1U << 1)
+#define CPU_FEATURE_AVX2  (1U << 2)
+#define CPU_FEATURE_ERMS  (1U << 3) // Enhanced rep movsb/stosb
+#define CPU_FEATURE_XSAVE (1U << 4)
+
+// Stores at least this large bypass the caches (framebuffer-sized targets)
+#define SIMD_STREAMING_THRESHOLD (256 * 1024)
+
+// Large enough for the x87 + SSE + AVX XSAVE area (832 bytes)
+#define SIMD_STATE_SIZE 1024
+
+typedef struct {
+    uint8_t data[SIMD_STATE_SIZE];
+} __attribute__((aligned(64))) simd_state_t;
+
+// Enable SSE (and AVX when present) in CR0/CR4/XCR0, then pick the fill and
+// copy kernels from CPUID. Until this runs, rep stosq/movsq versions are used.
+void simd_init(void);
+uint32_t simd_features(void);
+const char* simd_impl_name(void);
+
+// Fill bytes with a repeating 4-byte pattern: byte i gets byte (i % 4) of
+// pattern, so memset is pattern = value * 0x01010101
+void fast_fill(void* dest, uint32_t pattern, size_t bytes);
+// Non-overlapping copy
+void fast_copy(void* dest, const void* src, size_t bytes);
+
+// Interrupt handlers may use the vector kernels, so they preserve the
+// interrupted code's vector registers around their work
+void simd_save(simd_state_t* state);
+void simd_restore(simd_state_t* state);
+
+#endif
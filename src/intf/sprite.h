@@ -0,0 +1,102 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include "stdint.h"
+#include "raster.h"
+
+// Run-length encoded sprites. Each row is stored as (skip, length) runs
+// over the 32-bit 0xAARRGGBB source: transparent pixels only advance the
+// skip count and cost nothing to draw, opaque runs go straight through the
+// target's convert_span, and runs of partly transparent pixels through its
+// blend_span. Sources are straight alpha; translucent pixels are stored
+// premultiplied, which is what blend_span takes. With a colour key, pixels whose RGB equals the key are
+// transparent and the rest opaque, whatever their alpha; with SPRITE_NO_KEY
+// alpha decides. Any row can be reached directly, so vertical clipping and
+// flipping are free and horizontal clipping trims runs.
+#define SPRITE_MAX_SIZE   4096
+#define SPRITE_NO_KEY     0xFFFFFFFF // Use alpha alone
+#define SPRITE_RUN_BLEND  0x8000     // Run length flag: blend instead of copy
+#define SPRITE_RUN_LENGTH 0x7FFF
+
+// Draw flags
+#define SPRITE_FLIP_H 0x1
+#define SPRITE_FLIP_V 0x2
+
+typedef struct {
+    uint16_t skip;   // Transparent pixels before the run
+    uint16_t length; // Pixels in the run, SPRITE_RUN_BLEND if translucent
+} sprite_run_t;
+
+// Where each row's runs and pixels start; row height is the end marker
+typedef struct {
+    uint32_t run;
+    uint32_t pixel;
+} sprite_row_t;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    const sprite_row_t* rows;   // height + 1 entries
+    const sprite_run_t* runs;
+    const uint32_t* pixels;     // Visible pixels only, in run order
+    uint32_t visible_pixels;
+} sprite_t;
+
+// Encode width x height pixels. Returns 0 if the sprite is empty, too
+// large or cannot be allocated.
+sprite_t* sprite_create(const uint32_t* pixels, uint32_t stride, uint32_t width, uint32_t height, uint32_t color_key);
+void sprite_destroy(sprite_t* sprite);
+
+// Many sprites cut from sheets, encoded back to back into one allocation
+typedef struct {
+    uint8_t* arena;
+    size_t arena_size;
+    size_t used;
+    sprite_t* sprites;
+    uint32_t count;
+    uint32_t capacity;
+} sprite_atlas_t;
+
+sprite_atlas_t* sprite_atlas_create(size_t arena_size, uint32_t max_sprites);
+void sprite_atlas_destroy(sprite_atlas_t* atlas);
+// Encode the width x height cell at (x, y) of a sheet. Returns the sprite's
+// index, or -1 when the atlas is full or the cell is empty.
+int32_t sprite_atlas_add(sprite_atlas_t* atlas, const uint32_t* sheet, uint32_t stride,
+                         uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color_key);
+// Every cell_width x cell_height cell of a sheet, row by row. Returns the
+// number added; empty cells are skipped.
+uint32_t sprite_atlas_add_grid(sprite_atlas_t* atlas, const uint32_t* sheet, uint32_t stride,
+                               uint32_t sheet_width, uint32_t sheet_height,
+                               uint32_t cell_width, uint32_t cell_height, uint32_t color_key);
+const sprite_t* sprite_atlas_get(const sprite_atlas_t* atlas, uint32_t index);
+
+typedef struct {
+    const sprite_t* sprite;
+    int32_t x, y;
+    uint32_t flags;
+} sprite_instance_t;
+
+// Draw at (x, y) inside the target's clip rectangle. Returns the number of
+// pixels written.
+uint64_t sprite_draw(const raster_target_t* target, const sprite_t* sprite, int32_t x, int32_t y, uint32_t flags);
+// Draw instances in order (later ones on top), rejecting off-clip ones
+// before touching their runs
+uint64_t sprite_draw_batch(const raster_target_t* target, const sprite_instance_t* instances, uint32_t count);
+
+// SPRITE_BENCH_COUNT 32x32 sprites, about half transparent, drawn at fixed
+// random spots into an off-screen 32-bit buffer per frame, three ways: the
+// opaque blit vga_blit_buffer does, the same blit testing the colour key
+// per pixel, and the RLE batch. Each is reported as the number of sprites
+// that could be drawn in one 60 Hz refresh at the measured rate.
+#define SPRITE_BENCH_COUNT 256
+
+typedef struct {
+    uint64_t blit_sprites_per_frame;  // Opaque copy (wrong result, speed bound)
+    uint64_t key_sprites_per_frame;   // Per-pixel colour key
+    uint64_t rle_sprites_per_frame;   // Run-length encoded batch
+} sprite_benchmark_t;
+
+// Returns 0 if no buffer, sprite or TSC rate was available
+int sprite_benchmark(sprite_benchmark_t* result);
+
+#endif
@@ -2,32 +2,35 @@
 #define UI_H
 
 #include "stdint.h"
-
-// Color definitions for VGA mode 13h
-#define COLOR_BLACK 0
-#define COLOR_BLUE 1
-#define COLOR_GREEN 2
-#define COLOR_CYAN 3
-#define COLOR_RED 4
-#define COLOR_MAGENTA 5
-#define COLOR_BROWN 6
-#define COLOR_LIGHT_GREY 7
-#define COLOR_DARK_GREY 8
-#define COLOR_LIGHT_BLUE 9
-#define COLOR_LIGHT_GREEN 10
-#define COLOR_LIGHT_CYAN 11
-#define COLOR_LIGHT_RED 12
-#define COLOR_LIGHT_MAGENTA 13
-#define COLOR_YELLOW 14
-#define COLOR_WHITE 15
+#include "display_list.h"
+#include "input.h"
+
+// The 16 classic VGA colours as 0xAARRGGBB. The UI drawing helpers and
+// widgets convert them to the current depth when they draw (argb_to_color).
+#define COLOR_BLACK 0xFF000000
+#define COLOR_BLUE 0xFF0000AA
+#define COLOR_GREEN 0xFF00AA00
+#define COLOR_CYAN 0xFF00AAAA
+#define COLOR_RED 0xFFAA0000
+#define COLOR_MAGENTA 0xFFAA00AA
+#define COLOR_BROWN 0xFFAA5500
+#define COLOR_LIGHT_GREY 0xFFAAAAAA
+#define COLOR_DARK_GREY 0xFF555555
+#define COLOR_LIGHT_BLUE 0xFF5555FF
+#define COLOR_LIGHT_GREEN 0xFF55FF55
+#define COLOR_LIGHT_CYAN 0xFF55FFFF
+#define COLOR_LIGHT_RED 0xFFFF5555
+#define COLOR_LIGHT_MAGENTA 0xFFFF55FF
+#define COLOR_YELLOW 0xFFFFFF55
+#define COLOR_WHITE 0xFFFFFFFF
 
 // Custom UI colors
-#define COLOR_HEADER_BG 8      // Dark grey
-#define COLOR_TAB_ACTIVE 9     // Light blue
-#define COLOR_TAB_INACTIVE 7   // Light grey
-#define COLOR_TAB_TEXT 0        // Black
-#define COLOR_BORDER 15         // White
-#define COLOR_SETUP_BG 2        // Green
+#define COLOR_HEADER_BG COLOR_DARK_GREY
+#define COLOR_TAB_ACTIVE COLOR_LIGHT_BLUE
+#define COLOR_TAB_INACTIVE COLOR_LIGHT_GREY
+#define COLOR_TAB_TEXT COLOR_BLACK
+#define COLOR_BORDER COLOR_WHITE
+#define COLOR_SETUP_BG COLOR_GREEN
 
 // Header dimensions
 #define HEADER_HEIGHT 30
@@ -35,20 +38,14 @@
 #define TAB_HEIGHT 25
 #define TAB_SPACING 2
 
-// Tab structure
-typedef struct {
-    uint32_t x;
-    uint32_t y;
-    uint32_t width;
-    char text[20];
-    uint8_t is_active;
-} tab_t;
-
-// Initialize UI system
+// Initialize UI system: builds the header, start menu and taskbar as
+// widget trees (see widget.h)
 void ui_init(void);
 
 // Draw header with tabs
 void ui_draw_header(void);
+// Switch the active header tab
+void ui_select_tab(uint32_t index);
 
 // Draw a tab button
 void ui_draw_tab(uint32_t x, uint32_t y, const char* text, uint8_t is_active);
@@ -74,7 +71,38 @@ void ui_toggle_start_menu(void);
 void ui_draw_taskbar(void);
 void ui_draw_clock(void);
 
-void draw_string(uint32_t x, uint32_t y, const char* str, uint8_t color);
+void draw_string(uint32_t x, uint32_t y, const char* str, uint32_t color);
+
+// Drawing helpers for UI code, taking 0xAARRGGBB colours. While a frame is
+// being recorded they append to its display list, otherwise they draw
+// straight to the screen; either way in the screen's depth.
+void ui_fill_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color);
+void ui_draw_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t color);
+
+// Pointer shapes
+typedef enum {
+    UI_CURSOR_ARROW = 0,
+    UI_CURSOR_HAND,     // Over a button or tab
+    UI_CURSOR_MOVE      // Over a window's title bar
+} ui_cursor_t;
+
+// One mouse packet: screen position and MOUSE_*_BUTTON bits. What is under
+// the pointer comes from the hit-test grid (hit_test.h), so hover and the
+// cursor shape update without walking windows or widgets. Left presses
+// select tabs, toggle the start menu and raise windows.
+void ui_mouse_event(int32_t x, int32_t y, uint8_t buttons);
+ui_cursor_t ui_cursor(void);
+// One event drained from the input queue by the frame loop
+void ui_handle_event(const input_event_t* event);
+
+// Record the desktop (windows, then header, start menu and taskbar above
+// them) into a list
+void ui_record_frame(display_list_t* list);
+// Record and flush one desktop frame; stats may be null
+void ui_draw_frame(display_list_stats_t* stats);
+// Refresh the clock and window list and repaint only what changed since
+// the last frame or update. Returns the number of pixels written.
+uint64_t ui_update(void);
 
 #endif
 
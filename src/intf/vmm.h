@@ -0,0 +1,67 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include "stdint.h"
+
+// Page table entry flags (x86_64 4-level paging)
+#define VMM_PRESENT       (1UL << 0)
+#define VMM_WRITABLE      (1UL << 1)
+#define VMM_USER          (1UL << 2)
+#define VMM_WRITE_THROUGH (1UL << 3)
+#define VMM_CACHE_DISABLE (1UL << 4)
+#define VMM_ACCESSED      (1UL << 5)
+#define VMM_DIRTY         (1UL << 6)
+#define VMM_HUGE          (1UL << 7)  // 2MB/1GB leaf in a P2/P3 entry
+#define VMM_GLOBAL        (1UL << 8)
+// PAT index bit 2. Callers always pass it here; the VMM moves it to bit 7
+// when the leaf is a 4KB page
+#define VMM_PAT           (1UL << 12)
+#define VMM_CACHE_MASK    (VMM_WRITE_THROUGH | VMM_CACHE_DISABLE | VMM_PAT)
+
+// Page fault error code bits
+#define PF_PRESENT (1UL << 0) // Fault on a present page (protection violation)
+#define PF_WRITE   (1UL << 1)
+#define PF_USER    (1UL << 2)
+
+// Lazily backed regions live right above the 4GB identity map
+#define VMM_LAZY_BASE 0x100000000UL
+#define VMM_MAX_LAZY_REGIONS 64
+
+typedef enum {
+    VMM_PAGE_4K = 0x1000,
+    VMM_PAGE_2M = 0x200000,
+    VMM_PAGE_1G = 0x40000000
+} vmm_page_size_t;
+
+// Adopt the page tables built by boot.asm
+void vmm_init(void);
+int vmm_supports_1g_pages(void);
+
+// Map/unmap a single page of the given size. Mapping inside an existing
+// larger page splits it first. Return 1 on success, 0 on failure.
+int vmm_map_page(uint64_t virt, uint64_t phys, uint64_t flags, vmm_page_size_t size);
+// Returns the size of the page that was unmapped, 0 if nothing was mapped
+uint64_t vmm_unmap_page(uint64_t virt);
+
+// Map a range using the largest page sizes alignment allows
+int vmm_map_range(uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags);
+
+// Translate a virtual address (returns 0 when unmapped)
+uint64_t vmm_virt_to_phys(uint64_t virt);
+
+static inline void vmm_invlpg(uint64_t virt) {
+    __asm__ volatile ("invlpg (%0)" : : "r"(virt) : "memory");
+}
+
+void vmm_flush_tlb(void);
+
+// Demand paging: reserve address space now, back it with zeroed frames on
+// first touch. vmm_release() returns the touched frames to the PMM.
+void* vmm_reserve(size_t size, uint64_t flags);
+void vmm_release(void* addr);
+int vmm_is_reserved(const void* addr);
+
+// Called from the page fault handler. Returns 1 if the fault was resolved.
+int vmm_handle_page_fault(uint64_t fault_addr, uint64_t error_code);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef WIDGET_H
+#define WIDGET_H
+
+#include "stdint.h"
+#include "display_list.h"
+
+// Retained widget tree for the desktop shell. Every node keeps its screen
+// position and the text it last showed, so a property change damages only
+// the pixels that differ: a clock tick damages the digits that rolled over,
+// a tab switch the two tabs. widget_render repaints the damage, clipped to
+// it, with everything that overlaps it painted in tree order.
+//
+// Nodes without a parent are roots, painted in creation order above the
+// windows. Where a damaged area is not covered by an opaque widget the
+// windows and desktop beneath are recomposited first.
+#define WIDGET_MAX 32
+#define WIDGET_TEXT_MAX 24
+#define WIDGET_TAB_SPACING 5
+
+typedef enum {
+    WIDGET_PANEL = 0,  // Filled box
+    WIDGET_BUTTON,     // Filled box with centred text
+    WIDGET_LABEL,      // Text on whatever is beneath
+    WIDGET_TAB_STRIP,  // Places TAB children side by side, one active
+    WIDGET_TAB,        // Button using active_background while active
+    WIDGET_CLOCK,      // Label showing HH:MM:SS, refreshed by widget_tick
+    WIDGET_MENU        // Panel that starts hidden
+} widget_type_t;
+
+// Flags
+#define WIDGET_VISIBLE 0x1
+#define WIDGET_ACTIVE  0x2
+#define WIDGET_BORDER  0x4
+
+// Colours are 0xAARRGGBB (ui.h's COLOR_*), converted to the screen's depth
+// when painted. They and the flags may be set directly until the node is
+// first rendered; afterwards use the setters so the change is damaged.
+typedef struct widget {
+    uint32_t type;
+    uint32_t flags;
+    int32_t x, y;              // Relative to the parent
+    uint32_t width, height;
+    uint32_t background;
+    uint32_t active_background;
+    uint32_t foreground;
+    uint32_t border;
+    char text[WIDGET_TEXT_MAX]; // What is on screen once rendered
+    // Cached layout, in screen coordinates
+    int32_t screen_x, screen_y;
+    int32_t text_x, text_y;
+    struct widget* parent;
+    struct widget* first_child;
+    struct widget* next_sibling;
+} widget_t;
+
+// Size the damage to the screen and follow mode changes. Call once before
+// creating nodes.
+void widget_init(void);
+
+// Labels and clocks with a zero size take the size of their text. Returns
+// 0 when the pool is exhausted.
+widget_t* widget_create(uint32_t type, widget_t* parent, int32_t x, int32_t y,
+                        uint32_t width, uint32_t height, const char* text);
+
+void widget_set_text(widget_t* node, const char* text);
+void widget_set_active(widget_t* node, int active);
+void widget_set_visible(widget_t* node, int visible);
+void widget_move(widget_t* node, int32_t x, int32_t y);
+// Make child index of a tab strip the active tab
+void widget_select(widget_t* strip, uint32_t index);
+// Repaint the whole node on the next render
+void widget_invalidate(widget_t* node);
+
+// Something beneath the widgets changed (e.g. the compositor wrote it):
+// repaint whatever widgets overlap the area
+void widget_damage(int32_t x, int32_t y, uint32_t width, uint32_t height);
+// Whether any visible widget lies over the area
+int widget_overlaps(int32_t x, int32_t y, uint32_t width, uint32_t height);
+// Refresh clocks from the RTC
+void widget_tick(void);
+
+// Paint a subtree in full, recorded into list or, without one, directly
+void widget_record(const widget_t* node, display_list_t* list);
+// Repaint the damaged areas through list and clear the damage. Returns the
+// number of pixels written.
+uint64_t widget_render(display_list_t* list);
+// The damage has been painted some other way, e.g. by a full frame
+void widget_clear_damage(void);
+
+#endif
@@ -2,21 +2,62 @@
 #define WINDOW_H
 
 #include "stdint.h"
+#include "graphics.h"
+#include "damage.h"
+#include "display_list.h"
 
 #define MAX_WINDOWS 10
 
+// Frame layout and colours. Surfaces are 32-bit 0xAARRGGBB; these are the
+// ui.h colours of the old directly drawn frame.
+#define WINDOW_TITLE_BAR_HEIGHT 20
+#define WINDOW_FRAME_COLOR      0xFF555555
+#define WINDOW_BORDER_COLOR     0xFFFFFFFF
+#define WINDOW_TITLE_COLOR      0xFF0000AA
+#define WINDOW_TEXT_COLOR       0xFFFFFFFF
+
+// Every window draws into its own off-screen surface, frame included; the
+// compositor copies surfaces to the screen in z-order. Drawing into
+// surface with the *_software functions records surface damage, which the
+// next window_composite() turns into screen damage.
 typedef struct {
     int x, y, width, height;
     char* title;
     int is_active;
+    render_buffer_t* surface;
+    damage_region_t damage; // Surface coordinates, dirty since the last composite
 } window_t;
 
 extern window_t* windows[MAX_WINDOWS];
 extern int window_count;
 
 void init_windowing();
+// New windows go on top. Returns 0 if no slot or surface is available.
 window_t* create_window(int x, int y, int width, int height, char* title);
+// Repaint the frame into the surface and put the window on screen
 void draw_window(window_t* win);
+// Only the old and new areas are recomposited
 void move_window(window_t* win, int new_x, int new_y);
+void raise_window(window_t* win);
+void destroy_window(window_t* win);
+
+// Mark part of a window (surface coordinates) for the next composite
+void window_invalidate(window_t* win, int x, int y, int width, int height);
+
+// Mark a screen area for the next composite, e.g. one the shell uncovered
+void window_damage_screen(int x, int y, int width, int height);
+
+// Recomposite the damaged parts of the screen. Each damaged rectangle is
+// cut into horizontal bands at window edges; within a band the windows are
+// walked top down and each takes the part of the band's remaining spans it
+// covers, so every screen pixel is copied from exactly one surface (or
+// filled with desktop background) and covered pixels are never touched.
+// The widgets over what was written are damaged for the next widget_render.
+// Returns the number of pixels written.
+uint64_t window_composite(void);
+
+// Every window in z-order: recorded as blits when list is set (the display
+// list culls what is covered), else damaged and composited
+void window_paint_all(display_list_t* list);
 
-#endif
\ No newline at end of file
+#endif